@@ -0,0 +1,131 @@
+#include "adaptive.h"
+#include "data_types.h"
+#include "debugmalloc.h"
+#include <stdlib.h>
+#include <string.h>
+
+// A gyoker mindig a tomb utolso eleme, az uj pontok lefele, csokkeno indexekkel jonnek letre.
+static const int ROOT = 512;
+
+// Beir egy bitet az out buffer bit_pos poziciojara (a bajtokon belul a legnagyobb helyierteku bittel kezdve).
+static void put_bit(unsigned char *out, long bit_pos, int bit) {
+    unsigned char mask = (unsigned char)(1 << (7 - bit_pos % 8));
+    if (bit) out[bit_pos / 8] |= mask;
+    else out[bit_pos / 8] &= (unsigned char)~mask;
+}
+
+static int get_bit(const unsigned char *in, long bit_pos) {
+    return (in[bit_pos / 8] >> (7 - bit_pos % 8)) & 1;
+}
+
+// Kezdo allapot: a fa egyetlen pontja az NYT, amely egyben a gyoker.
+void adaptive_init(Adaptive_tree *tree) {
+    for (int i = 0; i <= ROOT; i++) {
+        tree->nodes[i] = (Adaptive_node){0, -1, -1, -1, -1};
+    }
+    for (int i = 0; i < 256; i++) {
+        tree->leaf[i] = -1;
+    }
+    tree->nyt = ROOT;
+}
+
+/*
+ * Kicsereli a ket pozicion allo reszfat. A pozicio (sorszam) es a szulo marad, a tartalom cserelodik,
+ * ezert a gyermekek szulo mutatoit es a levelek indexeit utana javitani kell.
+ */
+static void swap_nodes(Adaptive_tree *tree, int a, int b) {
+    Adaptive_node temp = tree->nodes[a];
+    tree->nodes[a] = tree->nodes[b];
+    tree->nodes[b] = temp;
+    tree->nodes[b].parent = tree->nodes[a].parent;
+    tree->nodes[a].parent = temp.parent;
+
+    int positions[2] = {a, b};
+    for (int i = 0; i < 2; i++) {
+        Adaptive_node *node = &tree->nodes[positions[i]];
+        if (node->symbol >= 0) {
+            tree->leaf[node->symbol] = positions[i];
+        } else if (node->left >= 0) {
+            tree->nodes[node->left].parent = positions[i];
+            tree->nodes[node->right].parent = positions[i];
+        }
+    }
+}
+
+/*
+ * Az FGK frissites: uj bajt eseten az NYT-t kettevagja (uj NYT es uj level), majd a level es az osei sulyat
+ * noveli. Noveles elott a pontot a sajat sulyosztalyanak legnagyobb sorszamu pontjaval cserei (ha az nem a szuloje),
+ * igy a testver tulajdonsag megmarad.
+ */
+static void adaptive_update(Adaptive_tree *tree, unsigned char symbol) {
+    int q = tree->leaf[symbol];
+    if (q < 0) {
+        int old_nyt = tree->nyt;
+        tree->nodes[old_nyt].left = old_nyt - 2;
+        tree->nodes[old_nyt].right = old_nyt - 1;
+        tree->nodes[old_nyt - 2] = (Adaptive_node){0, old_nyt, -1, -1, -1};
+        tree->nodes[old_nyt - 1] = (Adaptive_node){0, old_nyt, -1, -1, symbol};
+        tree->leaf[symbol] = old_nyt - 1;
+        tree->nyt = old_nyt - 2;
+        q = old_nyt - 1;
+    }
+    while (q >= 0) {
+        int leader = q;
+        while (leader < ROOT && tree->nodes[leader + 1].weight == tree->nodes[q].weight) {
+            leader++;
+        }
+        if (leader != q && leader != tree->nodes[q].parent) {
+            swap_nodes(tree, q, leader);
+            q = leader;
+        }
+        tree->nodes[q].weight++;
+        q = tree->nodes[q].parent;
+    }
+}
+
+/*
+ * Kodol egy bajtot az out buffer bit_pos poziciojatol, majd frissiti a fat. Ismert bajtnal a level utvonalat,
+ * uj bajtnal az NYT utvonalat es a nyers 8 bitet irja. Legfeljebb ADAPTIVE_MAX_CODE_BITS bitet ir.
+ */
+void adaptive_encode(Adaptive_tree *tree, unsigned char symbol, unsigned char *out, long *bit_pos) {
+    int node = tree->leaf[symbol] >= 0 ? tree->leaf[symbol] : tree->nyt;
+    /* Az utvonalat a levelbol felfele gyujtjuk, majd forditott sorrendben irjuk ki. */
+    unsigned char path[ADAPTIVE_MAX_CODE_BITS];
+    int length = 0;
+    while (node != ROOT) {
+        int parent = tree->nodes[node].parent;
+        path[length++] = tree->nodes[parent].right == node;
+        node = parent;
+    }
+    while (length > 0) {
+        put_bit(out, (*bit_pos)++, path[--length]);
+    }
+    if (tree->leaf[symbol] < 0) {
+        for (int i = 7; i >= 0; i--) {
+            put_bit(out, (*bit_pos)++, (symbol >> i) & 1);
+        }
+    }
+    adaptive_update(tree, symbol);
+}
+
+/*
+ * Dekodol egy bajtot az in bufferbol a bit_pos poziciotol, es ugyanugy frissiti a fat, mint a kodolo.
+ * A dekodolt bajtot adja vissza, vagy DECOMPRESSION_ERROR-t, ha a bemenet a bit_count bit elott elfogyott.
+ */
+int adaptive_decode(Adaptive_tree *tree, const unsigned char *in, long bit_count, long *bit_pos) {
+    int node = ROOT;
+    while (tree->nodes[node].left >= 0) {
+        if (*bit_pos >= bit_count) return DECOMPRESSION_ERROR;
+        node = get_bit(in, (*bit_pos)++) ? tree->nodes[node].right : tree->nodes[node].left;
+    }
+    int symbol = tree->nodes[node].symbol;
+    if (node == tree->nyt) {
+        if (*bit_pos + 8 > bit_count) return DECOMPRESSION_ERROR;
+        symbol = 0;
+        for (int i = 0; i < 8; i++) {
+            symbol = (symbol << 1) | get_bit(in, (*bit_pos)++);
+        }
+    }
+    adaptive_update(tree, (unsigned char)symbol);
+    return symbol;
+}
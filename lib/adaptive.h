@@ -0,0 +1,13 @@
+#ifndef ADAPTIVE_H
+#define ADAPTIVE_H
+
+#include "data_types.h"
+
+// Egy bajt kodja legfeljebb ennyi bit: az NYT utvonala (a fa melysege) es a 8 bites nyers bajt.
+#define ADAPTIVE_MAX_CODE_BITS 272
+
+void adaptive_init(Adaptive_tree *tree);
+void adaptive_encode(Adaptive_tree *tree, unsigned char symbol, unsigned char *out, long *bit_pos);
+int adaptive_decode(Adaptive_tree *tree, const unsigned char *in, long bit_count, long *bit_pos);
+
+#endif // ADAPTIVE_H
@@ -0,0 +1,189 @@
+#include "alphabet.h"
+#include "compress.h"
+#include "data_types.h"
+#include "debugmalloc.h"
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+/*
+ * Tobb, egyenkent legfeljebb 256 szimbolumos abece Huffman kodolasa egyetlen bitfolyamba (pl. LZ77 szekvenciak).
+ * A kodolo ketszer futtatja ugyanazt a determinisztikus elemzest: eloszor a sink csak szamol, ebbol epulnek a fak,
+ * masodszor kodol. A fak szerializalt alakja abecenkent a pontok szama (long), majd a pontok.
+ * A nagy ertekeket (hosszak, tavolsagok) logaritmikus osztalykodra es extra bitekre bontjuk.
+ */
+
+static int floor_log2(long value) {
+    int log = 0;
+    while (value >>= 1) log++;
+    return log;
+}
+
+// count bitet ir ki (a legnagyobb helyierteku bittel kezdve), szamlalaskor csak osszeadja oket.
+int sink_bits(Symbol_sink *sink, long value, int count) {
+    if (sink->codes == NULL) {
+        sink->extra_bits += count;
+        return 0;
+    }
+    if ((sink->bits + count) / 8 + 1 >= sink->capacity) {
+        unsigned char *grown = realloc(sink->out, sink->capacity * 2);
+        if (grown == NULL) return MALLOC_ERROR;
+        memset(grown + sink->capacity, 0, sink->capacity);
+        sink->out = grown;
+        sink->capacity *= 2;
+    }
+    for (int b = count - 1; b >= 0; b--) {
+        if (value & (1L << b)) sink->out[sink->bits / 8] |= (unsigned char)(1 << (7 - sink->bits % 8));
+        sink->bits++;
+    }
+    return 0;
+}
+
+// Egy abece egy szimbolumat szamolja, vagy a fa szerinti kodjat irja ki.
+int sink_symbol(Symbol_sink *sink, int alphabet, int symbol) {
+    if (sink->codes == NULL) {
+        sink->frequencies[alphabet][symbol]++;
+        return 0;
+    }
+    char **path = &sink->codes[alphabet * 256 + symbol];
+    if (*path == NULL && sink->model->nodes[alphabet] != NULL) {
+        *path = find_leaf((char)symbol, sink->model->nodes[alphabet], sink->model->roots[alphabet]);
+    }
+    if (*path == NULL) return TREE_ERROR;
+    for (int j = 0; (*path)[j] != '\0'; j++) {
+        int res = sink_bits(sink, (*path)[j] == '1', 1);
+        if (res != 0) return res;
+    }
+    return 0;
+}
+
+// 16 alatt az ertek maga a kod, felette 12 + log2(ertek), a maradekot log2(ertek) extra bit adja.
+int sink_value(Symbol_sink *sink, int alphabet, long value) {
+    if (value < 16) return sink_symbol(sink, alphabet, (int)value);
+    int log = floor_log2(value);
+    int res = sink_symbol(sink, alphabet, 12 + log);
+    if (res != 0) return res;
+    return sink_bits(sink, value - (1L << log), log);
+}
+
+void free_alphabet_model(Alphabet_model *model) {
+    for (int a = 0; a < model->alphabet_count; a++) {
+        free(model->nodes[a]);
+        model->nodes[a] = NULL;
+        model->node_counts[a] = 0;
+    }
+    model->alphabet_count = 0;
+}
+
+/*
+ * A szamlalo sink gyakorisagaibol felepiti az abecek fait, es visszaadja a kodolt adat becsult meretet bajtokban
+ * (a fak tarolasaval egyutt). Hiba eseten negativ kodot ad vissza.
+ */
+long build_alphabet_model(Symbol_sink *sink, int alphabet_count, Alphabet_model *model) {
+    memset(model, 0, sizeof(Alphabet_model));
+    long bits = sink->extra_bits;
+    for (int a = 0; a < alphabet_count; a++) {
+        long leaf_count = build_tree(sink->frequencies[a], &model->nodes[a], &model->roots[a]);
+        if (leaf_count < 0) {
+            free_alphabet_model(model);
+            return leaf_count;
+        }
+        model->alphabet_count++;
+        model->node_counts[a] = leaf_count > 0 ? (model->roots[a] - model->nodes[a]) + 1 : 0;
+        /* Az egyetlen szimbolumot tartalmazo abece kodja 0 bites. */
+        if (leaf_count > 1) bits += tree_cost(model->nodes[a], model->roots[a], sink->frequencies[a]);
+    }
+    return alphabet_model_size(model) + (bits + 7) / 8;
+}
+
+long alphabet_model_size(Alphabet_model *model) {
+    long size = 0;
+    for (int a = 0; a < model->alphabet_count; a++) {
+        size += sizeof(long) + model->node_counts[a] * sizeof(Node);
+    }
+    return size;
+}
+
+// Az alphabet_model_size meretu out bufferbe irja a fakat.
+void serialize_alphabet_model(Alphabet_model *model, char *out) {
+    long offset = 0;
+    for (int a = 0; a < model->alphabet_count; a++) {
+        memcpy(out + offset, &model->node_counts[a], sizeof(long));
+        offset += sizeof(long);
+        if (model->node_counts[a] > 0) memcpy(out + offset, model->nodes[a], model->node_counts[a] * sizeof(Node));
+        offset += model->node_counts[a] * sizeof(Node);
+    }
+}
+
+// Kodolo modba allitja a sink-et (kiindulo kimeneti buffer capacity bajt). Siker eseten 0-t ad vissza.
+int open_sink_output(Symbol_sink *sink, Alphabet_model *model, long capacity) {
+    sink->model = model;
+    sink->bits = 0;
+    sink->capacity = capacity > 16 ? capacity : 16;
+    sink->codes = calloc(ALPHABET_MAX * 256, sizeof(char *));
+    sink->out = calloc(sink->capacity, sizeof(char));
+    return sink->codes != NULL && sink->out != NULL ? 0 : MALLOC_ERROR;
+}
+
+// Felszabaditja a kodok gyorsitotarat es (ha a hivo nem vette at) a kimeneti buffert.
+void close_sink(Symbol_sink *sink) {
+    if (sink->codes != NULL) {
+        for (int i = 0; i < ALPHABET_MAX * 256; i++) {
+            free(sink->codes[i]);
+        }
+    }
+    free(sink->codes);
+    free(sink->out);
+    sink->codes = NULL;
+    sink->out = NULL;
+}
+
+/*
+ * Dekodolashoz beolvassa a tree bufferben allo alphabet_count fat (a pontok a bufferbe mutatnak).
+ * A felhasznalt bajtok szamat adja vissza, serult adat eseten DECOMPRESSION_ERROR-t.
+ */
+long parse_alphabet_model(const char *tree, long tree_size, int alphabet_count, Alphabet_model *model) {
+    memset(model, 0, sizeof(Alphabet_model));
+    long offset = 0;
+    for (int a = 0; a < alphabet_count; a++) {
+        if (offset + (long)sizeof(long) > tree_size) return DECOMPRESSION_ERROR;
+        memcpy(&model->node_counts[a], tree + offset, sizeof(long));
+        offset += sizeof(long);
+        if (model->node_counts[a] < 0 || model->node_counts[a] > 511 || offset + model->node_counts[a] * (long)sizeof(Node) > tree_size) {
+            return DECOMPRESSION_ERROR;
+        }
+        model->nodes[a] = (Node*)(tree + offset);
+        offset += model->node_counts[a] * sizeof(Node);
+    }
+    model->alphabet_count = alphabet_count;
+    return offset;
+}
+
+// Egy szimbolumot dekodol az abece fajabol; az egyetlen levelu fa nem fogyaszt bitet. Hiba eseten DECOMPRESSION_ERROR-t ad.
+int read_alphabet_symbol(Alphabet_model *model, int alphabet, const unsigned char *in, long bit_count, long *position) {
+    Node *tree = model->nodes[alphabet];
+    long node_count = model->node_counts[alphabet];
+    if (node_count == 0) return DECOMPRESSION_ERROR;
+    long current = node_count - 1;
+    while (tree[current].type != LEAF) {
+        if (*position >= bit_count) return DECOMPRESSION_ERROR;
+        bool bit = in[*position / 8] & (1 << (7 - *position % 8));
+        (*position)++;
+        current = bit ? tree[current].right : tree[current].left;
+        if (current < 0 || current >= node_count) return DECOMPRESSION_ERROR;
+    }
+    return (unsigned char)tree[current].data;
+}
+
+// A sink_value parja: osztalykodot, majd szukseg eseten az extra biteket olvassa.
+long read_alphabet_value(Alphabet_model *model, int alphabet, const unsigned char *in, long bit_count, long *position) {
+    int code = read_alphabet_symbol(model, alphabet, in, bit_count, position);
+    if (code < 16) return code;
+    int log = code - 12;
+    if (log >= 62 || *position + log > bit_count) return DECOMPRESSION_ERROR;
+    long value = 1L << log;
+    for (int b = log - 1; b >= 0; b--, (*position)++) {
+        if (in[*position / 8] & (1 << (7 - *position % 8))) value |= 1L << b;
+    }
+    return value;
+}
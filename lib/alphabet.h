@@ -0,0 +1,19 @@
+#ifndef ALPHABET_H
+#define ALPHABET_H
+
+#include "data_types.h"
+
+int sink_bits(Symbol_sink *sink, long value, int count);
+int sink_symbol(Symbol_sink *sink, int alphabet, int symbol);
+int sink_value(Symbol_sink *sink, int alphabet, long value);
+long build_alphabet_model(Symbol_sink *sink, int alphabet_count, Alphabet_model *model);
+long alphabet_model_size(Alphabet_model *model);
+void serialize_alphabet_model(Alphabet_model *model, char *out);
+int open_sink_output(Symbol_sink *sink, Alphabet_model *model, long capacity);
+void close_sink(Symbol_sink *sink);
+void free_alphabet_model(Alphabet_model *model);
+long parse_alphabet_model(const char *tree, long tree_size, int alphabet_count, Alphabet_model *model);
+int read_alphabet_symbol(Alphabet_model *model, int alphabet, const unsigned char *in, long bit_count, long *position);
+long read_alphabet_value(Alphabet_model *model, int alphabet, const unsigned char *in, long bit_count, long *position);
+
+#endif // ALPHABET_H
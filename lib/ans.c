@@ -0,0 +1,245 @@
+#include "ans.h"
+#include "data_types.h"
+#include "debugmalloc.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/*
+ * Tablas aszimmetrikus szamrendszer (tANS) kodolo es dekodolo. Az allapot 0 es ANS_TABLE_SIZE - 1 kozotti;
+ * a dekodolo az allapotbol kiolvassa a bajtot, majd nb bitet beolvasva a kovetkezo allapotra lep.
+ * A kodolo hatulrol elore halad, a biteket a kimenet vegere irja, a vegen az allapotot is; a dekodolo ezert
+ * a bitfolyam vegerol visszafele olvas. Az utolso bajt utan a dekodolo a 0 allapotba er, ez ellenorzi a blokkot.
+ */
+
+// A kodolo es a dekodolo ugyanigy teriti szet a bajtokat az allapotok kozott (a lepes paratlan, igy minden allapotot erint).
+static void spread_symbols(const unsigned short *normalized, unsigned char *spread) {
+    int step = (ANS_TABLE_SIZE >> 1) + (ANS_TABLE_SIZE >> 3) + 3;
+    int position = 0;
+    for (int s = 0; s < 256; s++) {
+        for (int i = 0; i < normalized[s]; i++) {
+            spread[position] = (unsigned char)s;
+            position = (position + step) & (ANS_TABLE_SIZE - 1);
+        }
+    }
+}
+
+static int floor_log2(unsigned int value) {
+    int log = 0;
+    while (value >>= 1) log++;
+    return log;
+}
+
+/*
+ * A gyakorisagokat ANS_TABLE_SIZE osszegure skalazza ugy, hogy minden elofordulo bajt legalabb 1-et kapjon.
+ * Az elofordulo bajtok szamat adja vissza (0, ha nincs adat), hiba eseten negativ kodot.
+ */
+int ans_normalize(const long *frequencies, unsigned short *normalized) {
+    long total = 0;
+    int symbol_count = 0;
+    for (int s = 0; s < 256; s++) {
+        total += frequencies[s];
+        if (frequencies[s] > 0) symbol_count++;
+    }
+    memset(normalized, 0, 256 * sizeof(unsigned short));
+    if (total == 0) return 0;
+
+    long sum = 0;
+    for (int s = 0; s < 256; s++) {
+        if (frequencies[s] == 0) continue;
+        long scaled = (long)((double)frequencies[s] * ANS_TABLE_SIZE / total + 0.5);
+        normalized[s] = scaled < 1 ? 1 : scaled;
+        sum += normalized[s];
+    }
+    /* A kerekitesi elterest mindig a legnagyobb (csokkentesnel a legnagyobb, 1-nel nagyobb) bajton egyenlitjuk ki. */
+    while (sum != ANS_TABLE_SIZE) {
+        int largest = -1;
+        for (int s = 0; s < 256; s++) {
+            if (normalized[s] == 0 || (sum > ANS_TABLE_SIZE && normalized[s] == 1)) continue;
+            if (largest < 0 || normalized[s] > normalized[largest]) largest = s;
+        }
+        if (largest < 0) return COMPRESSION_ERROR;
+        if (sum > ANS_TABLE_SIZE) {
+            normalized[largest]--;
+            sum--;
+        } else {
+            normalized[largest]++;
+            sum++;
+        }
+    }
+    return symbol_count;
+}
+
+// Kodolas nelkul megbecsuli, hany bitre kodolodnanak a bajtok a normalizalt gyakorisagokkal (a zaro allapottal egyutt).
+long ans_cost(const long *frequencies, const unsigned short *normalized) {
+    double bits = ANS_TABLE_LOG;
+    for (int s = 0; s < 256; s++) {
+        if (frequencies[s] == 0) continue;
+        if (normalized[s] == 0) return -1;
+        bits += frequencies[s] * (ANS_TABLE_LOG - log2((double)normalized[s]));
+    }
+    return (long)ceil(bits);
+}
+
+/*
+ * A tag fa helyen tarolt fejlec: az elofordulo bajtok szama - 1, majd bajtonkent (bajt, 16 bites gyakorisag).
+ * Ha out NULL, csak a meretet adja vissza.
+ */
+long ans_header(const unsigned short *normalized, unsigned char *out) {
+    long size = 1;
+    int symbol_count = 0;
+    for (int s = 0; s < 256; s++) {
+        if (normalized[s] == 0) continue;
+        if (out != NULL) {
+            out[size] = (unsigned char)s;
+            out[size + 1] = (unsigned char)(normalized[s] >> 8);
+            out[size + 2] = (unsigned char)(normalized[s] & 0xFF);
+        }
+        size += 3;
+        symbol_count++;
+    }
+    if (out != NULL) out[0] = (unsigned char)(symbol_count - 1);
+    return size;
+}
+
+// Az akkumulator teljes bajtjait a buffer vegere irja (a legnagyobb helyierteku bittel kezdve), szukseg eseten noveli a buffert.
+static int flush_bits(unsigned char **buffer, long *capacity, long *size, uint64_t accumulator, int *pending) {
+    if (*size + 8 >= *capacity) {
+        unsigned char *grown = realloc(*buffer, *capacity * 2);
+        if (grown == NULL) return MALLOC_ERROR;
+        *buffer = grown;
+        *capacity *= 2;
+    }
+    while (*pending >= 8) {
+        *pending -= 8;
+        (*buffer)[(*size)++] = (unsigned char)(accumulator >> *pending);
+    }
+    return 0;
+}
+
+/*
+ * Kodolja a szeleteket. A kimeneti buffert lefoglalja (*out, a hivo szabaditja fel), a bitek szamat a bit_count-ba irja.
+ * Siker eseten 0-t, kulonben negativ kodot ad vissza.
+ */
+int ans_encode(Data_segment *segments, int segment_count, const unsigned short *normalized, char **out, long *bit_count) {
+    unsigned char spread[ANS_TABLE_SIZE];
+    unsigned short encode_table[ANS_TABLE_SIZE];
+    int start[256];
+    unsigned short next[256];
+    uint32_t delta_nb[256];
+    spread_symbols(normalized, spread);
+    int cumulative = 0;
+    for (int s = 0; s < 256; s++) {
+        next[s] = normalized[s];
+        /* Az x + ANS_TABLE_SIZE allapotbol kiirando bitek szama k vagy k - 1, aszerint, hogy x eleri-e a (f << k)
+         * kuszobot (k = ANS_TABLE_LOG - floor(log2 f)); a (x + delta_nb) >> 16 elagazas nelkul adja meg. */
+        if (normalized[s] > 0) {
+            int max_bits = ANS_TABLE_LOG - floor_log2(normalized[s]);
+            delta_nb[s] = ((uint32_t)max_bits << 16) - ((uint32_t)normalized[s] << max_bits);
+        }
+        /* A (x >> nb) ertek [f, 2f) kozotti, igy a kodolotabla indexe start + (x >> nb) - f. */
+        start[s] = cumulative - normalized[s];
+        cumulative += normalized[s];
+    }
+    /* A dekodolo az u allapotban a next ertekebol lep tovabb; a kodolo ebbol az ertekbol keresi vissza az u-t. */
+    for (int u = 0; u < ANS_TABLE_SIZE; u++) {
+        int s = spread[u];
+        encode_table[start[s] + next[s]] = (unsigned short)u;
+        next[s]++;
+    }
+
+    long capacity = 16;
+    for (int i = 0; i < segment_count; i++) {
+        capacity += segments[i].size;
+    }
+    unsigned char *buffer = malloc(capacity);
+    if (buffer == NULL) return MALLOC_ERROR;
+
+    /* A biteket 64 bites akkumulatorban gyujtjuk, es csak teljes bajtokat irunk ki. */
+    uint64_t accumulator = 0;
+    int pending = 0;
+    long size = 0;
+    unsigned int state = 0;
+    int res = 0;
+    for (int i = segment_count - 1; i >= 0 && res == 0; i--) {
+        for (long j = segments[i].size - 1; j >= 0; j--) {
+            int s = (unsigned char)segments[i].data[j];
+            if (normalized[s] == 0) {
+                res = TREE_ERROR;
+                break;
+            }
+            uint32_t x = state + ANS_TABLE_SIZE;
+            int nb = (x + delta_nb[s]) >> 16;
+            accumulator = (accumulator << nb) | (x & ((1u << nb) - 1));
+            pending += nb;
+            state = encode_table[start[s] + (x >> nb)];
+            if (pending >= 64 - 2 * ANS_TABLE_LOG) {
+                res = flush_bits(&buffer, &capacity, &size, accumulator, &pending);
+                if (res != 0) break;
+            }
+        }
+    }
+    /* A dekodolo kezdo allapota a bitfolyam vegere kerul, az utolso reszleges bajtot nullakkal egeszitjuk ki. */
+    if (res == 0) {
+        accumulator = (accumulator << ANS_TABLE_LOG) | state;
+        pending += ANS_TABLE_LOG;
+        res = flush_bits(&buffer, &capacity, &size, accumulator, &pending);
+    }
+    if (res != 0) {
+        free(buffer);
+        return res;
+    }
+    long bits = size * 8 + pending;
+    if (pending > 0) buffer[size] = (unsigned char)(accumulator << (8 - pending));
+    *out = (char*)buffer;
+    *bit_count = bits;
+    return 0;
+}
+
+// A bitfolyam [position, position + nb) bitjeit olvassa ki (az elso bit a legnagyobb helyierteku).
+static unsigned int read_bits(const unsigned char *in, long position, int nb) {
+    unsigned int value = 0;
+    for (int b = 0; b < nb; b++, position++) {
+        value = (value << 1) | ((in[position / 8] >> (7 - position % 8)) & 1);
+    }
+    return value;
+}
+
+/*
+ * A fejlecbol felepiti a dekodolo tablat, es raw_size bajtot dekodol. Serult fejlec vagy bitfolyam
+ * (vagy ha a dekodolo nem a 0 allapotban fejezi be) eseten DECOMPRESSION_ERROR-t ad vissza.
+ */
+int ans_decode(const unsigned char *header, long header_size, const unsigned char *in, long bit_count, char *raw, long raw_size) {
+    unsigned short normalized[256] = {0};
+    if (header_size < 1 || header_size != 1 + 3 * ((long)header[0] + 1)) return DECOMPRESSION_ERROR;
+    long sum = 0;
+    for (long i = 1; i < header_size; i += 3) {
+        normalized[header[i]] = (unsigned short)((header[i + 1] << 8) | header[i + 2]);
+        sum += normalized[header[i]];
+    }
+    if (sum != ANS_TABLE_SIZE) return DECOMPRESSION_ERROR;
+
+    unsigned char spread[ANS_TABLE_SIZE];
+    unsigned char bit_counts[ANS_TABLE_SIZE];
+    unsigned short new_state[ANS_TABLE_SIZE];
+    unsigned short next[256];
+    spread_symbols(normalized, spread);
+    memcpy(next, normalized, sizeof(next));
+    for (int u = 0; u < ANS_TABLE_SIZE; u++) {
+        unsigned int n = next[spread[u]]++;
+        bit_counts[u] = (unsigned char)(ANS_TABLE_LOG - floor_log2(n));
+        new_state[u] = (unsigned short)((n << bit_counts[u]) - ANS_TABLE_SIZE);
+    }
+
+    long position = bit_count - ANS_TABLE_LOG;
+    if (position < 0) return DECOMPRESSION_ERROR;
+    unsigned int state = read_bits(in, position, ANS_TABLE_LOG);
+    for (long i = 0; i < raw_size; i++) {
+        raw[i] = (char)spread[state];
+        int nb = bit_counts[state];
+        position -= nb;
+        if (position < 0) return DECOMPRESSION_ERROR;
+        state = new_state[state] + read_bits(in, position, nb);
+    }
+    return state == 0 && position == 0 ? 0 : DECOMPRESSION_ERROR;
+}
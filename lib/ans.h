@@ -0,0 +1,16 @@
+#ifndef ANS_H
+#define ANS_H
+
+#include "data_types.h"
+
+// A tANS allapottabla merete 2^ANS_TABLE_LOG; a normalizalt gyakorisagok osszege pontosan ennyi.
+#define ANS_TABLE_LOG 11
+#define ANS_TABLE_SIZE (1 << ANS_TABLE_LOG)
+
+int ans_normalize(const long *frequencies, unsigned short *normalized);
+long ans_cost(const long *frequencies, const unsigned short *normalized);
+long ans_header(const unsigned short *normalized, unsigned char *out);
+int ans_encode(Data_segment *segments, int segment_count, const unsigned short *normalized, char **out, long *bit_count);
+int ans_decode(const unsigned char *header, long header_size, const unsigned char *in, long bit_count, char *raw, long raw_size);
+
+#endif // ANS_H
@@ -0,0 +1,285 @@
+#include "bwt.h"
+#include "alphabet.h"
+#include "data_types.h"
+#include "debugmalloc.h"
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+/*
+ * Burrows-Wheeler transzformacio, move-to-front es nullafutas-kodolas a Huffman lepes elott. A blokkot BWT_BLOCK_SIZE
+ * meretu reszblokkokra bontjuk, ezeket egymas utan, fuggetlenul transzformaljuk (az MTF lista is reszblokkonkent
+ * indul ujra). Az MTF kimenetben a nem nulla ertek onmaga szimboluma, a nullak futasat egy 0 szimbolum es a futas
+ * hossza kodolja. A fa helyen a reszblokkok primer indexei (long), majd a ket abece fai allnak.
+ */
+
+enum {
+    BWT_SYMBOL = 0,
+    BWT_RUN = 1
+};
+
+static long block_count_of(long data_len) {
+    return (data_len + BWT_BLOCK_SIZE - 1) / BWT_BLOCK_SIZE;
+}
+
+/*
+ * A ciklikus forgatasok rendezese prefix duplazassal (szamlalo rendezessel, O(n log n)). A sorted tombbe a rendezett
+ * forgatasok kezdopozicioit irja. Siker eseten 0-t, kulonben MALLOC_ERROR-t ad vissza.
+ */
+static int sort_rotations(const unsigned char *data, int n, int *sorted) {
+    int count_size = n > 256 ? n : 256;
+    int *classes = malloc(n * sizeof(int));
+    int *shifted = malloc(n * sizeof(int));
+    int *next_classes = malloc(n * sizeof(int));
+    int *counts = calloc(count_size, sizeof(int));
+    int res = 0;
+    while (true) {
+        if (classes == NULL || shifted == NULL || next_classes == NULL || counts == NULL) {
+            res = MALLOC_ERROR;
+            break;
+        }
+        for (int i = 0; i < n; i++) counts[data[i]]++;
+        for (int c = 1; c < 256; c++) counts[c] += counts[c - 1];
+        for (int i = n - 1; i >= 0; i--) sorted[--counts[data[i]]] = i;
+        int class_count = 1;
+        classes[sorted[0]] = 0;
+        for (int i = 1; i < n; i++) {
+            if (data[sorted[i]] != data[sorted[i - 1]]) class_count++;
+            classes[sorted[i]] = class_count - 1;
+        }
+
+        /* Minden korben a 2^h hosszu elotagok osztalyaibol a 2^(h+1) hosszuake lesz. */
+        for (long h = 1; h < n && class_count < n; h *= 2) {
+            for (int i = 0; i < n; i++) {
+                shifted[i] = (int)((sorted[i] - h + n) % n);
+            }
+            memset(counts, 0, class_count * sizeof(int));
+            for (int i = 0; i < n; i++) counts[classes[shifted[i]]]++;
+            for (int c = 1; c < class_count; c++) counts[c] += counts[c - 1];
+            for (int i = n - 1; i >= 0; i--) sorted[--counts[classes[shifted[i]]]] = shifted[i];
+
+            next_classes[sorted[0]] = 0;
+            class_count = 1;
+            for (int i = 1; i < n; i++) {
+                int current = sorted[i];
+                int previous = sorted[i - 1];
+                if (classes[current] != classes[previous] || classes[(current + h) % n] != classes[(previous + h) % n]) {
+                    class_count++;
+                }
+                next_classes[current] = class_count - 1;
+            }
+            int *swap = classes;
+            classes = next_classes;
+            next_classes = swap;
+        }
+        break;
+    }
+    free(classes);
+    free(shifted);
+    free(next_classes);
+    free(counts);
+    return res;
+}
+
+// Egy reszblokk BWT-je es MTF-je az out bufferbe; a primer indexet a primary-be irja.
+static int transform_block(const unsigned char *data, int n, unsigned char *out, long *primary) {
+    int *sorted = malloc(n * sizeof(int));
+    if (sorted == NULL) return MALLOC_ERROR;
+    int res = sort_rotations(data, n, sorted);
+    if (res != 0) {
+        free(sorted);
+        return res;
+    }
+    unsigned char list[256];
+    for (int c = 0; c < 256; c++) list[c] = (unsigned char)c;
+    for (int i = 0; i < n; i++) {
+        if (sorted[i] == 0) *primary = i;
+        unsigned char symbol = data[(sorted[i] + n - 1) % n];
+        int rank = 0;
+        while (list[rank] != symbol) rank++;
+        memmove(list + 1, list, rank);
+        list[0] = symbol;
+        out[i] = (unsigned char)rank;
+    }
+    free(sorted);
+    return 0;
+}
+
+// Az MTF kimenet nullafutas-kodolasa a sink-be; a futasok nem lepnek at reszblokk hataron.
+static int put_runs(const unsigned char *mtf, long data_len, Symbol_sink *sink) {
+    int res = 0;
+    for (long start = 0; start < data_len && res == 0; start += BWT_BLOCK_SIZE) {
+        long end = start + BWT_BLOCK_SIZE < data_len ? start + BWT_BLOCK_SIZE : data_len;
+        long i = start;
+        while (i < end && res == 0) {
+            if (mtf[i] != 0) {
+                res = sink_symbol(sink, BWT_SYMBOL, mtf[i]);
+                i++;
+                continue;
+            }
+            long run = 0;
+            while (i + run < end && mtf[i + run] == 0) run++;
+            res = sink_symbol(sink, BWT_SYMBOL, 0);
+            if (res == 0) res = sink_value(sink, BWT_RUN, run - 1);
+            i += run;
+        }
+    }
+    return res;
+}
+
+void bwt_free(Bwt_block *block) {
+    free(block->mtf);
+    free(block->primary);
+    block->mtf = NULL;
+    block->primary = NULL;
+    free_alphabet_model(&block->model);
+}
+
+/*
+ * Transzformalja a blokkot, felepiti a ket abece fajat, es visszaadja a kodolt blokk becsult meretet bajtokban
+ * (a primer indexekkel es a fakkal egyutt). Hiba eseten negativ kodot ad vissza.
+ */
+long bwt_estimate(const char *data, long data_len, Bwt_block *block) {
+    memset(block, 0, sizeof(Bwt_block));
+    block->block_count = block_count_of(data_len);
+    block->mtf = malloc(data_len);
+    block->primary = malloc(block->block_count * sizeof(long));
+    Symbol_sink *sink = calloc(1, sizeof(Symbol_sink));
+    long res = 0;
+    while (true) {
+        if (block->mtf == NULL || block->primary == NULL || sink == NULL) {
+            res = MALLOC_ERROR;
+            break;
+        }
+        for (long b = 0; b < block->block_count && res == 0; b++) {
+            long start = b * BWT_BLOCK_SIZE;
+            int n = (int)(data_len - start < BWT_BLOCK_SIZE ? data_len - start : BWT_BLOCK_SIZE);
+            res = transform_block((const unsigned char*)data + start, n, block->mtf + start, &block->primary[b]);
+        }
+        if (res != 0) break;
+        res = put_runs(block->mtf, data_len, sink);
+        if (res != 0) break;
+        res = build_alphabet_model(sink, BWT_ALPHABETS, &block->model);
+        if (res < 0) break;
+        res += block->block_count * sizeof(long);
+        break;
+    }
+    free(sink);
+    if (res < 0) bwt_free(block);
+    return res;
+}
+
+/*
+ * A bwt_estimate eredmenyebol kodolja a blokkot. A fa helyen allo adatot a tree kimenetbe irja (a hivo
+ * szabaditja fel), a compressed_file fa es adat mezoit kitolti.
+ */
+int bwt_encode(Bwt_block *block, long data_len, Compressed_file *compressed_file, Node **tree) {
+    long primary_size = block->block_count * sizeof(long);
+    long tree_size = primary_size + alphabet_model_size(&block->model);
+    char *serialized = malloc(tree_size);
+    Symbol_sink *sink = calloc(1, sizeof(Symbol_sink));
+    int res = 0;
+    while (true) {
+        if (serialized == NULL || sink == NULL) {
+            res = MALLOC_ERROR;
+            break;
+        }
+        res = open_sink_output(sink, &block->model, data_len / 2 + 16);
+        if (res != 0) break;
+        memcpy(serialized, block->primary, primary_size);
+        serialize_alphabet_model(&block->model, serialized + primary_size);
+        res = put_runs(block->mtf, data_len, sink);
+        if (res != 0) break;
+
+        compressed_file->compressed_data = (char*)sink->out;
+        compressed_file->data_size = sink->bits;
+        compressed_file->huffman_tree = (Node*)serialized;
+        compressed_file->tree_size = tree_size;
+        *tree = (Node*)serialized;
+        sink->out = NULL;
+        serialized = NULL;
+        break;
+    }
+    if (sink != NULL) close_sink(sink);
+    free(sink);
+    free(serialized);
+    return res;
+}
+
+// Az inverz BWT: az utolso oszlopbol (last) es a primer indexbol hatulrol elore visszaepiti a reszblokkot.
+static int inverse_block(const unsigned char *last, int n, long primary, char *raw) {
+    if (primary < 0 || primary >= n) return DECOMPRESSION_ERROR;
+    int *next = malloc(n * sizeof(int));
+    if (next == NULL) return MALLOC_ERROR;
+    int starts[256] = {0};
+    for (int i = 0; i < n; i++) starts[last[i]]++;
+    for (int c = 0, total = 0; c < 256; c++) {
+        int count = starts[c];
+        starts[c] = total;
+        total += count;
+    }
+    for (int i = 0; i < n; i++) {
+        next[i] = starts[last[i]]++;
+    }
+    long row = primary;
+    for (int i = n - 1; i >= 0; i--) {
+        raw[i] = (char)last[row];
+        row = next[row];
+    }
+    free(next);
+    return 0;
+}
+
+/*
+ * A fa helyen allo primer indexek es fak alapjan visszaallitja a blokk raw_size bajtjat.
+ * Serult adat eseten DECOMPRESSION_ERROR-t ad.
+ */
+int bwt_decode(const char *tree, long tree_size, const unsigned char *in, long bit_count, char *raw, long raw_size) {
+    long block_count = block_count_of(raw_size);
+    long primary_size = block_count * sizeof(long);
+    if (primary_size > tree_size) return DECOMPRESSION_ERROR;
+    Alphabet_model model;
+    if (parse_alphabet_model(tree + primary_size, tree_size - primary_size, BWT_ALPHABETS, &model) != tree_size - primary_size) {
+        return DECOMPRESSION_ERROR;
+    }
+    unsigned char *last = malloc(raw_size < BWT_BLOCK_SIZE ? raw_size : BWT_BLOCK_SIZE);
+    if (last == NULL) return MALLOC_ERROR;
+
+    int res = 0;
+    long position = 0;
+    for (long b = 0; b < block_count && res == 0; b++) {
+        long start = b * BWT_BLOCK_SIZE;
+        int n = (int)(raw_size - start < BWT_BLOCK_SIZE ? raw_size - start : BWT_BLOCK_SIZE);
+        unsigned char list[256];
+        for (int c = 0; c < 256; c++) list[c] = (unsigned char)c;
+        int i = 0;
+        while (i < n) {
+            int symbol = read_alphabet_symbol(&model, BWT_SYMBOL, in, bit_count, &position);
+            if (symbol < 0) {
+                res = DECOMPRESSION_ERROR;
+                break;
+            }
+            if (symbol != 0) {
+                unsigned char value = list[symbol];
+                memmove(list + 1, list, symbol);
+                list[0] = value;
+                last[i++] = value;
+                continue;
+            }
+            long run = read_alphabet_value(&model, BWT_RUN, in, bit_count, &position);
+            if (run < 0 || run >= n - i) {
+                res = DECOMPRESSION_ERROR;
+                break;
+            }
+            memset(last + i, list[0], run + 1);
+            i += run + 1;
+        }
+        if (res != 0) break;
+        long primary;
+        memcpy(&primary, tree + b * sizeof(long), sizeof(long));
+        res = inverse_block(last, n, primary, raw + start);
+    }
+    free(last);
+    if (res != 0) return res;
+    return position == bit_count ? 0 : DECOMPRESSION_ERROR;
+}
@@ -0,0 +1,16 @@
+#ifndef BWT_H
+#define BWT_H
+
+#include "data_types.h"
+
+// A BWT reszblokk merete: a forgatasok rendezese negy, ennyi elemu int tombot foglal (a debugmalloc 1 MB-os korlatja alatt).
+#define BWT_BLOCK_SIZE 131072
+// A nullafutas-kodolas abecei: MTF ertek (a 0 egy nullafutast jelol), a futas hossza.
+#define BWT_ALPHABETS 2
+
+long bwt_estimate(const char *data, long data_len, Bwt_block *block);
+int bwt_encode(Bwt_block *block, long data_len, Compressed_file *compressed_file, Node **tree);
+void bwt_free(Bwt_block *block);
+int bwt_decode(const char *tree, long tree_size, const unsigned char *in, long bit_count, char *raw, long raw_size);
+
+#endif // BWT_H
@@ -0,0 +1,132 @@
+#include "chunk.h"
+#include "data_types.h"
+#include "hash.h"
+#include "debugmalloc.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+/*
+ * FastCDC maszkok: az atlagos meret elott szigorubb (tobb bit), utana megengedobb feltetellel vagunk,
+ * igy a darabok merete az atlag kore koncentralodik.
+ */
+static const uint64_t MASK_STRICT = 0x0003590703530000ULL;
+static const uint64_t MASK_LOOSE = 0x0000d90003530000ULL;
+
+static uint64_t gear[256];
+static bool gear_ready = false;
+
+// A gordulo hash tablajat determinisztikusan (splitmix64) tolti fel, hogy a vagasi pontok reprodukalhatok legyenek.
+static void init_gear(void) {
+    uint64_t state = 0x48554646ULL;
+    for (int i = 0; i < 256; i++) {
+        state += 0x9E3779B97F4A7C15ULL;
+        uint64_t z = state;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        gear[i] = z ^ (z >> 31);
+    }
+    gear_ready = true;
+}
+
+/*
+ * Megkeresi a kovetkezo tartalomfuggo vagasi pontot (FastCDC). Az eredmeny a darab hossza,
+ * amely CHUNK_MIN_SIZE es CHUNK_MAX_SIZE koze esik, kiveve ha a maradek adat ennel rovidebb.
+ */
+long find_chunk_boundary(const char *data, long data_len) {
+    if (!gear_ready) init_gear();
+    if (data_len <= CHUNK_MIN_SIZE) return data_len;
+    long limit = data_len > CHUNK_MAX_SIZE ? CHUNK_MAX_SIZE : data_len;
+    long normal = limit < CHUNK_AVG_SIZE ? limit : CHUNK_AVG_SIZE;
+
+    uint64_t fingerprint = 0;
+    long i = CHUNK_MIN_SIZE;
+    for (; i < normal; i++) {
+        fingerprint = (fingerprint << 1) + gear[(unsigned char)data[i]];
+        if ((fingerprint & MASK_STRICT) == 0) return i;
+    }
+    for (; i < limit; i++) {
+        fingerprint = (fingerprint << 1) + gear[(unsigned char)data[i]];
+        if ((fingerprint & MASK_LOOSE) == 0) return i;
+    }
+    return i;
+}
+
+// Az egyedi darabok hash tablajanak egy bejegyzese.
+typedef struct {
+    uint64_t hash;
+    char *data;
+    long size;
+    int id;
+} Chunk_entry;
+
+/*
+ * Feldarabolja az archivum nem ismetlodo fajljait, es a mar latott darabokra hivatkozast rogzit.
+ * Az egyedi darabok sorszamat a szerializacio sorrendjeben osztja ki, ahogy a kitomorito is latni fogja oket.
+ * A darabok a fajl adataba mutatnak, a fajlok tartalma megmarad. Siker eseten az ujrahasznalt darabok
+ * szamat, hiba eseten negativ kodot ad vissza.
+ */
+int chunk_archive(Directory_item *archive, int archive_size) {
+    int table_size = 1024;
+    int unique_count = 0;
+    int reused = 0;
+    Chunk_entry *table = calloc(table_size, sizeof(Chunk_entry));
+    if (table == NULL) return MALLOC_ERROR;
+
+    for (int i = 0; i < archive_size; i++) {
+        Directory_item *item = &archive[i];
+        if (item->is_dir || item->duplicate_of != 0 || item->in_base || item->file_size <= CHUNK_MIN_SIZE) continue;
+
+        int capacity = item->file_size / CHUNK_MIN_SIZE + 1;
+        item->chunks = malloc(capacity * sizeof(File_chunk));
+        if (item->chunks == NULL) {
+            free(table);
+            return MALLOC_ERROR;
+        }
+        item->chunk_count = 0;
+
+        long offset = 0;
+        while (offset < item->file_size) {
+            long size = find_chunk_boundary(item->file_data + offset, item->file_size - offset);
+            File_chunk chunk = {item->file_data + offset, size, -1};
+            uint64_t hash = hash_data(chunk.data, size);
+
+            /* A tablat ketszeres meretre noveljuk, ha a toltottseg eleri a felet. */
+            if (2 * (unique_count + 1) > table_size) {
+                int new_size = table_size * 2;
+                Chunk_entry *new_table = calloc(new_size, sizeof(Chunk_entry));
+                if (new_table == NULL) {
+                    free(table);
+                    return MALLOC_ERROR;
+                }
+                for (int j = 0; j < table_size; j++) {
+                    if (table[j].data == NULL) continue;
+                    int slot = table[j].hash & (new_size - 1);
+                    while (new_table[slot].data != NULL) slot = (slot + 1) & (new_size - 1);
+                    new_table[slot] = table[j];
+                }
+                free(table);
+                table = new_table;
+                table_size = new_size;
+            }
+
+            int slot = hash & (table_size - 1);
+            while (table[slot].data != NULL) {
+                if (table[slot].hash == hash && table[slot].size == size && memcmp(table[slot].data, chunk.data, size) == 0) {
+                    chunk.ref = table[slot].id;
+                    break;
+                }
+                slot = (slot + 1) & (table_size - 1);
+            }
+            if (chunk.ref == -1) {
+                table[slot] = (Chunk_entry){hash, chunk.data, size, unique_count++};
+            } else {
+                reused++;
+            }
+            item->chunks[item->chunk_count++] = chunk;
+            offset += size;
+        }
+    }
+    free(table);
+    return reused;
+}
@@ -0,0 +1,13 @@
+#ifndef CHUNK_H
+#define CHUNK_H
+
+#include "data_types.h"
+
+#define CHUNK_MIN_SIZE 2048
+#define CHUNK_AVG_SIZE 8192
+#define CHUNK_MAX_SIZE 65536
+
+long find_chunk_boundary(const char *data, long data_len);
+int chunk_archive(Directory_item *archive, int archive_size);
+
+#endif // CHUNK_H
@@ -0,0 +1,153 @@
+#include "cluster.h"
+#include "data_types.h"
+#include "debugmalloc.h"
+#include <math.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/*
+ * A csoport osszesitett gyakorisagaibol (simitva) kiszamolja a bajtok idealis kodhosszat bitekben.
+ */
+static void cluster_lengths(const long *sums, double *lengths) {
+    double total = 0;
+    for (int i = 0; i < 256; i++) {
+        total += sums[i] + CLUSTER_SMOOTHING;
+    }
+    for (int i = 0; i < 256; i++) {
+        lengths[i] = -log2((sums[i] + CLUSTER_SMOOTHING) / total);
+    }
+}
+
+// Az elem bajtjainak kodolasi koltsege bitekben a megadott kodhosszakkal.
+static double item_cost(const unsigned int *histogram, const double *lengths) {
+    double bits = 0;
+    for (int i = 0; i < 256; i++) {
+        bits += histogram[i] * lengths[i];
+    }
+    return bits;
+}
+
+// Az elem sajat eloszlasanak entropiaja bitekben (ennel kevesebbre egy fa sem kodolhatja), es a benne elofordulo bajtok szama.
+static double item_entropy(const unsigned int *histogram, int *leaf_count) {
+    double total = 0;
+    double bits = 0;
+    *leaf_count = 0;
+    for (int i = 0; i < 256; i++) {
+        if (histogram[i] == 0) continue;
+        (*leaf_count)++;
+        total += histogram[i];
+        bits -= histogram[i] * log2((double)histogram[i]);
+    }
+    return total > 0 ? bits + total * log2(total) : 0;
+}
+
+/*
+ * Az elemek hisztogramjait (item_count darab, egyenkent 256 szamlalo) legfeljebb max_clusters csoportba sorolja
+ * k-kozep modszerrel. A tavolsag a kodhossz-koltseg: hany bitre kodolodna az elem a csoport osszesitett eloszlasabol
+ * szamolt kodhosszakkal. A kezdo kozeppontokat a legtobbet veszto elem szerint valasztja (a legnagyobb elemtol indulva),
+ * es csak akkor nyit uj csoportot, ha az elem vesztesege a meglevo csoportokban meghaladja egy sajat fa tarolasi koltseget.
+ * Az assignment tombbe elemenkent a csoport sorszamat irja (az ures csoportok nelkul, elso elofordulas szerint szamozva),
+ * es a csoportok szamat adja vissza, hiba eseten negativ kodot.
+ */
+int cluster_histograms(const unsigned int *histograms, int item_count, int max_clusters, int *assignment) {
+    if (item_count <= 0) return 0;
+    if (max_clusters > CLUSTER_MAX) max_clusters = CLUSTER_MAX;
+    if (max_clusters < 1) max_clusters = 1;
+
+    long (*sums)[256] = malloc(max_clusters * sizeof(*sums));
+    double (*lengths)[256] = malloc(max_clusters * sizeof(*lengths));
+    if (sums == NULL || lengths == NULL) {
+        free(sums);
+        free(lengths);
+        return MALLOC_ERROR;
+    }
+    int cluster_count = 0;
+
+    /* Kezdo kozeppontok: a legnagyobb elem, majd mindig az, amelyet a meglevo csoportok a legrosszabbul kodolnanak. */
+    int first = 0;
+    long first_size = -1;
+    for (int i = 0; i < item_count; i++) {
+        long size = 0;
+        for (int j = 0; j < 256; j++) {
+            size += histograms[i * 256 + j];
+        }
+        if (size > first_size) {
+            first = i;
+            first_size = size;
+        }
+    }
+    int seed = first;
+    while (seed >= 0 && cluster_count < max_clusters) {
+        for (int j = 0; j < 256; j++) {
+            sums[cluster_count][j] = histograms[seed * 256 + j];
+        }
+        cluster_lengths(sums[cluster_count], lengths[cluster_count]);
+        cluster_count++;
+
+        seed = -1;
+        double worst_loss = 0;
+        for (int i = 0; i < item_count; i++) {
+            int leaf_count = 0;
+            double own_bits = item_entropy(&histograms[i * 256], &leaf_count);
+            double best = INFINITY;
+            for (int c = 0; c < cluster_count; c++) {
+                double bits = item_cost(&histograms[i * 256], lengths[c]);
+                if (bits < best) best = bits;
+            }
+            double loss = best - own_bits - (2.0 * leaf_count - 1) * sizeof(Node) * 8;
+            if (loss > worst_loss) {
+                worst_loss = loss;
+                seed = i;
+            }
+        }
+    }
+
+    /* Lloyd iteraciok: hozzarendeles a legolcsobb csoporthoz, majd a csoportok eloszlasanak ujraszamolasa. */
+    for (int i = 0; i < item_count; i++) {
+        assignment[i] = -1;
+    }
+    for (int iteration = 0; iteration < CLUSTER_ITERATIONS; iteration++) {
+        bool changed = false;
+        for (int i = 0; i < item_count; i++) {
+            int best_cluster = 0;
+            double best = INFINITY;
+            for (int c = 0; c < cluster_count; c++) {
+                double bits = item_cost(&histograms[i * 256], lengths[c]);
+                if (bits < best) {
+                    best = bits;
+                    best_cluster = c;
+                }
+            }
+            if (assignment[i] != best_cluster) {
+                assignment[i] = best_cluster;
+                changed = true;
+            }
+        }
+        if (!changed) break;
+        memset(sums, 0, cluster_count * sizeof(*sums));
+        for (int i = 0; i < item_count; i++) {
+            for (int j = 0; j < 256; j++) {
+                sums[assignment[i]][j] += histograms[i * 256 + j];
+            }
+        }
+        for (int c = 0; c < cluster_count; c++) {
+            cluster_lengths(sums[c], lengths[c]);
+        }
+    }
+
+    free(sums);
+    free(lengths);
+
+    /* Az ures csoportokat kihagyva, elso elofordulas szerint szamozzuk at a csoportokat. */
+    int renumber[CLUSTER_MAX];
+    for (int c = 0; c < CLUSTER_MAX; c++) {
+        renumber[c] = -1;
+    }
+    int used = 0;
+    for (int i = 0; i < item_count; i++) {
+        if (renumber[assignment[i]] < 0) renumber[assignment[i]] = used++;
+        assignment[i] = renumber[assignment[i]];
+    }
+    return used;
+}
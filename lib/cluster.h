@@ -0,0 +1,15 @@
+#ifndef CLUSTER_H
+#define CLUSTER_H
+
+#include "data_types.h"
+
+// A csoportok szamanak felso korlatja; a hivo ennel kevesebbet is kerhet.
+#define CLUSTER_MAX 64
+// A k-kozep iteraciok felso korlatja; altalaban hamarabb beall.
+#define CLUSTER_ITERATIONS 10
+// A csoport eloszlasabol szamolt kodhosszaknal minden bajt szamlalojahoz ennyit adunk, hogy a hianyzo bajtok koltsege is veges legyen.
+#define CLUSTER_SMOOTHING 0.5
+
+int cluster_histograms(const unsigned int *histograms, int item_count, int max_clusters, int *assignment);
+
+#endif // CLUSTER_H
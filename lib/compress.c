@@ -9,15 +9,31 @@
 #include "compress.h"
 #include "data_types.h"
 #include "directory.h"
+#include "adaptive.h"
+#include "tables.h"
+#include "dictionary.h"
+#include "cluster.h"
+#include "ans.h"
+#include "lz.h"
+#include "bwt.h"
+#include "alphabet.h"
+#include "filter.h"
+#include "wide.h"
+#include "words.h"
 #include "debugmalloc.h"
 
-// Segedfuggveny a qsort rendezeshez
+/*
+ * Segedfuggveny a qsort rendezeshez. Azonos gyakorisag eseten a bajt erteke dont, igy a rendezes
+ * (es a fa) a qsort megvalositasatol fuggetlenul ugyanaz; a beepitett tablak fait a dekodolo is ujraepiti.
+ */
 static int compare_nodes(const void *a, const void *b) {
     long freq_a = ((Node*)a)->frequency;
     long freq_b = ((Node*)b)->frequency;
     if (freq_a < freq_b) return -1;
     if (freq_a > freq_b) return 1;
-    return 0;
+    unsigned char data_a = ((Node*)a)->data;
+    unsigned char data_b = ((Node*)b)->data;
+    return (data_a > data_b) - (data_a < data_b);
 }
 
  // A nodes tombot gyakorisag alapjan rendezi, hogy a Huffman fa felepitese konnyebb legyen.
@@ -30,12 +46,20 @@ void sort_nodes(Node *nodes, int len) {
  * 0-val ter vissza, miutan minden bajtot feldolgozott. A hivotol kapott frequencies tomb nullazott kell legyen.
  */
 int count_frequencies(char *data, long data_len, long *frequencies) {
-    for (int i = 0; i < data_len; i++){
+    for (long i = 0; i < data_len; i++){
         frequencies[(unsigned char) data[i]] += 1;
     }
     return 0;
 }
 
+// A count_frequencies szeletenkenti valtozata, az osszes szelet bajtjait egy tombbe szamolja.
+int count_segment_frequencies(Data_segment *segments, int segment_count, long *frequencies) {
+    for (int i = 0; i < segment_count; i++) {
+        count_frequencies(segments[i].data, segments[i].size, frequencies);
+    }
+    return 0;
+}
+
 /*
  * Elkesziti a kimeneti fajl nevet: ha van kiterjesztes, kicsereli .huff-ra, kulonben hozzaadja.
  * Siker eseten lefoglalt karakterlancot ad vissza, hiba eseten NULL-t.
@@ -181,13 +205,31 @@ char* find_leaf(char leaf, Node *nodes, Node *root_node) {
  * 0-t ad vissza siker eseten, negativ ertekeket memoriafoglalasi vagy fa-bejarasi hiba eseten.
  */
 int compress(char *original_data, long data_len, Node *nodes, Node *root_node, char** cache, Compressed_file *compressed_file) {
+    Data_segment segment = {original_data, data_len};
+    return compress_segments(&segment, 1, nodes, root_node, cache, compressed_file);
+}
+
+/*
+ * A szeleteket sorban, egyetlen bitfolyamkent kodolja. Ha limit 0, a kimeneti buffer szukseg szerint no; kulonben
+ * legfeljebb limit bajtos lehet, es ha a kodolt adat nem fer bele, a kodolast abbahagyja, es OUTPUT_LIMIT-et ad
+ * vissza (a compressed_data ekkor NULL).
+ */
+static int encode_segments(Data_segment *segments, int segment_count, Node *nodes, Node *root_node, char** cache, long limit, Compressed_file *compressed_file) {
+    long data_len = 0;
+    for (int s = 0; s < segment_count; s++) {
+        data_len += segments[s].size;
+    }
+
     if (data_len == 0) {
         compressed_file->data_size = 0;
         compressed_file->compressed_data = NULL;
         return 0;
     }
 
-    compressed_file->compressed_data = malloc(data_len * sizeof(char));
+    /* A kimenet altalaban kisebb a bemenetnel, de egy nem az adatbol epult fa (pl. beepitett tabla)
+     * hosszabb kodokat is adhat, ezert a buffert szukseg eseten noveljuk, ha nincs korlat. */
+    long capacity = limit > 0 ? limit : data_len;
+    compressed_file->compressed_data = malloc(capacity * sizeof(char));
     if (compressed_file->compressed_data == NULL) {
         compressed_file->data_size = 0;
         return MALLOC_ERROR;
@@ -197,35 +239,72 @@ int compress(char *original_data, long data_len, Node *nodes, Node *root_node, c
     unsigned char buffer = 0;
     int bit_count = 0;
 
-    for (long i = 0; i < data_len; i++) {
-        char *path = check_cache(original_data[i], cache);
-        if (path == NULL) {
-            path = find_leaf(original_data[i], nodes, root_node);
-            if (path != NULL) {
-                cache[(unsigned char)original_data[i]] = path;
-            } else {
-                free(compressed_file->compressed_data);
-                compressed_file->compressed_data = NULL;
-                compressed_file->data_size = 0;
-                return TREE_ERROR;
+    for (int s = 0; s < segment_count; s++) {
+        char *original_data = segments[s].data;
+        for (long i = 0; i < segments[s].size; i++) {
+            char *path = check_cache(original_data[i], cache);
+            if (path == NULL) {
+                path = find_leaf(original_data[i], nodes, root_node);
+                if (path != NULL) {
+                    cache[(unsigned char)original_data[i]] = path;
+                } else {
+                    free(compressed_file->compressed_data);
+                    compressed_file->compressed_data = NULL;
+                    compressed_file->data_size = 0;
+                    return TREE_ERROR;
+                }
             }
-        }
 
-        for (int j = 0; path[j] != '\0'; j++) {
-            if (path[j] == '1') {
-                buffer |= (1 << (7 - bit_count));
-            }
-            bit_count++;
-            if (bit_count == 8) {
-                compressed_file->compressed_data[total_bits / 8] = buffer;
-                total_bits += 8;
-                buffer = 0;
-                bit_count = 0;
+            for (int j = 0; path[j] != '\0'; j++) {
+                if (path[j] == '1') {
+                    buffer |= (1 << (7 - bit_count));
+                }
+                bit_count++;
+                if (bit_count == 8) {
+                    if (total_bits / 8 == capacity && limit > 0) {
+                        free(compressed_file->compressed_data);
+                        compressed_file->compressed_data = NULL;
+                        compressed_file->data_size = 0;
+                        return OUTPUT_LIMIT;
+                    }
+                    if (total_bits / 8 == capacity) {
+                        char *grown = realloc(compressed_file->compressed_data, capacity * 2);
+                        if (grown == NULL) {
+                            free(compressed_file->compressed_data);
+                            compressed_file->compressed_data = NULL;
+                            compressed_file->data_size = 0;
+                            return MALLOC_ERROR;
+                        }
+                        compressed_file->compressed_data = grown;
+                        capacity *= 2;
+                    }
+                    compressed_file->compressed_data[total_bits / 8] = buffer;
+                    total_bits += 8;
+                    buffer = 0;
+                    bit_count = 0;
+                }
             }
         }
     }
 
     if (bit_count > 0) {
+        if (total_bits / 8 == capacity && limit > 0) {
+            free(compressed_file->compressed_data);
+            compressed_file->compressed_data = NULL;
+            compressed_file->data_size = 0;
+            return OUTPUT_LIMIT;
+        }
+        if (total_bits / 8 == capacity) {
+            char *grown = realloc(compressed_file->compressed_data, capacity + 1);
+            if (grown == NULL) {
+                free(compressed_file->compressed_data);
+                compressed_file->compressed_data = NULL;
+                compressed_file->data_size = 0;
+                return MALLOC_ERROR;
+            }
+            compressed_file->compressed_data = grown;
+            capacity++;
+        }
         compressed_file->compressed_data[total_bits / 8] = buffer;
         total_bits += bit_count;
     }
@@ -234,6 +313,12 @@ int compress(char *original_data, long data_len, Node *nodes, Node *root_node, c
      * ezert nem keletkezne egyetlen bit sem. Minden karakterhez irunk
      * egy 0 bitet, hogy a hosszt taroljuk. */
     if (total_bits == 0 && data_len > 0) {
+        if ((data_len + 7) / 8 > capacity) {
+            free(compressed_file->compressed_data);
+            compressed_file->compressed_data = NULL;
+            compressed_file->data_size = 0;
+            return OUTPUT_LIMIT;
+        }
         buffer = 0;
         bit_count = 0;
         for (long i = 0; i < data_len; i++) {
@@ -263,6 +348,14 @@ int compress(char *original_data, long data_len, Node *nodes, Node *root_node, c
     return 0;
 }
 
+/*
+ * A compress szeletenkenti valtozata: a szeleteket sorban, egyetlen bitfolyamkent kodolja,
+ * igy a bemenetet nem kell elotte egy osszefuggo bufferbe masolni.
+ */
+int compress_segments(Data_segment *segments, int segment_count, Node *nodes, Node *root_node, char** cache, Compressed_file *compressed_file) {
+    return encode_segments(segments, segment_count, nodes, root_node, cache, 0, compressed_file);
+}
+
 /*
  * A mar elokeszitett nyers adatot felhasznalva felepit egy Huffman fat es kiirja a tomoritett adatot.
  * A hivas elott gondoskodni kell a nyers adat eloallitasarol (fajl beolvasas, mappa szerializacio).
@@ -270,6 +363,1065 @@ int compress(char *original_data, long data_len, Node *nodes, Node *root_node, c
  * negativ hibakodot ad vissza.
  */
 int run_compression(Arguments args, char *data, long data_len, long directory_size) {
+    Data_segment segment = {data, data_len};
+    return run_compression_segments(args, &segment, 1, directory_size);
+}
+
+/*
+ * Felveszi a fat a history legujabb elemekent; a fa a history tulajdonaba kerul. Ha a tar megtelt,
+ * a legregebbi fat felszabaditja.
+ */
+void push_tree_history(Tree_history *history, Node *tree, long tree_size) {
+    history->newest = (history->newest + 1) % TREE_HISTORY_SIZE;
+    if (history->count == TREE_HISTORY_SIZE) {
+        free(history->trees[history->newest]);
+    } else {
+        history->count++;
+    }
+    history->trees[history->newest] = tree;
+    history->tree_sizes[history->newest] = tree_size;
+}
+
+// A legujabbhoz kepest distance-szel korabbi fat adja vissza (a meretevel egyutt), vagy NULL-t, ha nincs ilyen.
+Node* get_history_tree(Tree_history *history, int distance, long *tree_size) {
+    if (distance < 0 || distance >= history->count) return NULL;
+    int index = (history->newest - distance + TREE_HISTORY_SIZE) % TREE_HISTORY_SIZE;
+    *tree_size = history->tree_sizes[index];
+    return history->trees[index];
+}
+
+void free_tree_history(Tree_history *history) {
+    for (int i = 0; i < history->count; i++) {
+        long tree_size = 0;
+        free(get_history_tree(history, i, &tree_size));
+    }
+    history->count = 0;
+}
+
+/*
+ * A gyakorisagokbol rendezett leveleket, majd Huffman fat epit a lefoglalt nodes tombben.
+ * A levelek szamat adja vissza (0, ha nincs adat), hiba eseten negativ kodot.
+ */
+long build_tree(long *frequencies, Node **nodes, Node **root_node) {
+    *nodes = NULL;
+    *root_node = NULL;
+    long leaf_count = 0;
+    for (int i = 0; i < 256; i++) {
+        if (frequencies[i] != 0) {
+            leaf_count++;
+        }
+    }
+    if (leaf_count == 0) return 0;
+
+    *nodes = malloc((2 * leaf_count - 1) * sizeof(Node));
+    if (*nodes == NULL) return MALLOC_ERROR;
+    int j = 0;
+    for (int i = 0; i < 256; i++) {
+        if (frequencies[i] != 0) {
+            (*nodes)[j] = construct_leaf(frequencies[i], (char)i);
+            j++;
+        }
+    }
+    sort_nodes(*nodes, leaf_count);
+    *root_node = construct_tree(*nodes, leaf_count);
+    if (*root_node == NULL) {
+        free(*nodes);
+        *nodes = NULL;
+        return TREE_ERROR;
+    }
+    return leaf_count;
+}
+
+// Rekurzivan kitolti a levelek kodhosszat (a melyseguket) a bajt szerint indexelt lengths tombben.
+static void code_lengths(Node *nodes, Node *node, int depth, int *lengths) {
+    if (node->type == LEAF) {
+        lengths[(unsigned char)node->data] = depth;
+        return;
+    }
+    code_lengths(nodes, &nodes[node->left], depth + 1, lengths);
+    code_lengths(nodes, &nodes[node->right], depth + 1, lengths);
+}
+
+/*
+ * Kodolas nelkul, csak a gyakorisagokbol megadja, hany bitre kodolna a compress az adatot a megadott faval.
+ * -1-et ad vissza, ha egy elofordulo bajt nem szerepel a faban. Egyetlen levelu fanal a compress bajtonkent egy bitet ir.
+ */
+long tree_cost(Node *nodes, Node *root_node, long *frequencies) {
+    int lengths[256] = {0};
+    if (root_node->type == LEAF) {
+        lengths[(unsigned char)root_node->data] = 1;
+    } else {
+        code_lengths(nodes, root_node, 0, lengths);
+    }
+    long bits = 0;
+    for (int i = 0; i < 256; i++) {
+        if (frequencies[i] == 0) continue;
+        if (lengths[i] == 0) return -1;
+        bits += frequencies[i] * lengths[i];
+    }
+    return bits;
+}
+
+// Kiir egy (bajt, varint hossz) part az out bufferbe (ha nem NULL), es visszaadja a hosszat bajtokban.
+static long emit_run(char *out, unsigned char value, long run) {
+    long size = 0;
+    if (out != NULL) out[size] = (char)value;
+    size++;
+    while (true) {
+        if (out != NULL) out[size] = (char)((run & 0x7F) | (run >= 0x80 ? 0x80 : 0));
+        size++;
+        if (run < 0x80) break;
+        run >>= 7;
+    }
+    return size;
+}
+
+/*
+ * Futashossz-kodolja a szeleteket (bajt, varint hossz) parokka; a futasok a szeletek hataran is atnyulnak.
+ * Ha out NULL, csak a kodolt meretet szamolja ki. A kodolt bajtok szamat adja vissza.
+ */
+static long rle_encode(Data_segment *segments, int segment_count, char *out) {
+    long size = 0;
+    long run = 0;
+    unsigned char value = 0;
+    for (int s = 0; s < segment_count; s++) {
+        for (long i = 0; i < segments[s].size; i++) {
+            unsigned char current = (unsigned char)segments[s].data[i];
+            if (run > 0 && current == value) {
+                run++;
+                continue;
+            }
+            if (run > 0) size += emit_run(out != NULL ? out + size : NULL, value, run);
+            value = current;
+            run = 1;
+        }
+    }
+    if (run > 0) size += emit_run(out != NULL ? out + size : NULL, value, run);
+    return size;
+}
+
+/*
+ * Egymast koveto darabok csoportja: a kis darabok a kovetkezo nagy (legalabb STORED_SEGMENT_MIN meretu) darabhoz
+ * tartoznak, a csoport a nagy darabbal, egy oszlop elott vagy a bemenet vegen zarul. A blokkhatarok csoporthatarra
+ * esnek, ezert a gyakorisagokat csoportonkent egyszer szamoljuk meg, es a besorolas, a vagas, a mappak csoportositasa
+ * es a blokk fajanak epitese is ezekbol dolgozik. A frequencies NULL, ha nem szamoltunk (--fast, --table, --dict).
+ */
+typedef struct {
+    int first;
+    int end;
+    long size;
+    long *frequencies;
+} Piece_group;
+
+// Igaz, ha a csoport nagy darabbal zarul (a csoport utolso darabja legalabb STORED_SEGMENT_MIN meretu).
+static bool group_is_large(Data_segment *pieces, Piece_group *group) {
+    return pieces[group->end - 1].size >= STORED_SEGMENT_MIN;
+}
+
+static void free_piece_groups(Piece_group *groups, int group_count) {
+    if (groups == NULL) return;
+    for (int i = 0; i < group_count; i++) {
+        free(groups[i].frequencies);
+    }
+    free(groups);
+}
+
+/*
+ * Csoportokba fogja a darabokat; column_start eseten az oszlopok elso darabjanal is uj csoport kezdodik. count eseten
+ * a darabokat egyetlen menetben a csoportjuk gyakorisagaiba szamolja. A tombot a hivo a free_piece_groups fuggvennyel
+ * szabaditja fel. Hiba eseten NULL-t ad vissza.
+ */
+static Piece_group* group_pieces(Data_segment *pieces, int piece_count, bool *column_start, bool count, int *group_count) {
+    Piece_group *groups = malloc((piece_count > 0 ? piece_count : 1) * sizeof(Piece_group));
+    if (groups == NULL) return NULL;
+    int current = 0;
+    for (int i = 0; i < piece_count; i++) {
+        if (i == 0 || pieces[i - 1].size >= STORED_SEGMENT_MIN || (column_start != NULL && column_start[i])) {
+            groups[current].first = i;
+            groups[current].size = 0;
+            groups[current].frequencies = NULL;
+            current++;
+        }
+        groups[current - 1].end = i + 1;
+        groups[current - 1].size += pieces[i].size;
+    }
+    *group_count = current;
+    for (int g = 0; count && g < current; g++) {
+        groups[g].frequencies = calloc(256, sizeof(long));
+        if (groups[g].frequencies == NULL) {
+            free_piece_groups(groups, current);
+            return NULL;
+        }
+        count_segment_frequencies(&pieces[groups[g].first], groups[g].end - groups[g].first, groups[g].frequencies);
+    }
+    return groups;
+}
+
+/*
+ * Besorolja egy nagy darabbal zarulo csoport tartalmat: BLOCK_RLE, ha a futashossz-kodolas bajtonkent egy bitnel kevesebbet
+ * igenyel (ezt a Huffman kod nem tudja alulmulni), BLOCK_STORED, ha tomorithetetlen (mar tomoritett, titkositott
+ * vagy kozel egyenletes eloszlasu adat), kulonben BLOCK_HUFFMAN. A nyereseget sajat faval becsuli, kodolast nem vegez.
+ */
+static unsigned char classify_group(Data_segment *pieces, Piece_group *group) {
+    if (rle_encode(&pieces[group->first], group->end - group->first, NULL) < group->size / 8) return BLOCK_RLE;
+    Node *nodes = NULL;
+    Node *root_node = NULL;
+    if (build_tree(group->frequencies, &nodes, &root_node) <= 0) return BLOCK_HUFFMAN;
+    long encoded_size = (tree_cost(nodes, root_node, group->frequencies) + 7) / 8;
+    free(nodes);
+    return group->size - encoded_size < group->size / STORED_MIN_GAIN_DIVISOR ? BLOCK_STORED : BLOCK_HUFFMAN;
+}
+
+/*
+ * Kiszamolja, milyen blokkba keruljenek a csoportok. Csak a nagy darabbal zarulo csoportokat vizsgalja, a tobbiek
+ * (pl. a mappa bejegyzesek fejlecei egy kis fajl utan) a kovetkezo nagy csoport besorolasahoz csatlakoznak,
+ * hogy ne keletkezzenek apro, kulon fat igenylo blokkok. A lefoglalt tombot a hivo szabaditja fel.
+ */
+static unsigned char* classify_groups(Data_segment *pieces, Piece_group *groups, int group_count) {
+    unsigned char *block_class = calloc(group_count > 0 ? group_count : 1, sizeof(unsigned char));
+    if (block_class == NULL) return NULL;
+    unsigned char next_class = BLOCK_HUFFMAN;
+    bool seen_large = false;
+    for (int i = group_count - 1; i >= 0; i--) {
+        if (group_is_large(pieces, &groups[i])) {
+            next_class = classify_group(pieces, &groups[i]);
+            seen_large = true;
+        }
+        block_class[i] = next_class;
+    }
+    /* A legutolso nagy csoport utani kis csoportok az elozo besorolast kovetik. */
+    if (seen_large) {
+        int last = group_count - 1;
+        while (!group_is_large(pieces, &groups[last])) last--;
+        for (int i = last + 1; i < group_count; i++) {
+            block_class[i] = block_class[last];
+        }
+    }
+    return block_class;
+}
+
+// Hany helyen kulonbozik egy bajt az elozotol (a futasok szama ennel eggyel tobb).
+static long count_changes(const char *data, long len) {
+    long changes = 0;
+    for (long i = 1; i < len; i++) {
+        if (data[i] != data[i - 1]) changes++;
+    }
+    return changes;
+}
+
+// Igaz, ha a szeletek minden bajtja value.
+static bool segments_constant(Data_segment *segments, int segment_count, char value) {
+    for (int s = 0; s < segment_count; s++) {
+        for (long i = 0; i < segments[s].size; i++) {
+            if (segments[s].data[i] != value) return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * A --fast mod gyakorisagai: a szeletek osszefuzott tartalmabol FAST_SAMPLE_STRIDE bajtonkent egy FAST_SAMPLE_RUN
+ * hosszu reszletet szamol meg (kis bemenetnel mindent), majd minden bajterteket 1-gyel simit, hogy a mintabol
+ * hianyzo bajtoknak is legyen kodjuk. A mintabol a teljes hosszra vetitett futasszamot adja vissza.
+ */
+static long sample_frequencies(Data_segment *segments, int segment_count, long *frequencies) {
+    long data_len = 0;
+    for (int i = 0; i < segment_count; i++) {
+        data_len += segments[i].size;
+    }
+    long scale = 1;
+    long changes = 0;
+    if (data_len <= FAST_SAMPLE_MIN) {
+        count_segment_frequencies(segments, segment_count, frequencies);
+        for (int i = 0; i < segment_count; i++) {
+            changes += count_changes(segments[i].data, segments[i].size);
+        }
+    } else {
+        /* A mintat a teljes hosszra vetitjuk, igy a simitas csak a mintabol hianyzo bajtokra szamit erdemben. */
+        scale = FAST_SAMPLE_STRIDE / FAST_SAMPLE_RUN;
+        long offset = 0;
+        long next_sample = 0;
+        for (int i = 0; i < segment_count; i++) {
+            while (next_sample < offset + segments[i].size) {
+                long start = next_sample - offset;
+                long run = segments[i].size - start < FAST_SAMPLE_RUN ? segments[i].size - start : FAST_SAMPLE_RUN;
+                count_frequencies(segments[i].data + start, run, frequencies);
+                changes += count_changes(segments[i].data + start, run);
+                next_sample += FAST_SAMPLE_STRIDE;
+            }
+            offset += segments[i].size;
+        }
+    }
+    for (int i = 0; i < 256; i++) {
+        frequencies[i] = frequencies[i] * scale + 1;
+    }
+    return changes * scale + 1;
+}
+
+// A megadott faval Huffman kodolja a szeleteket a compressed_file strukturaba (limit > 0 eseten legfeljebb limit bajtra).
+static int encode_huffman(Data_segment *segments, int segment_count, Node *nodes, Node *root_node, long limit, Compressed_file *compressed_file) {
+    char **cache = calloc(256, sizeof(char *));
+    if (cache == NULL) return MALLOC_ERROR;
+    int compress_res = encode_segments(segments, segment_count, nodes, root_node, cache, limit, compressed_file);
+    for (int i = 0; i < 256; ++i) {
+        free(cache[i]);
+    }
+    free(cache);
+    return compress_res;
+}
+
+/*
+ * Tarolt fa nelkuli, elore ismert kod: beepitett tabla vagy kulso szotar. A blokk fejleceben a fa helyen
+ * az id bajtjai allnak, ezekbol a dekodolo ugyanezt a fat allitja elo.
+ */
+typedef struct {
+    Block_type type;
+    Node *nodes;
+    Node *root_node;
+    unsigned char id[DICTIONARY_HASH_SIZE];
+    long id_size;
+} Static_code;
+
+/*
+ * Elkesziti a beepitett tabla kodjat. Ervenytelen azonosito eseten TREE_ERROR-t ad vissza.
+ */
+static int table_code(int table_id, Static_code *code) {
+    code->type = BLOCK_TABLE;
+    code->id[0] = (unsigned char)table_id;
+    code->id_size = 1;
+    return get_static_tree(table_id, &code->nodes, &code->root_node);
+}
+
+/*
+ * Rendu-1 kontextusmodell: az elozo bajt minden ertekehez egy osztaly (bucket_of), osztalyonkent egy Huffman fa.
+ * Az ures osztaly fa nelkuli (nodes NULL).
+ */
+typedef struct {
+    unsigned char bucket_of[256];
+    int bucket_count;
+    Node *nodes[CONTEXT_BUCKETS];
+    Node *roots[CONTEXT_BUCKETS];
+    long node_counts[CONTEXT_BUCKETS];
+} Context_model;
+
+static void free_context_model(Context_model *model) {
+    for (int b = 0; b < model->bucket_count; b++) {
+        free(model->nodes[b]);
+    }
+    model->bucket_count = 0;
+}
+
+/*
+ * Felepiti a blokk kontextusmodelljet: kontextusonkent (elozo bajt szerint) megszamolja a bajtokat, a 256 hisztogramot
+ * cluster_histograms legfeljebb CONTEXT_BUCKETS osztalyba sorolja, majd osztalyonkent fat epit. Visszaadja a kodolt
+ * blokk becsult meretet bajtokban (a fak es az osztalytabla tarolasaval egyutt), hiba eseten negativ kodot.
+ */
+static long build_context_model(Data_segment *segments, int segment_count, Context_model *model) {
+    model->bucket_count = 0;
+    unsigned int *histograms = calloc(256 * 256, sizeof(unsigned int));
+    int *assignment = malloc(256 * sizeof(int));
+    if (histograms == NULL || assignment == NULL) {
+        free(histograms);
+        free(assignment);
+        return MALLOC_ERROR;
+    }
+    unsigned char previous = 0;
+    for (int s = 0; s < segment_count; s++) {
+        for (long i = 0; i < segments[s].size; i++) {
+            unsigned char current = (unsigned char)segments[s].data[i];
+            histograms[previous * 256 + current]++;
+            previous = current;
+        }
+    }
+    int bucket_count = cluster_histograms(histograms, 256, CONTEXT_BUCKETS, assignment);
+    if (bucket_count < 0) {
+        free(histograms);
+        free(assignment);
+        return bucket_count;
+    }
+
+    long bucket_frequencies[CONTEXT_BUCKETS][256] = {{0}};
+    for (int c = 0; c < 256; c++) {
+        model->bucket_of[c] = (unsigned char)assignment[c];
+        for (int i = 0; i < 256; i++) {
+            bucket_frequencies[assignment[c]][i] += histograms[c * 256 + i];
+        }
+    }
+    free(histograms);
+    free(assignment);
+
+    long size = 256;
+    long bits = 0;
+    for (int b = 0; b < bucket_count; b++) {
+        long leaf_count = build_tree(bucket_frequencies[b], &model->nodes[b], &model->roots[b]);
+        if (leaf_count < 0) {
+            free_context_model(model);
+            return leaf_count;
+        }
+        model->bucket_count++;
+        model->node_counts[b] = leaf_count > 0 ? (model->roots[b] - model->nodes[b]) + 1 : 0;
+        size += sizeof(long) + model->node_counts[b] * sizeof(Node);
+        /* Az egyetlen bajtot tartalmazo osztaly bajtjai nem igenyelnek bitet. */
+        if (leaf_count > 1) bits += tree_cost(model->nodes[b], model->roots[b], bucket_frequencies[b]);
+    }
+    return size + (bits + 7) / 8;
+}
+
+/*
+ * A kontextusmodellel kodolja a blokkot: minden bajt kodjat az elozo bajt osztalyanak fajabol veszi. A fa helyere
+ * irando osztalytablat es fakat a tree kimenetbe szerializalja (a hivo szabaditja fel).
+ */
+static int encode_context(Data_segment *segments, int segment_count, Context_model *model, Compressed_file *compressed_file, Node **tree) {
+    long tree_size = 256;
+    for (int b = 0; b < model->bucket_count; b++) {
+        tree_size += sizeof(long) + model->node_counts[b] * sizeof(Node);
+    }
+    char *serialized = malloc(tree_size);
+    char **cache = calloc(model->bucket_count * 256, sizeof(char *));
+    long capacity = 1;
+    for (int s = 0; s < segment_count; s++) {
+        capacity += segments[s].size;
+    }
+    char *out = malloc(capacity);
+    int res = 0;
+
+    while (true) {
+        if (serialized == NULL || cache == NULL || out == NULL) {
+            res = MALLOC_ERROR;
+            break;
+        }
+        memcpy(serialized, model->bucket_of, 256);
+        long offset = 256;
+        for (int b = 0; b < model->bucket_count; b++) {
+            memcpy(serialized + offset, &model->node_counts[b], sizeof(long));
+            offset += sizeof(long);
+            if (model->node_counts[b] > 0) memcpy(serialized + offset, model->nodes[b], model->node_counts[b] * sizeof(Node));
+            offset += model->node_counts[b] * sizeof(Node);
+        }
+
+        long total_bits = 0;
+        unsigned char previous = 0;
+        for (int s = 0; s < segment_count && res == 0; s++) {
+            for (long i = 0; i < segments[s].size; i++) {
+                int bucket = model->bucket_of[previous];
+                unsigned char current = (unsigned char)segments[s].data[i];
+                char **path = &cache[bucket * 256 + current];
+                if (*path == NULL && model->nodes[bucket] != NULL) {
+                    *path = find_leaf((char)current, model->nodes[bucket], model->roots[bucket]);
+                }
+                if (*path == NULL) {
+                    res = TREE_ERROR;
+                    break;
+                }
+                for (int j = 0; (*path)[j] != '\0'; j++) {
+                    if (total_bits / 8 + 1 >= capacity) {
+                        char *grown = realloc(out, capacity * 2);
+                        if (grown == NULL) {
+                            res = MALLOC_ERROR;
+                            break;
+                        }
+                        out = grown;
+                        capacity *= 2;
+                    }
+                    if (total_bits % 8 == 0) out[total_bits / 8] = 0;
+                    if ((*path)[j] == '1') out[total_bits / 8] |= (char)(1 << (7 - total_bits % 8));
+                    total_bits++;
+                }
+                if (res != 0) break;
+                previous = current;
+            }
+        }
+        if (res != 0) break;
+
+        compressed_file->compressed_data = out;
+        compressed_file->data_size = total_bits;
+        compressed_file->huffman_tree = (Node*)serialized;
+        compressed_file->tree_size = tree_size;
+        *tree = (Node*)serialized;
+        out = NULL;
+        serialized = NULL;
+        break;
+    }
+
+    if (cache != NULL) {
+        for (int i = 0; i < model->bucket_count * 256; i++) {
+            free(cache[i]);
+        }
+    }
+    free(cache);
+    free(out);
+    free(serialized);
+    return res;
+}
+
+/*
+ * Egy blokknyi szeletet kodol a compressed_file strukturaba. A kodolast proba-kodolas nelkul, a blokk
+ * gyakorisagaibol becsult kimeneti meret alapjan valasztja: konstans (egyetlen egyedi bajt), Huffman uj faval
+ * (a fa merete is beszamit), Huffman az elozo blokk fajaval (ha minden elofordulo bajtot tartalmaz), RLE
+ * (a futasok szamlalasaval), beepitett kodtabla vagy tarolt blokk. A korabbi faknal a legutobbit fa nelkul, a history
+ * tobbi fajat egy bajtos hivatkozassal hasznalhatja. A block_frequencies a blokk elore megszamolt gyakorisagai
+ * (NULL eseten itt szamoljuk meg). Ha tree_frequencies adott (a blokk csoportjanak osszesitett
+ * gyakorisagai), az uj fat abbol epiti, hogy a csoport kesobbi blokkjai is hivatkozhassanak ra. force_stored eseten becsles nelkul tarolt blokkot ir,
+ * --context eseten a rendu-1 kontextusos, --ans eseten a tANS, --lz eseten az LZ77 elofeldolgozast, --bwt eseten a Burrows-Wheeler transzformaciot, --wide eseten a 16 bites szimbolumokat, --words eseten a szavas kodolast is merlegeli, --fast eseten a fat mintabol epiti, es az uj faju Huffman es a tarolt blokk mellett
+ * csak a konstans es az RLE blokkot merlegeli (ezeket is csak akkor, ha a minta egyetlen bajtot vagy keves futast mutat), forced (--table vagy
+ * --dict) eseten szamlalas nelkul az adott koddal kodol.
+ * Uj faju Huffman blokk eseten a fa, tabla es szotar eseten az azonosito a nodes kimenetben marad, ezt a hivo szabaditja fel.
+ */
+static int encode_block(Data_segment *segments, int segment_count, bool force_stored, Arguments args, const Static_code *forced, long *block_frequencies, long *tree_frequencies, Tree_history *history, Compressed_file *compressed_file, Node **nodes) {
+    long data_len = 0;
+    for (int i = 0; i < segment_count; i++) {
+        data_len += segments[i].size;
+    }
+    *nodes = NULL;
+
+    Block_type choice = BLOCK_STORED;
+    long best_size = data_len;
+    Node *root_node = NULL;
+    long tree_size = 0;
+    char constant = 0;
+    int reuse_distance = 0;
+    Context_model context = {0};
+    unsigned short normalized[256];
+    Alphabet_model lz_model = {0};
+    Bwt_block bwt_block = {0};
+    Canonical_code wide_code = {0};
+    Words_model words_model = {0};
+    char *block_data = NULL;
+    Static_code best_table;
+    const Static_code *code = forced;
+    if (!force_stored && forced != NULL) {
+        /* Megadott tabla vagy szotar eseten nem szamolunk; ha a kodolt adat megsem kisebb, tarolt blokk lesz belole. */
+        choice = forced->type;
+    } else if (!force_stored) {
+        long frequencies[256] = {0};
+        long sampled_runs = 0;
+        if (args.fast) {
+            sampled_runs = sample_frequencies(segments, segment_count, frequencies);
+        } else if (block_frequencies != NULL) {
+            memcpy(frequencies, block_frequencies, sizeof(frequencies));
+        } else {
+            count_segment_frequencies(segments, segment_count, frequencies);
+        }
+        long leaf_count = build_tree(frequencies, nodes, &root_node);
+        if (leaf_count < 0) return leaf_count;
+        if (!args.fast && leaf_count > 1 && tree_frequencies != NULL) {
+            free(*nodes);
+            if (build_tree(tree_frequencies, nodes, &root_node) < 0) return TREE_ERROR;
+        }
+
+        if (args.fast) {
+            /* A mintabol becsult bitszamot a blokk teljes hosszara aranyositjuk. A konstans es a futashossz-kodolt
+             * blokkot csak akkor merjuk meg (egy olvaso menettel), ha a minta szerint eselyes. */
+            long sample_total = 0;
+            int seen = 0;
+            char seen_byte = 0;
+            for (int i = 0; i < 256; i++) {
+                sample_total += frequencies[i];
+                if (frequencies[i] > 1) {
+                    seen++;
+                    seen_byte = (char)i;
+                }
+            }
+            tree_size = ((root_node - *nodes) + 1) * sizeof(Node);
+            double bits_per_byte = (double)tree_cost(*nodes, root_node, frequencies) / sample_total;
+            long fresh_size = (long)(bits_per_byte * data_len / 8) + tree_size;
+            if (fresh_size < best_size) {
+                choice = BLOCK_HUFFMAN;
+                best_size = fresh_size;
+            }
+            if (seen == 1 && segments_constant(segments, segment_count, seen_byte)) {
+                choice = BLOCK_CONSTANT;
+                best_size = 1;
+                constant = seen_byte;
+            } else if (2 * sampled_runs < best_size) {
+                long run_size = rle_encode(segments, segment_count, NULL);
+                if (run_size < best_size) {
+                    choice = BLOCK_RLE;
+                    best_size = run_size;
+                }
+            }
+        } else if (leaf_count == 1) {
+            choice = BLOCK_CONSTANT;
+            best_size = 1;
+            constant = root_node->data;
+        } else {
+            tree_size = ((root_node - *nodes) + 1) * sizeof(Node);
+            long fresh_size = (tree_cost(*nodes, root_node, frequencies) + 7) / 8 + tree_size;
+            if (fresh_size < best_size) {
+                choice = BLOCK_HUFFMAN;
+                best_size = fresh_size;
+            }
+            /* A legutobbi fa hivatkozas nelkul, a korabbiak egy bajtos tavolsaggal hasznalhatok. */
+            for (int distance = 0; distance < history->count; distance++) {
+                long previous_tree_size = 0;
+                Node *previous_tree = get_history_tree(history, distance, &previous_tree_size);
+                long reuse_bits = tree_cost(previous_tree, &previous_tree[previous_tree_size / sizeof(Node) - 1], frequencies);
+                long reuse_size = (reuse_bits + 7) / 8 + (distance > 0 ? 1 : 0);
+                if (reuse_bits >= 0 && reuse_size < best_size) {
+                    choice = distance > 0 ? BLOCK_HUFFMAN_REF : BLOCK_HUFFMAN_REUSE;
+                    reuse_distance = distance;
+                    best_size = reuse_size;
+                }
+            }
+            /* A beepitett tablak fa helyett egyetlen bajtot igenyelnek, ezert kis blokkoknal gyakran ezek nyernek. */
+            for (int t = 0; t < STATIC_TABLE_COUNT && !args.no_tables; t++) {
+                Static_code table;
+                if (table_code(t, &table) != 0) continue;
+                long table_bits = tree_cost(table.nodes, table.root_node, frequencies);
+                if (table_bits >= 0 && (table_bits + 7) / 8 + table.id_size < best_size) {
+                    choice = BLOCK_TABLE;
+                    best_table = table;
+                    code = &best_table;
+                    best_size = (table_bits + 7) / 8 + table.id_size;
+                }
+            }
+            long run_size = rle_encode(segments, segment_count, NULL);
+            if (run_size < best_size) {
+                choice = BLOCK_RLE;
+                best_size = run_size;
+            }
+            /* A tANS ugyanabbol a hisztogrambol dolgozik, a fa helyett a normalizalt gyakorisagokat tarolja. */
+            if (args.ans) {
+                int ans_res = ans_normalize(frequencies, normalized);
+                if (ans_res < 0) {
+                    free(*nodes);
+                    *nodes = NULL;
+                    return ans_res;
+                }
+                long ans_size = (ans_cost(frequencies, normalized) + 7) / 8 + ans_header(normalized, NULL);
+                if (ans_size < best_size) {
+                    choice = BLOCK_ANS;
+                    best_size = ans_size;
+                }
+            }
+            if (args.context) {
+                long context_size = build_context_model(segments, segment_count, &context);
+                if (context_size < 0) {
+                    free(*nodes);
+                    *nodes = NULL;
+                    return context_size;
+                }
+                if (context_size < best_size) {
+                    choice = BLOCK_CONTEXT;
+                    best_size = context_size;
+                }
+            }
+            /* Az LZ77 ablaknak, a BWT reszblokkjainak, a bajtparoknak es a szavaknak folytonosnak kell lennie, ezert a tobb szeletbol
+             * allo blokkot osszemasoljuk. */
+            if (args.lz_window > 0 || args.bwt || args.wide || args.words) {
+                block_data = segments[0].data;
+                if (segment_count > 1) {
+                    block_data = malloc(data_len);
+                    long offset = 0;
+                    for (int i = 0; i < segment_count && block_data != NULL; i++) {
+                        memcpy(block_data + offset, segments[i].data, segments[i].size);
+                        offset += segments[i].size;
+                    }
+                }
+                long lz_size = data_len;
+                long bwt_size = data_len;
+                long wide_size = data_len;
+                long words_size = data_len;
+                if (block_data == NULL) {
+                    lz_size = MALLOC_ERROR;
+                } else if (args.lz_window > 0) {
+                    lz_size = lz_estimate(block_data, data_len, args.lz_window, &lz_model);
+                }
+                if (lz_size >= 0 && args.bwt) bwt_size = bwt_estimate(block_data, data_len, &bwt_block);
+                if (lz_size >= 0 && bwt_size >= 0 && args.wide) wide_size = wide_estimate(block_data, data_len, &wide_code);
+                if (lz_size >= 0 && bwt_size >= 0 && wide_size >= 0 && args.words) words_size = words_estimate(block_data, data_len, &words_model);
+                if (lz_size < 0 || bwt_size < 0 || wide_size < 0 || words_size < 0) {
+                    if (segment_count > 1) free(block_data);
+                    free_alphabet_model(&lz_model);
+                    bwt_free(&bwt_block);
+                    free_canonical_code(&wide_code);
+                    free_context_model(&context);
+                    free(*nodes);
+                    *nodes = NULL;
+                    return lz_size < 0 ? lz_size : bwt_size < 0 ? bwt_size : wide_size < 0 ? wide_size : words_size;
+                }
+                if (lz_size < best_size) {
+                    choice = BLOCK_LZ;
+                    best_size = lz_size;
+                }
+                if (bwt_size < best_size) {
+                    choice = BLOCK_BWT;
+                    best_size = bwt_size;
+                }
+                if (wide_size < best_size) {
+                    choice = BLOCK_WIDE;
+                    best_size = wide_size;
+                }
+                if (words_size < best_size) {
+                    choice = BLOCK_WORDS;
+                    best_size = words_size;
+                }
+            }
+        }
+    }
+    if (choice != BLOCK_HUFFMAN) {
+        free(*nodes);
+        *nodes = NULL;
+    }
+    if (choice != BLOCK_CONTEXT) free_context_model(&context);
+    if (choice != BLOCK_LZ) free_alphabet_model(&lz_model);
+    if (choice != BLOCK_BWT) bwt_free(&bwt_block);
+    if (choice != BLOCK_WIDE) free_canonical_code(&wide_code);
+    if (choice != BLOCK_WORDS) words_free(&words_model);
+    if (choice != BLOCK_LZ && choice != BLOCK_WIDE && choice != BLOCK_WORDS && segment_count > 1) {
+        free(block_data);
+        block_data = NULL;
+    }
+
+    compressed_file->block_type = choice;
+    compressed_file->huffman_tree = NULL;
+    compressed_file->tree_size = 0;
+    switch (choice) {
+        case BLOCK_HUFFMAN: {
+            /* --fast eseten a becsles csak a mintan alapul; ha a kodolt adat megsem kisebb, tarolt blokk lesz belole. */
+            long limit = args.fast ? data_len - tree_size : 0;
+            int compress_res = args.fast && limit <= 0 ? OUTPUT_LIMIT : encode_huffman(segments, segment_count, *nodes, root_node, limit, compressed_file);
+            if (compress_res != 0 && compress_res != OUTPUT_LIMIT) return compress_res;
+            if (compress_res == 0 && (!args.fast || (compressed_file->data_size + 7) / 8 + tree_size < data_len)) {
+                compressed_file->huffman_tree = *nodes;
+                compressed_file->tree_size = tree_size;
+                return 0;
+            }
+            free(compressed_file->compressed_data);
+            compressed_file->compressed_data = NULL;
+            free(*nodes);
+            *nodes = NULL;
+            compressed_file->block_type = BLOCK_STORED;
+            break;
+        }
+        case BLOCK_HUFFMAN_REUSE:
+        case BLOCK_HUFFMAN_REF: {
+            long previous_tree_size = 0;
+            Node *previous_tree = get_history_tree(history, reuse_distance, &previous_tree_size);
+            int compress_res = encode_huffman(segments, segment_count, previous_tree, &previous_tree[previous_tree_size / sizeof(Node) - 1], 0, compressed_file);
+            if (compress_res != 0 || choice == BLOCK_HUFFMAN_REUSE) return compress_res;
+            *nodes = malloc(1);
+            if (*nodes == NULL) return MALLOC_ERROR;
+            *(unsigned char*)*nodes = (unsigned char)reuse_distance;
+            compressed_file->huffman_tree = *nodes;
+            compressed_file->tree_size = 1;
+            return 0;
+        }
+        case BLOCK_TABLE:
+        case BLOCK_DICT: {
+            /* Megadott kodnal a kimenet a bemenet meretere korlatozott: ha nem fer bele, tarolt blokk lesz belole. */
+            long limit = code == forced ? data_len - code->id_size : 0;
+            int compress_res = code == forced && limit <= 0 ? OUTPUT_LIMIT : encode_huffman(segments, segment_count, code->nodes, code->root_node, limit, compressed_file);
+            if (compress_res != 0 && compress_res != OUTPUT_LIMIT) return compress_res;
+            if (compress_res == 0 && (code != forced || (compressed_file->data_size + 7) / 8 + code->id_size < data_len)) {
+                *nodes = malloc(code->id_size);
+                if (*nodes == NULL) return MALLOC_ERROR;
+                memcpy(*nodes, code->id, code->id_size);
+                compressed_file->huffman_tree = *nodes;
+                compressed_file->tree_size = code->id_size;
+                return 0;
+            }
+            free(compressed_file->compressed_data);
+            compressed_file->compressed_data = NULL;
+            compressed_file->block_type = BLOCK_STORED;
+            break;
+        }
+        case BLOCK_CONSTANT:
+            compressed_file->compressed_data = malloc(1);
+            if (compressed_file->compressed_data == NULL) return MALLOC_ERROR;
+            compressed_file->compressed_data[0] = constant;
+            compressed_file->data_size = 8;
+            return 0;
+        case BLOCK_ANS: {
+            long header_size = ans_header(normalized, NULL);
+            *nodes = malloc(header_size);
+            if (*nodes == NULL) return MALLOC_ERROR;
+            ans_header(normalized, (unsigned char*)*nodes);
+            compressed_file->huffman_tree = *nodes;
+            compressed_file->tree_size = header_size;
+            return ans_encode(segments, segment_count, normalized, &compressed_file->compressed_data, &compressed_file->data_size);
+        }
+        case BLOCK_LZ: {
+            int compress_res = lz_encode(block_data, data_len, args.lz_window, &lz_model, compressed_file, nodes);
+            free_alphabet_model(&lz_model);
+            if (segment_count > 1) free(block_data);
+            return compress_res;
+        }
+        case BLOCK_WIDE: {
+            int compress_res = wide_encode(block_data, data_len, &wide_code, compressed_file, nodes);
+            free_canonical_code(&wide_code);
+            if (segment_count > 1) free(block_data);
+            return compress_res;
+        }
+        case BLOCK_WORDS: {
+            int compress_res = words_encode(block_data, data_len, &words_model, compressed_file, nodes);
+            words_free(&words_model);
+            if (segment_count > 1) free(block_data);
+            return compress_res;
+        }
+        case BLOCK_BWT: {
+            int compress_res = bwt_encode(&bwt_block, data_len, compressed_file, nodes);
+            bwt_free(&bwt_block);
+            return compress_res;
+        }
+        case BLOCK_CONTEXT: {
+            int compress_res = encode_context(segments, segment_count, &context, compressed_file, nodes);
+            free_context_model(&context);
+            return compress_res;
+        }
+        case BLOCK_RLE:
+            compressed_file->compressed_data = malloc(best_size);
+            if (compressed_file->compressed_data == NULL) return MALLOC_ERROR;
+            rle_encode(segments, segment_count, compressed_file->compressed_data);
+            compressed_file->data_size = best_size * 8;
+            return 0;
+        default:
+            break;
+    }
+
+    compressed_file->compressed_data = malloc(data_len);
+    if (compressed_file->compressed_data == NULL) return MALLOC_ERROR;
+    long offset = 0;
+    for (int i = 0; i < segment_count; i++) {
+        memcpy(compressed_file->compressed_data + offset, segments[i].data, segments[i].size);
+        offset += segments[i].size;
+    }
+    compressed_file->data_size = data_len * 8;
+    return 0;
+}
+
+/*
+ * A nagy szeleteket SPLIT_WINDOW meretu darabokra bontja, hogy a blokkhatarok fajlon belul is lehessenek.
+ * Az utolso darab elnyeli a maradekot, igy egy darab sem kisebb az ablaknal, ha a szelet nagyobb volt nala.
+ * Ha split hamis, a szeleteket valtozatlanul masolja. A darabok az eredeti adatra mutatnak; a lefoglalt tombot
+ * a hivo szabaditja fel.
+ */
+static Data_segment* split_segments(Data_segment *segments, int segment_count, bool split, int *piece_count) {
+    int count = 0;
+    for (int i = 0; i < segment_count; i++) {
+        count += split && segments[i].size >= 2 * SPLIT_WINDOW ? segments[i].size / SPLIT_WINDOW : 1;
+    }
+    Data_segment *pieces = malloc((count > 0 ? count : 1) * sizeof(Data_segment));
+    if (pieces == NULL) return NULL;
+    int current = 0;
+    for (int i = 0; i < segment_count; i++) {
+        long offset = 0;
+        while (split && segments[i].size - offset >= 2 * SPLIT_WINDOW) {
+            pieces[current].data = segments[i].data + offset;
+            pieces[current].size = SPLIT_WINDOW;
+            offset += SPLIT_WINDOW;
+            current++;
+        }
+        pieces[current].data = segments[i].data + offset;
+        pieces[current].size = segments[i].size - offset;
+        current++;
+    }
+    *piece_count = count;
+    return pieces;
+}
+
+// Az adat nulladrendu entropiaja bitekben (n*log2(n) - sum c*log2(c)) a gyakorisagokbol.
+static double entropy_bits(long *frequencies) {
+    long total = 0;
+    double bits = 0;
+    for (int i = 0; i < 256; i++) {
+        if (frequencies[i] == 0) continue;
+        total += frequencies[i];
+        bits -= frequencies[i] * log2((double)frequencies[i]);
+    }
+    return total > 0 ? bits + total * log2((double)total) : 0;
+}
+
+/*
+ * Eldonti, hogy a darab eloszlasa annyira elter-e az eddigi blokketol, hogy uj blokkot erdemes kezdeni.
+ * Az osszevonas vesztesege (a ket resz KL-divergenciajanak sulyozott osszege, bitekben) az egyutt es kulon
+ * kodolt entropia kulonbsege; akkor vagunk, ha ez meghaladja a darab sajat fajanak tarolasi koltseget.
+ */
+static bool statistics_shift(long *block_frequencies, long *piece_frequencies) {
+    long merged[256];
+    int leaf_count = 0;
+    for (int i = 0; i < 256; i++) {
+        merged[i] = block_frequencies[i] + piece_frequencies[i];
+        if (piece_frequencies[i] != 0) leaf_count++;
+    }
+    double merge_loss = entropy_bits(merged) - entropy_bits(block_frequencies) - entropy_bits(piece_frequencies);
+    double tree_bits = (2.0 * leaf_count - 1) * sizeof(Node) * 8;
+    return merge_loss > tree_bits;
+}
+
+/*
+ * A block_start csoporttol kezdodo blokk veget adja meg: az azonos besorolasu csoportokat addig vonja ossze,
+ * amig egy Huffman blokkban a kovetkezo nagy csoport eloszlasa el nem ter a blokketol.
+ */
+static int find_block_end(Data_segment *pieces, Piece_group *groups, int group_count, unsigned char *block_class, int block_start) {
+    int block_end = block_start + 1;
+    long block_frequencies[256];
+    memcpy(block_frequencies, groups[block_start].frequencies, sizeof(block_frequencies));
+    while (block_end < group_count && block_class[block_end] == block_class[block_start]) {
+        long *group_frequencies = groups[block_end].frequencies;
+        if (block_class[block_start] == BLOCK_HUFFMAN && group_is_large(pieces, &groups[block_end])
+                && statistics_shift(block_frequencies, group_frequencies)) {
+            break;
+        }
+        for (int i = 0; i < 256; i++) {
+            block_frequencies[i] += group_frequencies[i];
+        }
+        block_end++;
+    }
+    return block_end;
+}
+
+/*
+ * Mappa tomoritesekor a Huffman besorolasu csoportokat legalabb item_min meretu elemekbe fogja (az elem nagy csoporttal
+ * zarul), az elemek hisztogramjait pedig cluster_histograms csoportositja. A group_cluster tombbe csoportonkent a
+ * klaszter sorszamat irja (-1 a nem Huffman csoportokra), a cluster_frequencies tombbe klaszterenkent az osszesitett
+ * gyakorisagokat. A klaszterek szamat adja vissza, hiba eseten negativ kodot.
+ */
+static int cluster_groups(Data_segment *pieces, Piece_group *groups, int group_count, unsigned char *block_class, long data_len, int *group_cluster, long cluster_frequencies[][256]) {
+    long item_min = data_len / CLUSTER_ITEM_MAX > STORED_SEGMENT_MIN ? data_len / CLUSTER_ITEM_MAX : STORED_SEGMENT_MIN;
+    int item_count = 0;
+    long item_size = 0;
+    for (int i = 0; i < group_count; i++) {
+        if (block_class[i] != BLOCK_HUFFMAN) {
+            group_cluster[i] = -1;
+            if (item_size > 0) item_count++;
+            item_size = 0;
+            continue;
+        }
+        group_cluster[i] = item_count;
+        item_size += groups[i].size;
+        if (group_is_large(pieces, &groups[i]) && item_size >= item_min) {
+            item_count++;
+            item_size = 0;
+        }
+    }
+    if (item_size > 0) item_count++;
+    if (item_count < 2) return item_count;
+
+    unsigned int *histograms = calloc(item_count * 256, sizeof(unsigned int));
+    int *assignment = malloc(item_count * sizeof(int));
+    if (histograms == NULL || assignment == NULL) {
+        free(histograms);
+        free(assignment);
+        return MALLOC_ERROR;
+    }
+    for (int i = 0; i < group_count; i++) {
+        if (group_cluster[i] < 0) continue;
+        unsigned int *histogram = &histograms[group_cluster[i] * 256];
+        for (int j = 0; j < 256; j++) {
+            histogram[j] += (unsigned int)groups[i].frequencies[j];
+        }
+    }
+    int cluster_count = cluster_histograms(histograms, item_count, DIRECTORY_CLUSTERS, assignment);
+    if (cluster_count < 0) {
+        free(histograms);
+        free(assignment);
+        return cluster_count;
+    }
+
+    memset(cluster_frequencies, 0, DIRECTORY_CLUSTERS * sizeof(cluster_frequencies[0]));
+    for (int i = 0; i < item_count; i++) {
+        for (int j = 0; j < 256; j++) {
+            cluster_frequencies[assignment[i]][j] += histograms[i * 256 + j];
+        }
+    }
+    for (int i = 0; i < group_count; i++) {
+        if (group_cluster[i] >= 0) group_cluster[i] = assignment[group_cluster[i]];
+    }
+    free(histograms);
+    free(assignment);
+    return cluster_count;
+}
+
+/*
+ * --numeric eseten a blokk elorejelzeset valasztja ki a delta (1, 2, 4, 8 bajtos) es XOR (4, 8 bajtos) szurok kozul a
+ * maradek nulladrendu entropiaja alapjan. Ha a legjobb legalabb PREDICTION_MIN_GAIN aranyban kevesebb bitet becsul a
+ * nyers adatnal, a maradekot a filtered bufferbe (a hivo szabaditja fel), a szurot a filter es width kimenetekbe irja;
+ * kulonben a filtered NULL marad. A nyers adat gyakorisagait a frequencies adja, ha mar megszamoltuk (kulonben NULL).
+ * Siker eseten 0-t, hiba eseten negativ kodot ad vissza.
+ */
+static int choose_prediction(Data_segment *pieces, int piece_count, long block_len, long *frequencies, char **filtered, unsigned char *filter, unsigned char *width) {
+    static const unsigned char candidates[][2] = {
+        {FILTER_DELTA, 1}, {FILTER_DELTA, 2}, {FILTER_DELTA, 4}, {FILTER_DELTA, 8}, {FILTER_XOR, 4}, {FILTER_XOR, 8}
+    };
+    *filtered = NULL;
+    char *raw = malloc(block_len);
+    char *best = malloc(block_len);
+    char *scratch = malloc(block_len);
+    if (raw == NULL || best == NULL || scratch == NULL) {
+        free(raw);
+        free(best);
+        free(scratch);
+        return MALLOC_ERROR;
+    }
+    long offset = 0;
+    for (int i = 0; i < piece_count; i++) {
+        memcpy(raw + offset, pieces[i].data, pieces[i].size);
+        offset += pieces[i].size;
+    }
+    long raw_frequencies[256] = {0};
+    if (frequencies != NULL) {
+        memcpy(raw_frequencies, frequencies, sizeof(raw_frequencies));
+    } else {
+        count_frequencies(raw, block_len, raw_frequencies);
+    }
+    double best_bits = entropy_bits(raw_frequencies) * (1 - PREDICTION_MIN_GAIN);
+    bool found = false;
+    for (int c = 0; c < (int)(sizeof(candidates) / sizeof(candidates[0])); c++) {
+        predict_block(raw, block_len, candidates[c][0], candidates[c][1], scratch);
+        long residual_frequencies[256] = {0};
+        count_frequencies(scratch, block_len, residual_frequencies);
+        double bits = entropy_bits(residual_frequencies);
+        if (bits < best_bits) {
+            char *swap = best;
+            best = scratch;
+            scratch = swap;
+            best_bits = bits;
+            *filter = candidates[c][0];
+            *width = candidates[c][1];
+            found = true;
+        }
+    }
+    free(raw);
+    free(scratch);
+    if (found) {
+        *filtered = best;
+    } else {
+        free(best);
+    }
+    return 0;
+}
+
+// A szeleteket egyetlen bufferbe gyujti; egy szelet eseten annak adatat adja vissza masolas nelkul. Hiba eseten NULL.
+static char* gather_segments(Data_segment *segments, int segment_count, long data_len) {
+    if (segment_count == 1) return segments[0].data;
+    char *gathered = malloc(data_len);
+    long offset = 0;
+    for (int i = 0; i < segment_count && gathered != NULL; i++) {
+        memcpy(gathered + offset, segments[i].data, segments[i].size);
+        offset += segments[i].size;
+    }
+    return gathered;
+}
+
+/*
+ * A run_compression szeletenkenti valtozata: a bemenetet szeletek sorozatakent kapja
+ * (pl. a mappa bejegyzeseinek fejlecei a fajltartalmakkal valtakozva), es masolas nelkul kodolja.
+ * A nagy szeleteket darabokra bontja, az azonos besorolasu szomszedos darabok egy blokkot alkotnak: a tomorithetetlenek
+ * (es a hozzajuk tartozo fejlecek) tarolt blokkba kerulnek. Huffman blokkon belul ott is vagunk, ahol a bajtok eloszlasa
+ * megvaltozik. Mappa tomoritesekor a hasonlo eloszlasu fajlok csoportokba kerulnek: a blokkhatarokat a csoportvaltasok adjak,
+ * es a csoport minden blokkja a csoport kozos fajat hasznalja (ezt az elso blokk tarolja, a tobbi hivatkozik ra).
+ * A blokkok kodolasat az encode_block valasztja; a tag fejlece egyszer irodik ki, utana a blokkok kovetkeznek.
+ * --shuffle=N eseten a bemenet bajtsikjai lesznek a szeletek, a keverest az elso blokk fejlece jelzi. --columnar eseten
+ * (ha az adat tagolt) az oszlopfolyamok lesznek a szeletek, es minden oszlop kulon blokkba kerul. --numeric eseten
+ * a Huffman besorolasu blokkok delta vagy XOR elorejelzest kaphatnak, ezt a blokk sajat fejlece jelzi.
+ */
+int run_compression_segments(Arguments args, Data_segment *segments, int segment_count, long directory_size) {
+    long data_len = 0;
+    for (int i = 0; i < segment_count; i++) {
+        data_len += segments[i].size;
+    }
+
     // Ha nem adott meg kimeneti fajlt a felhasznalo, general egyet.
     bool output_generated = false;
     if (args.output_file == NULL) {
@@ -281,132 +1433,520 @@ int run_compression(Arguments args, char *data, long data_len, long directory_si
         }
     }
 
-    int write_res = 0;
-    long *frequencies = NULL;
-    Compressed_file *compressed_file = NULL;
-    Node *nodes = NULL;
-    long tree_size = 0;
-    char **cache = NULL;
+    Data_segment *pieces = NULL;
+    int piece_count = 0;
+    Piece_group *groups = NULL;
+    int group_count = 0;
+    unsigned char *block_class = NULL;
+    int *group_cluster = NULL;
+    int cluster_count = 0;
+    long cluster_frequencies[DIRECTORY_CLUSTERS][256];
+    Tree_history history = {0};
+    Dictionary *dictionary = NULL;
+    Static_code forced_code;
+    Static_code *forced = NULL;
+    char *shuffled = NULL;
+    Data_segment planes[SHUFFLE_WIDTH_MAX + 1];
+    char *columns = NULL;
+    char column_header[1 + COLUMNS_MAX * sizeof(long)];
+    long column_sizes[COLUMNS_MAX];
+    int column_count = 0;
+    bool *column_start = NULL;
+    FILE *out = NULL;
+    long compressed_size = 0;
     int res = 0;
     
     // A while ciklusbol a vegen garantaltan ki break-elunk, de ha hiba tortenik, akkor a vegare ugrunk.
     while (true) {
-        // Megszamolja a bemeneti adat bajtjainak gyakorisagat.
-        frequencies = calloc(256, sizeof(long));
-        if (frequencies == NULL) {
-            printf("Nem sikerult lefoglalni a memoriat.\n");
-            res = MALLOC_ERROR;
+        if (data_len == 0) {
+            printf("A fajl (%s) ures.\n", args.input_file);
+            res = SUCCESS;
             break;
         }
-        count_frequencies(data, data_len, frequencies);
 
-        int leaf_count = 0;
-        for (int i = 0; i < 256; i++) {
-            if (frequencies[i] != 0) {
-                leaf_count++;
+        if (args.table != NULL) {
+            if (table_code(find_static_table(args.table), &forced_code) != 0) {
+                printf("Ismeretlen kodtabla: %s.\n", args.table);
+                res = EINVAL;
+                break;
+            }
+            forced = &forced_code;
+        } else if (args.dict != NULL) {
+            dictionary = malloc(sizeof(Dictionary));
+            if (dictionary == NULL) {
+                printf("Nem sikerult lefoglalni a memoriat.\n");
+                res = ENOMEM;
+                break;
+            }
+            if (load_dictionary(args.dict, dictionary) != 0) {
+                printf("Nem sikerult beolvasni a szotarfajlt (%s).\n", args.dict);
+                res = EIO;
+                break;
             }
+            forced_code.type = BLOCK_DICT;
+            forced_code.nodes = dictionary->nodes;
+            forced_code.root_node = &dictionary->nodes[510];
+            memcpy(forced_code.id, &dictionary->hash, DICTIONARY_HASH_SIZE);
+            forced_code.id_size = DICTIONARY_HASH_SIZE;
+            forced = &forced_code;
         }
 
-        if (leaf_count == 0) {
-            printf("A fajl (%s) ures.\n", args.input_file);
-            res = SUCCESS;
-            break;
+        /* A bajtsik-kevereshez a bemenetet egyben alakitjuk at. A sikok kulon szeletek lesznek, igy a blokkhatarok
+         * a sikhatarokra eshetnek, es a kiszamithato felso bajtok a zajos also bajtoktol kulon faval kodolhatok. */
+        if (args.shuffle > 1 && !args.directory) {
+            char *gathered = gather_segments(segments, segment_count, data_len);
+            shuffled = malloc(data_len);
+            if (gathered != NULL && shuffled != NULL) shuffle_bytes(gathered, data_len, args.shuffle, shuffled);
+            if (segment_count > 1) free(gathered);
+            if (gathered == NULL || shuffled == NULL) {
+                printf("Nem sikerult lefoglalni a memoriat.\n");
+                res = MALLOC_ERROR;
+                break;
+            }
+            long records = data_len / args.shuffle;
+            segment_count = 0;
+            for (int b = 0; b < args.shuffle && records > 0; b++) {
+                planes[segment_count].data = shuffled + b * records;
+                planes[segment_count].size = records;
+                segment_count++;
+            }
+            if (data_len > records * args.shuffle) {
+                planes[segment_count].data = shuffled + records * args.shuffle;
+                planes[segment_count].size = data_len - records * args.shuffle;
+                segment_count++;
+            }
+            segments = planes;
         }
 
-        nodes = malloc((2 * leaf_count - 1) * sizeof(Node));
-        if (nodes == NULL) {
+        /* Az oszlopos bontas is a teljes bemeneten fut. Az elso szelet a fejlec (az elvalaszto es az oszlophosszak),
+         * utana az oszlopfolyamok kovetkeznek; ha az adat nem tagolt, a szokasos modon tomoritunk. */
+        if (args.columnar && !args.directory) {
+            char *gathered = gather_segments(segments, segment_count, data_len);
+            char delimiter = 0;
+            if (gathered != NULL) column_count = detect_columns(gathered, data_len, &delimiter);
+            if (column_count > 0) {
+                columns = malloc(data_len);
+                if (columns != NULL) split_columns(gathered, data_len, delimiter, column_count, column_header, columns, column_sizes);
+            }
+            if (segment_count > 1) free(gathered);
+            if (gathered == NULL || (column_count > 0 && columns == NULL)) {
+                printf("Nem sikerult lefoglalni a memoriat.\n");
+                res = MALLOC_ERROR;
+                break;
+            }
+            if (column_count == 0) {
+                printf("A bemenet nem tagolt rekordokbol all, oszlopok nelkul tomoritem.\n");
+            } else {
+                planes[0].data = column_header;
+                planes[0].size = columns_header_size(column_count);
+                segment_count = 1;
+                long offset = 0;
+                for (int c = 0; c < column_count; c++) {
+                    if (column_sizes[c] == 0) continue;
+                    planes[segment_count].data = columns + offset;
+                    planes[segment_count].size = column_sizes[c];
+                    offset += column_sizes[c];
+                    segment_count++;
+                }
+                segments = planes;
+            }
+        }
+
+        /* Gyors modban az adatot elore nem olvassuk vegig, az egesz bemenet egyetlen blokk. Megadott tablaval vagy
+         * szotarral sem szamolunk, ott a blokkokat csak a meretuk zarja le. */
+        bool single_block = args.fast;
+        bool count_groups = !args.fast && forced == NULL;
+        pieces = split_segments(segments, segment_count, !single_block, &piece_count);
+        /* Oszlopos bontasnal a blokk nem lephet at oszlophataron (a fejlec az elso oszlop blokkjaba kerul). */
+        if (pieces != NULL && columns != NULL) {
+            column_start = calloc(piece_count, sizeof(bool));
+            int next_column = 2;
+            for (int i = 0; i < piece_count && column_start != NULL; i++) {
+                if (next_column < segment_count && pieces[i].data == segments[next_column].data) {
+                    column_start[i] = true;
+                    next_column++;
+                }
+            }
+        }
+        if (pieces != NULL && (columns == NULL || column_start != NULL)) {
+            groups = group_pieces(pieces, piece_count, column_start, count_groups, &group_count);
+        }
+        if (groups != NULL) {
+            block_class = count_groups ? classify_groups(pieces, groups, group_count) : calloc(group_count, sizeof(unsigned char));
+        }
+        if (block_class != NULL) {
+            group_cluster = malloc(group_count * sizeof(int));
+        }
+        if (group_cluster == NULL) {
             printf("Nem sikerult lefoglalni a memoriat.\n");
             res = MALLOC_ERROR;
             break;
         }
+        if (args.directory && count_groups) {
+            cluster_count = cluster_groups(pieces, groups, group_count, block_class, data_len, group_cluster, cluster_frequencies);
+            if (cluster_count < 0) {
+                printf("Nem sikerult lefoglalni a memoriat.\n");
+                res = MALLOC_ERROR;
+                break;
+            }
+        }
+        bool clustered = cluster_count > 1;
 
-        int j = 0;
-        for (int i = 0; i < 256; i++) {
-            if (frequencies[i] != 0) {
-                nodes[j] = construct_leaf(frequencies[i], (char)i);
-                j++;
+        /* A tag fejlece (a nev es a mappa jelzo) egyszer kerul a fajlba, utana a blokkok kovetkeznek.
+         * Hozzafuzeskor a meglevo fajl vegere uj tag kerul. */
+        Compressed_file member = {0};
+        member.is_dir = args.directory;
+        member.original_file = args.input_file;
+        member.file_name = args.output_file;
+        long header_res = 0;
+        out = open_compressed_member(&member, args.append_archive != NULL, args.force, &header_res);
+        if (out == NULL) {
+            if (header_res == NO_OVERWRITE) {
+                printf("A fajlt nem irtam felul, nem tortent meg a tomorites.\n");
+                res = ECANCELED;
+            } else {
+                printf("Nem sikerult kiirni a kimeneti fajlt (%s).\n", args.output_file);
+                res = EIO;
             }
+            break;
         }
-        free(frequencies);
-        frequencies = NULL;
+        compressed_size = header_res;
 
-        // Felepiti a Huffman fat a rendezett levelek tombjebol. 
-        sort_nodes(nodes, leaf_count);
-        Node *root_node = construct_tree(nodes, leaf_count);
+        int block_count = 0;
+        int block_start = 0;
+        while (block_start < group_count) {
+            int block_end = group_count;
+            if (clustered) {
+                /* Csoportositaskor a blokk az azonos besorolasu es klaszteru csoportok sorozata. */
+                block_end = block_start + 1;
+                while (block_end < group_count && block_class[block_end] == block_class[block_start]
+                        && group_cluster[block_end] == group_cluster[block_start]) {
+                    block_end++;
+                }
+            } else if (forced != NULL) {
+                long forced_len = groups[block_start].size;
+                block_end = block_start + 1;
+                while (block_end < group_count && forced_len < FORCED_BLOCK_SIZE) {
+                    forced_len += groups[block_end].size;
+                    block_end++;
+                }
+            } else if (!single_block) {
+                block_end = find_block_end(pieces, groups, group_count, block_class, block_start);
+            }
+            for (int i = block_start + 1; column_start != NULL && i < block_end; i++) {
+                if (column_start[groups[i].first]) {
+                    block_end = i;
+                    break;
+                }
+            }
+            long block_len = 0;
+            long block_frequencies[256] = {0};
+            for (int i = block_start; i < block_end; i++) {
+                block_len += groups[i].size;
+                for (int j = 0; count_groups && j < 256; j++) {
+                    block_frequencies[j] += groups[i].frequencies[j];
+                }
+            }
+            if (block_len == 0) {
+                block_start = block_end;
+                continue;
+            }
 
-        if (root_node != NULL) {
-            tree_size = (root_node - nodes) + 1;
-        } else {
-            printf("Nem sikerult a Huffman fa felepitese.\n");
-            res = TREE_ERROR;
-            break;
+            Compressed_file compressed_file = {0};
+            Data_segment *block_pieces = &pieces[groups[block_start].first];
+            int block_piece_count = groups[block_end - 1].end - groups[block_start].first;
+            long *counted = count_groups ? block_frequencies : NULL;
+            long *tree_frequencies = clustered && group_cluster[block_start] >= 0 ? cluster_frequencies[group_cluster[block_start]] : NULL;
+            char *filtered = NULL;
+            Data_segment filtered_piece;
+            /* Az oszlopos bontast az elso blokk jelzi, ezert az nem kaphat elorejelzest. */
+            if (args.numeric && shuffled == NULL && (columns == NULL || block_count > 0) && block_class[block_start] == BLOCK_HUFFMAN) {
+                res = choose_prediction(block_pieces, block_piece_count, block_len, counted, &filtered, &compressed_file.filter, &compressed_file.filter_width);
+                if (res != 0) {
+                    printf("Nem sikerult lefoglalni a memoriat.\n");
+                    break;
+                }
+            }
+            /* Az elorejelzett blokk maradekanak eloszlasa mas, mint a nyers adate vagy a klasztere, ezert ujraszamoljuk. */
+            if (filtered != NULL) {
+                filtered_piece.data = filtered;
+                filtered_piece.size = block_len;
+                block_pieces = &filtered_piece;
+                block_piece_count = 1;
+                counted = NULL;
+                tree_frequencies = NULL;
+            }
+
+            // Tomoriti (vagy tarolja) a blokk szeleteit a compressed_file strukturaba.
+            Node *nodes = NULL;
+            int encode_res = encode_block(block_pieces, block_piece_count, block_class[block_start] == BLOCK_STORED,
+                                          args, forced, counted, tree_frequencies, &history, &compressed_file, &nodes);
+            if (encode_res != 0) {
+                printf("Nem sikerult a tomorites.\n");
+                free(nodes);
+                free(filtered);
+                res = encode_res;
+                break;
+            }
+
+            compressed_file.original_size = block_len;
+            /* A keveres es az oszlopos bontas a teljes adatra vonatkozik, ezert csak az elso blokk jelzi. */
+            if (shuffled != NULL && block_count == 0) {
+                compressed_file.filter = FILTER_SHUFFLE;
+                compressed_file.filter_width = (unsigned char)args.shuffle;
+            }
+            if (columns != NULL && block_count == 0) {
+                compressed_file.filter = FILTER_COLUMNS;
+                compressed_file.filter_width = (unsigned char)column_count;
+            }
+            long write_res = write_compressed_block(out, &compressed_file);
+            /* Az uj fa lesz a kovetkezo blokkok szamara ujrahasznalhato fa. */
+            if (compressed_file.block_type == BLOCK_HUFFMAN) {
+                push_tree_history(&history, nodes, compressed_file.tree_size);
+                nodes = NULL;
+            }
+            free(nodes);
+            free(filtered);
+            free(compressed_file.compressed_data);
+
+            if (write_res < 0) {
+                printf("Nem sikerult kiirni a kimeneti fajlt (%s).\n", args.output_file);
+                res = EIO;
+                break;
+            }
+            compressed_size += write_res;
+            block_count++;
+            block_start = block_end;
         }
-        cache = calloc(256, sizeof(char *));
-        if (cache == NULL) {
-            printf("Nem sikerult lefoglalni a memoriat.\n");
-            res = MALLOC_ERROR;
+        if (res != 0) break;
+
+        long close_res = close_compressed_member(out);
+        out = NULL;
+        if (close_res < 0) {
+            printf("Nem sikerult kiirni a kimeneti fajlt (%s).\n", args.output_file);
+            res = EIO;
             break;
         }
+        compressed_size += close_res;
 
-        compressed_file = malloc(sizeof(Compressed_file));
-        if (compressed_file == NULL) {
+        /* Mappa eseten a fajlok osszmerete az eredeti meret, nem a (mar deduplikalt) szerializalt hossz. */
+        long source_size = args.directory ? directory_size : data_len;
+        long original_size = source_size;
+        long shown_size = compressed_size;
+        printf("Tomorites kesz.\n"
+                "Eredeti meret:    %ld%s\n"
+                "Tomoritett meret: %ld%s\n"
+                "Tomorites aranya: %.2f%%\n", original_size, get_unit(&original_size),
+                                            shown_size, get_unit(&shown_size),
+                                            (double)compressed_size / source_size * 100);
+        break;
+    }
+    if (out != NULL) fclose(out);
+    free(pieces);
+    free_piece_groups(groups, group_count);
+    free(block_class);
+    free(group_cluster);
+    free_tree_history(&history);
+    free(dictionary);
+    free(shuffled);
+    free(columns);
+    free(column_start);
+    if (output_generated) free(args.output_file);
+    return res;
+}
+
+/*
+ * Egymenetes adaptiv Huffman tomorites: a bemenetet (a "-" a szabvanyos bemenet) darabonkent olvassa es kodolja,
+ * gyakorisag-szamlalo menet es tarolt fa nelkul, igy csovekbol es socketekbol is tomorithet. A kodolt bitek
+ * folyamatosan a kimeneti fajlba kerulnek, a blokk fejlecebe a meretek a vegen irodnak be.
+ * Siker eseten 0-t, hiba eseten hibakodot ad vissza.
+ */
+int run_adaptive_compression(Arguments args) {
+    bool from_stdin = strcmp(args.input_file, "-") == 0;
+    if (from_stdin && args.output_file == NULL) {
+        printf("A szabvanyos bemenet tomoritesekor meg kell adni a kimeneti fajlt (-o).\n");
+        return EINVAL;
+    }
+    bool output_generated = false;
+    if (args.output_file == NULL) {
+        output_generated = true;
+        args.output_file = generate_output_file(args.input_file);
+        if (args.output_file == NULL) {
             printf("Nem sikerult lefoglalni a memoriat.\n");
-            res = MALLOC_ERROR;
+            return ENOMEM;
+        }
+    }
+
+    FILE *in = NULL;
+    FILE *out = NULL;
+    char *buffer = NULL;
+    unsigned char *encoded = NULL;
+    Adaptive_tree *tree = NULL;
+    Compressed_file compressed_file = {0};
+    int res = 0;
+
+    while (true) {
+        in = from_stdin ? stdin : fopen(args.input_file, "rb");
+        if (in == NULL) {
+            printf("Nem sikerult megnyitni a fajlt (%s).\n", args.input_file);
+            res = EIO;
             break;
         }
-        // Tomoriti a beolvasott adatokat a compressed_file strukturaba.
-        int compress_res = compress(data, data_len, nodes, root_node, cache, compressed_file);
-        if (compress_res != 0) {
-            printf("Nem sikerult a tomorites.\n");
-            res = compress_res;
+        buffer = malloc(ADAPTIVE_CHUNK_SIZE);
+        /* Egy darab utan legfeljebb egy bajt kodja kerulhet meg a bufferbe a kiiras elott. */
+        encoded = malloc(ADAPTIVE_CHUNK_SIZE + ADAPTIVE_MAX_CODE_BITS / 8 + 1);
+        tree = malloc(sizeof(Adaptive_tree));
+        if (buffer == NULL || encoded == NULL || tree == NULL) {
+            printf("Nem sikerult lefoglalni a memoriat.\n");
+            res = MALLOC_ERROR;
             break;
         }
 
-        compressed_file->is_dir = args.directory;
-
-        compressed_file->huffman_tree = nodes;
-        compressed_file->tree_size = tree_size * sizeof(Node);
-        compressed_file->original_file = args.input_file;
-        compressed_file->original_size = data_len;
-        compressed_file->file_name = args.output_file;
-        write_res = write_compressed(compressed_file, args.force);
-        if (write_res < 0) {
-            if (write_res == NO_OVERWRITE) {
+        compressed_file.is_dir = false;
+        compressed_file.block_type = BLOCK_ADAPTIVE;
+        compressed_file.original_file = args.input_file;
+        compressed_file.file_name = args.output_file;
+        int error = 0;
+        out = begin_compressed_stream(&compressed_file, args.force, &error);
+        if (out == NULL) {
+            if (error == NO_OVERWRITE) {
                 printf("A fajlt nem irtam felul, nem tortent meg a tomorites.\n");
-                write_res = ECANCELED;
+                res = ECANCELED;
             } else {
-                printf("Nem sikerult kiirni a kimeneti fajlt (%s).\n", compressed_file->file_name);
-                write_res = EIO;
+                printf("Nem sikerult kiirni a kimeneti fajlt (%s).\n", args.output_file);
+                res = EIO;
             }
+            break;
         }
-        else {
-            int original_size = (int)data_len;
-            int compressed_size = write_res;
-            printf("Tomorites kesz.\n"
-                    "Eredeti meret:    %d%s\n"
-                    "Tomoritett meret: %d%s\n"
-                    "Tomorites aranya: %.2f%%\n", original_size, get_unit(&original_size),
-                                                compressed_size, get_unit(&compressed_size),
-                                                (double)write_res/(args.directory ? directory_size : data_len) * 100);
+
+        adaptive_init(tree);
+        long bit_pos = 0;
+        size_t read_size;
+        while (res == 0 && (read_size = fread(buffer, sizeof(char), ADAPTIVE_CHUNK_SIZE, in)) > 0) {
+            for (size_t i = 0; i < read_size; i++) {
+                adaptive_encode(tree, (unsigned char)buffer[i], encoded, &bit_pos);
+                if (bit_pos / 8 >= ADAPTIVE_CHUNK_SIZE) {
+                    long bytes = bit_pos / 8;
+                    if ((long)fwrite(encoded, sizeof(char), bytes, out) != bytes) {
+                        res = EIO;
+                        break;
+                    }
+                    /* A csonka utolso bajt a buffer elejere kerul, a kodolas ott folytatodik. */
+                    encoded[0] = encoded[bytes];
+                    compressed_file.data_size += bytes * 8;
+                    bit_pos -= bytes * 8;
+                }
+            }
+            compressed_file.original_size += read_size;
+        }
+        if (res == 0 && ferror(in)) {
+            printf("Nem sikerult beolvasni a fajlt (%s).\n", args.input_file);
+            res = EIO;
+        }
+        long bytes = (bit_pos + 7) / 8;
+        if (res == 0 && (long)fwrite(encoded, sizeof(char), bytes, out) != bytes) {
+            res = EIO;
+        }
+        compressed_file.data_size += bit_pos;
+
+        long finish_res = finish_compressed_stream(out, &compressed_file);
+        out = NULL;
+        if (res == 0 && finish_res < 0) res = EIO;
+        if (res == EIO) {
+            printf("Nem sikerult kiirni a kimeneti fajlt (%s).\n", args.output_file);
+            break;
+        }
+        if (res != 0) break;
+
+        /* Ures bemenetnel ugyanazt a hibakodot adjuk, mint a Huffman ag (a read_raw EMPTY_FILE kodja). */
+        if (compressed_file.original_size == 0) {
+            printf("A fajl (%s) ures.\n", args.input_file);
+            remove(args.output_file);
+            res = EMPTY_FILE;
+            break;
         }
+        long original_size = compressed_file.original_size;
+        long compressed_size = finish_res;
+        printf("Tomorites kesz.\n"
+                "Eredeti meret:    %ld%s\n"
+                "Tomoritett meret: %ld%s\n"
+                "Tomorites aranya: %.2f%%\n", original_size, get_unit(&original_size),
+                                            compressed_size, get_unit(&compressed_size),
+                                            (double)finish_res / compressed_file.original_size * 100);
         break;
     }
-    free(frequencies);
+
+    if (in != NULL && !from_stdin) fclose(in);
+    if (out != NULL) fclose(out);
+    free(buffer);
+    free(encoded);
+    free(tree);
     if (output_generated) free(args.output_file);
-    free(nodes);
-    if (compressed_file != NULL) {
-        free(compressed_file->compressed_data);
-        free(compressed_file);
-    }
+    return res;
+}
 
-    if (cache != NULL) {
-        for (int i = 0; i < 256; ++i) {
-            if (cache[i] != NULL) {
-                free(cache[i]);
+/*
+ * Uj bejegyzeseket fuz egy meglevo mappa archivumhoz a korabbi tagok ujratomoritese nelkul.
+ * Az archivum vegen levo indexet levagja, az uj bejegyzeseket uj tagkent tomoriti a vegere,
+ * majd a regi es az uj bejegyzesekbol kozos indexet ir. Siker eseten 0-t, hiba eseten hibakodot ad vissza.
+ */
+int run_append(Arguments args) {
+    Archive_index previous = {0};
+    Directory_stream stream = {0};
+    long directory_size = 0;
+    int res = SUCCESS;
+
+    while (true) {
+        int index_res = read_archive_index(args.append_archive, &previous);
+        if (index_res != SUCCESS) {
+            if (index_res == FILE_MAGIC_ERROR) {
+                printf("Csak indexszel rendelkezo mappa archivumhoz lehet hozzafuzni (%s).\n", args.append_archive);
+            } else {
+                printf("Nem sikerult beolvasni az archivumot (%s).\n", args.append_archive);
             }
+            res = EINVAL;
+            break;
+        }
+        FILE *f = fopen(args.append_archive, "rb");
+        long payload_end = f != NULL ? get_payload_end(f) : FILE_READ_ERROR;
+        if (f != NULL) fclose(f);
+        if (payload_end < 0) {
+            printf("Nem sikerult beolvasni az archivumot (%s).\n", args.append_archive);
+            res = EIO;
+            break;
         }
-        free(cache);
+
+        long prep_res = prepare_append_stream(args, &previous, &stream, &directory_size);
+        if (prep_res < 0) {
+            res = prep_res;
+            break;
+        }
+
+        /* Csak a regi index kerul levagasra, a tomoritett tagok erintetlenek maradnak. */
+        if (truncate(args.append_archive, payload_end) != 0) {
+            printf("Nem sikerult modositani az archivumot (%s).\n", args.append_archive);
+            res = EIO;
+            break;
+        }
+        args.directory = true;
+        args.output_file = args.append_archive;
+        args.input_file = args.input_files[0];
+        res = run_compression_segments(args, stream.segments, stream.segment_count, directory_size);
+        if (res != SUCCESS) {
+            /* Sikertelen hozzafuzes utan visszaallitjuk az eredeti archivumot. */
+            if (truncate(args.append_archive, payload_end) != 0 || write_archive_index(args.append_archive, &previous, NULL, 0) != SUCCESS) {
+                printf("Nem sikerult visszaallitani az archivum indexet (%s).\n", args.append_archive);
+            }
+            break;
+        }
+        if (write_archive_index(args.append_archive, &previous, stream.archive, stream.archive_size) != SUCCESS) {
+            printf("Nem sikerult kiirni az archivum indexet (%s).\n", args.append_archive);
+            res = EIO;
+        }
+        break;
     }
-    if (write_res < 0) res = write_res;
+
+    free_directory_stream(&stream);
+    free_archive_index(&previous);
     return res;
 }
@@ -4,15 +4,48 @@
 #include "data_types.h"
 #include <stdbool.h>
 
+// Ennel kisebb szeletekrol nem dontunk kulon, hogy tarolt blokkba keruljenek-e.
+#define STORED_SEGMENT_MIN 4096
+// Egy szelet tomorithetetlen, ha sajat faval kodolva is a meretenek 1/32-edenel kevesebbet nyernenk.
+#define STORED_MIN_GAIN_DIVISOR 32
+// A nagy szeleteket ekkora darabokra bontjuk, a blokkhatarok ezek menten valaszthatok meg.
+#define SPLIT_WINDOW 16384
+// A --fast mod FAST_SAMPLE_STRIDE bajtonkent FAST_SAMPLE_RUN bajtot szamol meg (kb. 0,8%), FAST_SAMPLE_MIN alatt mindent.
+#define FAST_SAMPLE_STRIDE 8192
+#define FAST_SAMPLE_RUN 64
+#define FAST_SAMPLE_MIN 262144
+// Megadott tablaval vagy szotarral (szamlalas nelkul) a blokkok legalabb ekkorak, egy blokk kodja a tobbitol fuggetlenul tarolhato.
+#define FORCED_BLOCK_SIZE 262144
+// Az adaptiv tomorites ekkora darabokban olvassa a bemenetet es irja a kodolt biteket.
+#define ADAPTIVE_CHUNK_SIZE 65536
+// Mappa tomoritesekor a csoportositott elemek szamanak felso korlatja (a hisztogramok ennyi 1 KB-os tombben ferjenek el).
+#define CLUSTER_ITEM_MAX 512
+// Mappa tomoritesekor legfeljebb ennyi csoport (es kozos fa) keletkezik.
+#define DIRECTORY_CLUSTERS 8
+// A --context mod legfeljebb ennyi kontextus-osztalyba (es sajat faba) sorolja az elozo bajt 256 erteket.
+#define CONTEXT_BUCKETS 32
+// A --numeric elorejelzest csak akkor alkalmazzuk, ha a maradek becsult bitszama legalabb ennyivel (aranyosan) kisebb.
+#define PREDICTION_MIN_GAIN 0.01
+
 int count_frequencies(char *data, long data_len, long *frequencies);
+int count_segment_frequencies(Data_segment *segments, int segment_count, long *frequencies);
 Node* construct_tree(Node *nodes, long leaf_count);
 Node construct_leaf(long frequency, char data);
 Node construct_branch(Node *nodes, int left_index, int right_index);
 void sort_nodes(Node *nodes, int len);
+long build_tree(long *frequencies, Node **nodes, Node **root_node);
+long tree_cost(Node *nodes, Node *root_node, long *frequencies);
+void push_tree_history(Tree_history *history, Node *tree, long tree_size);
+Node* get_history_tree(Tree_history *history, int distance, long *tree_size);
+void free_tree_history(Tree_history *history);
 char* check_cache(char leaf, char **cache);
 char* find_leaf(char leaf, Node *nodes, Node *root_node);
 int compress(char *original_data, long data_len, Node *nodes, Node *root_node, char** cache, Compressed_file *compressed_file);
+int compress_segments(Data_segment *segments, int segment_count, Node *nodes, Node *root_node, char** cache, Compressed_file *compressed_file);
 char* generate_output_file(char *input_file);
 int run_compression(Arguments args, char *data, long data_len, long directory_size);
+int run_compression_segments(Arguments args, Data_segment *segments, int segment_count, long directory_size);
+int run_append(Arguments args);
+int run_adaptive_compression(Arguments args);
 
 #endif
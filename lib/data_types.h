@@ -2,12 +2,28 @@
 #define DATA_TYPES_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 /*
  * A magic az a tomoritett fajlban szereplo azonosito.
  */
 static const char magic[4] = {'H', 'U', 'F', 'F'};
 
+/*
+ * A tomoritett tag formatumanak verzioja, a magic utan egy bajton all. Mas verzioju tagot nem olvasunk be.
+ */
+static const unsigned char format_version = 2;
+
+/*
+ * A mappa archivumok vegere irt, tomoritetlen bejegyzes index azonositoja.
+ */
+static const char index_magic[4] = {'H', 'I', 'D', 'X'};
+
+/*
+ * A --train altal irt kulso szotarfajl azonositoja.
+ */
+static const char dict_magic[4] = {'H', 'U', 'F', 'D'};
+
 
 // Jelzi, hogy egy node level (adatot tartalmaz) vagy csomopont.
 typedef enum {
@@ -30,13 +46,122 @@ typedef struct Node {
 } Node;
 
 /*
- * A tomoritett fajl minden fontos adatat tartalmazza: az azonosito szam, fajlnevek, fa, tomoritett adat es meretek.
+ * Egy tomoritett tag (blokk) kodolasa. A tarolt blokk a nyers bajtokat tartalmazza fa nelkul,
+ * ezt hasznaljuk, ha a Huffman kodolas nem csokkentene a meretet. A konstans blokk egyetlen bajtot
+ * tarol, amely original_size-szor ismetlodik, az RLE blokk pedig (bajt, varint hossz) parok sorozata.
+ * A BLOCK_HUFFMAN_REUSE blokk fa nelkul tarolodik, a fajlban elotte allo utolso Huffman blokk fajaval kodolt.
+ * A BLOCK_ADAPTIVE blokk egymenetes adaptiv (FGK) Huffman koddal kodolt, a fat a dekodolo a bajtokbol epiti fel.
+ * A BLOCK_TABLE blokk egy beepitett kodtabla fajaval kodolt, a fa helyen csak a tabla egy bajtos azonositoja all.
+ * A BLOCK_DICT blokk egy kulso (--dict) szotar fajaval kodolt, a fa helyen a szotar 8 bajtos hash-e all.
+ * A BLOCK_HUFFMAN_REF blokk egy korabbi Huffman blokk fajaval kodolt, a fa helyen egy bajt all: hany Huffman blokkal
+ * korabbi fat hasznal (0 a legutobbi, ezt a BLOCK_HUFFMAN_REUSE fa nelkul is jeloli).
+ * A BLOCK_CONTEXT blokk rendu-1 kontextussal kodolt: minden bajtot az elozo bajt kontextus-osztalyanak fajaval kodolunk.
+ * A fa helyen az elozo bajt 256 lehetseges ertekenek osztalya (egy-egy bajt), majd osztalyonkent a fa pontjainak
+ * szama (long) es a pontok allnak. A blokk elso bajtjanal az elozo bajt 0.
+ * A BLOCK_ANS blokk tablas ANS (tANS) koddal kodolt, a fa helyen a normalizalt gyakorisagok tablaja all.
+ * A BLOCK_LZ blokk LZ77 szekvenciak (literal-futas, literalok, egyezes hossza es tavolsaga) Huffman kodja; a fa helyen
+ * a negy abece fai allnak egymas utan, mindegyik elott a pontjainak szama (long).
+ * A BLOCK_BWT blokk Burrows-Wheeler transzformalt, MTF es nullafutas kodolt adat Huffman kodja; a fa helyen a
+ * reszblokkok primer indexei (long), majd a ket abece fai allnak.
+ * A BLOCK_WIDE blokk 16 bites (kis-endian bajtparokbol allo) szimbolumok hosszkorlatos kanonikus Huffman kodja; a fa
+ * helyen a hasznalt szimbolumok szama (long), majd szimbolum szerint novekvo sorrendben szimbolumonkent a ket bajtja es
+ * a kod hossza all. Paratlan meretnel az utolso bajt egyedul alkot szimbolumot.
+ * A BLOCK_WORDS blokk szavak es elvalasztok (azonos osztalyu bajtok leghosszabb sorozatai) szotarbeli azonositoinak
+ * kanonikus Huffman kodja; a ritka szavakat egy kikerulo azonosito utan a hosszuk es a bajtjaik kodjaval irjuk le.
+ * A fa helyen a szotar merete (long), a szavak (egy bajt hossz, majd a bajtok), majd a harom abece kodtablaja all.
+ */
+typedef enum {
+    BLOCK_HUFFMAN = 0,
+    BLOCK_STORED = 1,
+    BLOCK_CONSTANT = 2,
+    BLOCK_RLE = 3,
+    BLOCK_HUFFMAN_REUSE = 4,
+    BLOCK_ADAPTIVE = 5,
+    BLOCK_TABLE = 6,
+    BLOCK_DICT = 7,
+    BLOCK_HUFFMAN_REF = 8,
+    BLOCK_CONTEXT = 9,
+    BLOCK_ANS = 10,
+    BLOCK_LZ = 11,
+    BLOCK_BWT = 12,
+    BLOCK_WIDE = 13,
+    BLOCK_WORDS = 14
+} Block_type;
+
+// A fejlecben a block_type bajt ezen bitje jelzi, hogy a tipus utan a szuro azonositoja es parametere all.
+#define BLOCK_FILTERED 0x80
+
+// A tag utolso blokkja utan ez a block_type bajt all, utana uj tag, a mappa index vagy a fajl vege kovetkezik.
+#define BLOCK_END 0x7F
+
+/*
+ * A tag adatan a kodolas elott vegzett (es kitomoriteskor visszaforditott) atalakitas.
+ * A FILTER_SHUFFLE csak az elso tagon allhat, es a teljes kitomoritett adatra vonatkozik: az adat filter_width bajtos
+ * rekordok bajtsikjaira bontott alakja (lasd shuffle_bytes).
+ * A FILTER_DELTA es a FILTER_XOR egy-egy tagra vonatkozik: a tag adata filter_width bajtos (1, 2, 4 vagy 8, illetve
+ * 4 vagy 8) ertekek kulonbsege, illetve bitenkenti XOR-ja az elozo ertekkel (az elso ertek elott 0 all).
+ * A FILTER_COLUMNS is csak az elso tagon allhat: a teljes kitomoritett adat egy fejlec (az elvalaszto bajt es
+ * filter_width darab long oszlophossz), majd a tagolt rekordok filter_width oszlopfolyama (lasd split_columns).
+ */
+typedef enum {
+    FILTER_NONE = 0,
+    FILTER_SHUFFLE = 1,
+    FILTER_DELTA = 2,
+    FILTER_XOR = 3,
+    FILTER_COLUMNS = 4
+} Filter_type;
+
+// Ennyi legutobbi Huffman fara hivatkozhat egy BLOCK_HUFFMAN_REF blokk.
+#define TREE_HISTORY_SIZE 16
+
+/*
+ * A legutobbi TREE_HISTORY_SIZE Huffman blokk fai korkoros tarban, a legujabb a newest indexen.
+ * A kodolo es a dekodolo ugyanigy tartja nyilvan, igy a visszafele szamolt tavolsag mindket oldalon ugyanazt a fat jelenti.
+ */
+typedef struct {
+    Node *trees[TREE_HISTORY_SIZE];
+    long tree_sizes[TREE_HISTORY_SIZE];
+    int count;
+    int newest;
+} Tree_history;
+
+/*
+ * Az adaptiv Huffman fa egy pontja. A tombbeli index egyben a pont sorszama: a sulyok az indexszel
+ * nem csokkennek (testver tulajdonsag), a gyoker a legnagyobb indexu pont. A symbol -1 belso pontnal es az NYT-nel.
+ */
+typedef struct {
+    long weight;
+    int parent;
+    int left;
+    int right;
+    int symbol;
+} Adaptive_node;
+
+/*
+ * Az adaptiv (FGK) Huffman kodolo es dekodolo kozos allapota. A leaf a bajtok levelenek indexe (-1, ha meg nem fordult elo),
+ * az nyt a meg nem latott bajtokat jelolo level indexe.
+ */
+typedef struct {
+    Adaptive_node nodes[513];
+    int leaf[256];
+    int nyt;
+} Adaptive_tree;
+
+/*
+ * A tomoritett fajl egy blokkjanak minden fontos adatat tartalmazza: az azonosito szam, fajlnevek, fa, tomoritett adat es meretek.
  * A compress es decompress, valamint a read es write_compressed funkciok ezt a strukturat ertelmezik.
  * A tomoritett adat meretet bitekben tarolja, igy tudja kezelni a nem teljes bajtnyi tomoritett adatot. (pl. 21 bit)
+ * A fajlban egy tag fejlece (magic, format_version, is_dir, az eredeti nev) egyszer all, utana a blokkok kovetkeznek,
+ * es a tagot egy BLOCK_END bajt zarja. Blokkonkent csak a tipus, a meretek, a fa es a kodolt adat tarolodik.
+ * A block_type egy Block_type ertek, a fajlban egyetlen bajton tarolodik. Ha a blokkon szuro van (filter nem FILTER_NONE),
+ * a bajt legfelso bitje (BLOCK_FILTERED) is be van allitva, es utana a szuro azonositoja es parametere kovetkezik.
  */
 typedef struct {
     char magic[4];
     bool is_dir;
+    unsigned char block_type;
+    unsigned char filter;
+    unsigned char filter_width;
     char *file_name;
     long original_size;
     char *original_file;
@@ -46,6 +171,111 @@ typedef struct {
     long data_size; // In bits.
 } Compressed_file;
 
+// Egy tobb abeces kodolas (pl. LZ77 szekvenciak) legfeljebb ennyi, egyenkent legfeljebb 256 szimbolumos abecet hasznal.
+#define ALPHABET_MAX 4
+
+/*
+ * Egy blokk abecenkenti Huffman fai. Az ures abece fa nelkuli (nodes NULL, node_count 0). Kodolaskor a fak a modell
+ * tulajdonai, dekodolaskor a tag fa mezojebe mutatnak.
+ */
+typedef struct {
+    int alphabet_count;
+    Node *nodes[ALPHABET_MAX];
+    Node *roots[ALPHABET_MAX];
+    long node_counts[ALPHABET_MAX];
+} Alphabet_model;
+
+/*
+ * A tobb abeces kodolo kimenete. Ha a codes NULL, csak szamol (abecenkent a gyakorisagokat es az extra biteket),
+ * kulonben a model fai szerinti kodokat (a codes gyorsitotarban) es az extra biteket az out bitfolyamba irja.
+ */
+typedef struct {
+    long frequencies[ALPHABET_MAX][256];
+    long extra_bits;
+    char **codes;
+    unsigned char *out;
+    long capacity;
+    long bits;
+    Alphabet_model *model;
+} Symbol_sink;
+
+// A hosszkorlatos kanonikus kodok (--wide, --words) leghosszabb kodszava bitekben.
+#define CANONICAL_LENGTH_MAX 24
+
+/*
+ * Legfeljebb 65536 szimbolumos abece hosszkorlatos kanonikus kodja: szimbolumonkent a kod hossza (0, ha nem fordul elo)
+ * es a kodszo. A hasznalt szimbolumok szama a tarolt kodtabla meretet adja.
+ */
+typedef struct {
+    long alphabet_size;
+    long used_count;
+    unsigned char *lengths;
+    uint32_t *codes;
+} Canonical_code;
+
+/*
+ * A kanonikus kod dekodolasahoz: hosszankent a kodszavak szama, es a szimbolumok (hossz, majd ertek szerint rendezve).
+ */
+typedef struct {
+    long length_counts[CANONICAL_LENGTH_MAX + 1];
+    uint16_t *sorted;
+} Canonical_decoder;
+
+// A szavas kodolas (--words) abecei: szo-azonosito (0 a kikerules), kikerulo szo hossza, kikerulo szo bajtjai.
+#define WORDS_ALPHABETS 3
+
+/*
+ * A szavas kodolas hash tablajanak eleme: egy szo (vagy elvalaszto) a blokkban, elofordulasainak szama es
+ * azonositoja a szotarban (0, ha nem kerult bele).
+ */
+typedef struct {
+    uint64_t hash;
+    const char *data;
+    long size;
+    long count;
+    long id;
+} Word_entry;
+
+/* A szotar rendezesenek eleme: a szo gyakorisaga es helye a hash tablaban. */
+typedef struct {
+    long count;
+    long slot;
+} Word_rank;
+
+/*
+ * Egy blokk szavas kodja: a blokk szavainak hash tablaja, a szotar (azonosito szerint a tabla elemeire mutat),
+ * az abecek kanonikus kodjai es a kodolt adat bitszama.
+ */
+typedef struct {
+    Word_entry *table;
+    long table_size;
+    long vocabulary_count;
+    long *vocabulary;
+    Canonical_code codes[WORDS_ALPHABETS];
+    long bits;
+} Words_model;
+
+/*
+ * Egy blokk BWT + MTF alaku kepe: reszblokkonkent az eredeti sor indexe a rendezett forgatasok kozott, az MTF
+ * kimenet es a nullafutas-kodolas abeceinek fai.
+ */
+typedef struct {
+    unsigned char *mtf;
+    long *primary;
+    long block_count;
+    Alphabet_model model;
+} Bwt_block;
+
+/*
+ * Betoltott kulso szotar: a tanito korpusz bajtgyakorisagai, ezek hash-e (ez azonositja a szotart a tomoritett fajlban)
+ * es a gyakorisagokbol epitett, mind a 256 bajtot tartalmazo Huffman fa, amelynek gyokere a nodes[510].
+ */
+typedef struct {
+    long weights[256];
+    uint64_t hash;
+    Node nodes[511];
+} Dictionary;
+
 // A segedfuggvenyek hibakodjait tarolja.
 typedef enum {
     SUCCESS = 0,
@@ -63,9 +293,31 @@ typedef enum {
     EMPTY_DIRECTORY = -11,
     MKDIR_ERROR = -12,
     DIRECTORY_ERROR = -13,
-    EMPTY_FILE = -14
+    EMPTY_FILE = -14,
+    INCREMENTAL_BASE_ERROR = -15,
+    PATH_ERROR = -16,
+    OUTPUT_LIMIT = -17
 } Error_code;
 
+/*
+ * Egy osszefuggo adatszelet. A tomorito ilyen szeletek sorozatat egyetlen folytonos
+ * bemenetkent kodolja, igy a szerializalt mappa fejlecei es fajltartalmai masolas nelkul adhatok at.
+ */
+typedef struct {
+    char *data;
+    long size;
+} Data_segment;
+
+/*
+ * Egy fajl tartalomfuggoen vagott darabja (chunk). A ref -1, ha a darab itt tarolodik eloszor,
+ * kulonben egy korabban tarolt egyedi darab sorszamara hivatkozik. A data mindket esetben a darab bajtjaira mutat.
+ */
+typedef struct {
+    char *data;
+    long size;
+    int ref;
+} File_chunk;
+
 typedef struct {
     bool is_dir;
     union {
@@ -77,16 +329,100 @@ typedef struct {
             long file_size;
             char *file_path;
             char *file_data;
+            uint64_t file_hash;
+            /* Ha nem 0, a fajl tartalma megegyezik az archivum ezen indexu fajljaval, es nincs kulon tarolva.
+             * A 0. elem mindig a gyoker mappa, ezert a 0 ertek sosem jelol ervenyes forrast. */
+            int duplicate_of;
+            /* Darabolt tarolas eseten a fajl tartalmat a darabok sorozata adja, kulonben chunk_count 0. */
+            File_chunk *chunks;
+            int chunk_count;
+            long file_mtime;
+            long file_mtime_nsec;
+            unsigned long file_inode;
+            /* Inkrementalis archivumban: a fajl nem valtozott az alap archivum ota, tartalma nincs tarolva. */
+            bool in_base;
         };
     };
 } Directory_item;
 
+// Egy fajl bejegyzese a mappa archivum indexeben.
+typedef struct {
+    char *path;
+    long file_size;
+    long mtime;
+    long mtime_nsec;
+    unsigned long inode;
+    uint64_t hash;
+} Index_entry;
+
+/*
+ * Egy mappa archivum tomoritetlen indexe. A bejegyzesek utvonalai a paths bufferbe mutatnak,
+ * a slots nyilt cimzesu hash tabla az utvonal szerinti kereseshez (bejegyzes index + 1, 0 = ures).
+ */
+typedef struct {
+    Index_entry *entries;
+    int entry_count;
+    char *paths;
+    int *slots;
+    int slot_count;
+} Archive_index;
+
+/*
+ * Szeletekre bontott, szerializalt mappa. A szeletek felvaltva a headers bufferbe (bejegyzes fejlecek)
+ * es az archivum fajltartalmaiba mutatnak, ezert az archivumot a szeletekkel egyutt kell felszabaditani.
+ */
+typedef struct {
+    Directory_item *archive;
+    int archive_size;
+    char *headers;
+    Data_segment *segments;
+    int segment_count;
+    long data_len;
+} Directory_stream;
+
 typedef struct {
     bool compress_mode;
     bool extract_mode;
     bool force;
     bool directory;
     bool no_preserve_perms;
+    bool chunk_dedup;
+    bool sync;
+    /* Egymenetes adaptiv Huffman tomorites, a bemenet folyamkent (akar a szabvanyos bemenetrol) olvashato. */
+    bool adaptive;
+    /* A fat az adat mintajabol epiti, igy a bemenetet csak egyszer (a kodolaskor) olvassa vegig. */
+    bool fast;
+    /* A koltsegmodell a rendu-1 kontextusos kodolast is merlegeli (lassabb, de strukturalt szovegen kisebb kimenetet ad). */
+    bool context;
+    /* A koltsegmodell a Huffman mellett a tANS entropiakodolot is merlegeli (ferde eloszlasnal bajtonkent 1 bitnel kevesebbet is kodolhat). */
+    bool ans;
+    /* Ha nem 0, a koltsegmodell az ekkora ablaku LZ77 elofeldolgozast (Huffman kodolt szekvenciakkal) is merlegeli. */
+    int lz_window;
+    /* A koltsegmodell a Burrows-Wheeler transzformaciot (MTF es nullafutas-kodolassal) is merlegeli; lassu, de nagy tomoritesi aranyu. */
+    bool bwt;
+    /* A koltsegmodell a 16 bites szimbolumokkal (bajtparokkal) valo Huffman kodolast is merlegeli (--wide). */
+    bool wide;
+    /* A koltsegmodell a szavakra bontott, szotarazonositokkal valo kodolast is merlegeli (--words, naplokhoz es szoveghez). */
+    bool words;
+    /* Ha nem 0, a bemenetet ilyen szelessegu rekordok bajtsikjaira bontja a kodolas elott (--shuffle=N). */
+    int shuffle;
+    /* A tagolt (CSV, TSV) rekordok mezoit oszloponkent kulon folyamba (es kulon blokkba) bontja a kodolas elott (--columnar). */
+    bool columnar;
+    /* Blokkonkent merlegeli a szamfolyamok delta (8/16/32/64 bites egesz) es XOR (lebegopontos) elorejelzeset (--numeric). */
+    bool numeric;
+    /* A megadott nevu beepitett kodtablaval kodol (--table=NEV), szamlalas nelkul; NULL eseten a tablakat csak ajanlja a koltsegmodell. */
+    char *table;
+    /* A koltsegmodell nem ajanlja a beepitett kodtablakat, minden blokk sajat vagy korabbi fat hasznal (--no-tables). */
+    bool no_tables;
+    /* Szotar tanitasa (--train): a bemenet a korpusz mappa vagy fajl, a kimenet a szotarfajl. */
+    bool train;
+    /* Kulso szotarfajl (--dict): tomoriteskor ezzel kodol, kitomoriteskor ez adja a DICT blokkok fajat. */
+    char *dict;
+    char *incremental_from;
+    /* Hozzafuzes modban (-A) ehhez az archivumhoz adjuk hozza az input_files fajljait. */
+    char *append_archive;
+    char **input_files;
+    int input_count;
     char *input_file;
     char *output_file;
 } Arguments;
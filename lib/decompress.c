@@ -7,7 +7,17 @@
 #include <stdlib.h>
 #include "file.h"
 #include "decompress.h"
+#include "compress.h"
 #include "directory.h"
+#include "adaptive.h"
+#include "tables.h"
+#include "dictionary.h"
+#include "ans.h"
+#include "lz.h"
+#include "bwt.h"
+#include "filter.h"
+#include "wide.h"
+#include "words.h"
 
 /*
  * A Huffman fat bejarva ujra eloallitja az eredeti adatokat bitrol bitre.
@@ -57,8 +67,166 @@ int decompress(Compressed_file *compressed, char *raw) {
     return 0;
 }
 
+/*
+ * Az RLE blokk (bajt, varint hossz) parjait memset-tel bontja ki. Hibat ad vissza, ha a futasok
+ * osszhossza nem egyezik az eredeti merettel, vagy a kodolt adat csonka.
+ */
+static int decompress_rle(Compressed_file *compressed, char *raw) {
+    long encoded_size = compressed->data_size / 8;
+    unsigned char *data = (unsigned char*)compressed->compressed_data;
+    long pos = 0;
+    long current_raw = 0;
+    while (pos < encoded_size) {
+        unsigned char value = data[pos++];
+        long run = 0;
+        int shift = 0;
+        while (true) {
+            if (pos >= encoded_size || shift > 56) return DECOMPRESSION_ERROR;
+            unsigned char byte = data[pos++];
+            run |= (long)(byte & 0x7F) << shift;
+            shift += 7;
+            if ((byte & 0x80) == 0) break;
+        }
+        if (run <= 0 || run > compressed->original_size - current_raw) return DECOMPRESSION_ERROR;
+        memset(raw + current_raw, value, run);
+        current_raw += run;
+    }
+    return current_raw == compressed->original_size ? 0 : DECOMPRESSION_ERROR;
+}
+
+/*
+ * Az adaptiv Huffman blokkot a kodoloval azonos modon frissulo faval, bajtonkent dekodolja.
+ */
+static int decompress_adaptive(Compressed_file *compressed, char *raw) {
+    Adaptive_tree *tree = malloc(sizeof(Adaptive_tree));
+    if (tree == NULL) return MALLOC_ERROR;
+    adaptive_init(tree);
+    long bit_pos = 0;
+    int res = 0;
+    for (long i = 0; i < compressed->original_size; i++) {
+        int symbol = adaptive_decode(tree, (unsigned char*)compressed->compressed_data, compressed->data_size, &bit_pos);
+        if (symbol < 0) {
+            res = DECOMPRESSION_ERROR;
+            break;
+        }
+        raw[i] = (char)symbol;
+    }
+    free(tree);
+    return res;
+}
+
+/*
+ * Rendu-1 kontextusos blokk kitomoritese: a fa helyen allo osztalytablabol es fakbol minden bajtot az elozo bajt
+ * osztalyanak fajaval dekodol. Az egyetlen levelu fa bajtja nem fogyaszt bitet.
+ */
+static int decompress_context(Compressed_file *compressed, char *raw) {
+    if (compressed->tree_size < 256) return DECOMPRESSION_ERROR;
+    unsigned char *bucket_of = (unsigned char*)compressed->huffman_tree;
+    Node *nodes[256];
+    long node_counts[256];
+    int bucket_count = 0;
+    for (int c = 0; c < 256; c++) {
+        if (bucket_of[c] >= bucket_count) bucket_count = bucket_of[c] + 1;
+    }
+    long offset = 256;
+    for (int b = 0; b < bucket_count; b++) {
+        if (offset + (long)sizeof(long) > compressed->tree_size) return DECOMPRESSION_ERROR;
+        memcpy(&node_counts[b], (char*)compressed->huffman_tree + offset, sizeof(long));
+        offset += sizeof(long);
+        if (node_counts[b] < 0 || node_counts[b] > 511 || offset + node_counts[b] * (long)sizeof(Node) > compressed->tree_size) {
+            return DECOMPRESSION_ERROR;
+        }
+        nodes[b] = (Node*)((char*)compressed->huffman_tree + offset);
+        offset += node_counts[b] * sizeof(Node);
+    }
+    if (offset != compressed->tree_size) return DECOMPRESSION_ERROR;
+
+    unsigned char *data = (unsigned char*)compressed->compressed_data;
+    long bit_pos = 0;
+    unsigned char previous = 0;
+    for (long i = 0; i < compressed->original_size; i++) {
+        int bucket = bucket_of[previous];
+        if (node_counts[bucket] == 0) return DECOMPRESSION_ERROR;
+        Node *tree = nodes[bucket];
+        long current_node = node_counts[bucket] - 1;
+        while (tree[current_node].type != LEAF) {
+            if (bit_pos >= compressed->data_size) return DECOMPRESSION_ERROR;
+            bool bit = data[bit_pos / 8] & (1 << (7 - bit_pos % 8));
+            current_node = bit ? tree[current_node].right : tree[current_node].left;
+            if (current_node < 0 || current_node >= node_counts[bucket]) return DECOMPRESSION_ERROR;
+            bit_pos++;
+        }
+        raw[i] = tree[current_node].data;
+        previous = (unsigned char)raw[i];
+    }
+    return 0;
+}
+
+/*
+ * Egy tomoritett tag kitomoritese a blokk tipusanak megfeleloen: a Huffman blokkot a decompress
+ * dekodolja (ujrahasznalt fa eseten a hivo tolti be a korabbi fat), a tarolt blokk bajtjait valtozatlanul
+ * masolja, a konstans es RLE blokkokat memset-tel tolti ki. Ismeretlen tipus eseten hibat ad vissza.
+ */
+int decompress_block(Compressed_file *compressed, char *raw) {
+    switch (compressed->block_type) {
+        case BLOCK_HUFFMAN:
+        case BLOCK_HUFFMAN_REUSE:
+        case BLOCK_HUFFMAN_REF:
+        case BLOCK_DICT:
+            return decompress(compressed, raw);
+        case BLOCK_STORED:
+            if (compressed->data_size != compressed->original_size * 8) {
+                return DECOMPRESSION_ERROR;
+            }
+            memcpy(raw, compressed->compressed_data, compressed->original_size);
+            return 0;
+        case BLOCK_CONSTANT:
+            if (compressed->data_size != 8) {
+                return DECOMPRESSION_ERROR;
+            }
+            memset(raw, compressed->compressed_data[0], compressed->original_size);
+            return 0;
+        case BLOCK_RLE:
+            return decompress_rle(compressed, raw);
+        case BLOCK_ADAPTIVE:
+            return decompress_adaptive(compressed, raw);
+        case BLOCK_CONTEXT:
+            return decompress_context(compressed, raw);
+        case BLOCK_LZ:
+            return lz_decode((char*)compressed->huffman_tree, compressed->tree_size,
+                             (unsigned char*)compressed->compressed_data, compressed->data_size, raw, compressed->original_size);
+        case BLOCK_BWT:
+            return bwt_decode((char*)compressed->huffman_tree, compressed->tree_size,
+                              (unsigned char*)compressed->compressed_data, compressed->data_size, raw, compressed->original_size);
+        case BLOCK_WIDE:
+            return wide_decode((char*)compressed->huffman_tree, compressed->tree_size,
+                               (unsigned char*)compressed->compressed_data, compressed->data_size, raw, compressed->original_size);
+        case BLOCK_WORDS:
+            return words_decode((char*)compressed->huffman_tree, compressed->tree_size,
+                                (unsigned char*)compressed->compressed_data, compressed->data_size, raw, compressed->original_size);
+        case BLOCK_ANS:
+            return ans_decode((unsigned char*)compressed->huffman_tree, compressed->tree_size,
+                              (unsigned char*)compressed->compressed_data, compressed->data_size, raw, compressed->original_size);
+        case BLOCK_TABLE: {
+            /* A fa helyen a beepitett tabla azonositoja all, a tabla fajat a kodoloval azonosan epitjuk fel. */
+            Node *nodes = NULL;
+            Node *root_node = NULL;
+            if (compressed->tree_size != 1 || get_static_tree(*(unsigned char*)compressed->huffman_tree, &nodes, &root_node) != 0) {
+                return DECOMPRESSION_ERROR;
+            }
+            Compressed_file table_block = *compressed;
+            table_block.huffman_tree = nodes;
+            table_block.tree_size = ((root_node - nodes) + 1) * sizeof(Node);
+            return decompress(&table_block, raw);
+        }
+        default:
+            return DECOMPRESSION_ERROR;
+    }
+}
+
 /*
  * Beolvassa a tomoritett fajlt, dekodolja a Huffman adatokat es visszaadja a nyers tartalmat.
+ * Tobb tagbol allo (blokkokra bontott vagy hozzafuzott) fajl eseten a tagok kitomoritett tartalmat sorban osszefuzi.
  * A kimenet feldolgozasarol (fajl iras, mappa visszaallitasa) a hivo gondoskodik. A ki-
  * menetkent adott pointereknek ervenyes, nem NULL ertekeknek kell lenniuk, mert a hivo
  * (a fo orchestracio) szallitja oket.
@@ -70,61 +238,223 @@ int run_decompression(Arguments args, char **raw_data, long *raw_size, bool *is_
     *original_name = NULL;
 
     Compressed_file *compressed_file = NULL;
+    Tree_history history = {0};
+    Dictionary *dictionary = NULL;
+    FILE *f = NULL;
+    int shuffle_width = 0;
+    int column_count = 0;
     int res = 0;
 
     while (true) {
-        compressed_file = calloc(1, sizeof(Compressed_file));
-        if (compressed_file == NULL) {
-            printf("Nem sikerult lefoglalni a memoriat.\n");
-            res = ENOMEM;
-            break;
-        }
-
-        int read_res = read_compressed(args.input_file, compressed_file);
-        if (read_res != 0) {
-            if (read_res == FILE_MAGIC_ERROR) {
-                printf("A tomoritett fajl (%s) serult, nem sikerult beolvasni.\n", args.input_file);
-                res = EBADF;
-                break;
-            }
+        f = fopen(args.input_file, "rb");
+        if (f == NULL) {
             printf("Nem sikerult beolvasni a tomoritett fajlt (%s).\n", args.input_file);
             res = EIO;
             break;
         }
-
-        if (compressed_file->original_size <= 0) {
+        /* A mappa archivumok vegen levo index nem tartozik a tomoritett tagokhoz. */
+        long payload_end = get_payload_end(f);
+        if (payload_end < 0 || fseek(f, 0, SEEK_SET) != 0) {
             printf("A tomoritett fajl (%s) serult, nem sikerult beolvasni.\n", args.input_file);
-            res = EINVAL;
+            res = EBADF;
             break;
         }
 
-        *raw_data = malloc(compressed_file->original_size * sizeof(char));
-        if (*raw_data == NULL) {
+        compressed_file = calloc(1, sizeof(Compressed_file));
+        if (compressed_file == NULL) {
             printf("Nem sikerult lefoglalni a memoriat.\n");
             res = ENOMEM;
             break;
         }
 
-        int decompress_result = decompress(compressed_file, *raw_data);
-        if (decompress_result != 0) {
-            printf("Nem sikerult a kitomorites.\n");
-            res = EIO;
-            break;
+        /* Egy tag fejlece utan a blokkjai kovetkeznek; hozzafuzott archivumban tobb tag is lehet egymas utan. */
+        bool first_block = true;
+        while (first_block || ftell(f) < payload_end) {
+            int read_res = read_member_header(f, compressed_file);
+            if (read_res == SUCCESS && !first_block && compressed_file->is_dir != *is_directory) {
+                read_res = FILE_MAGIC_ERROR;
+            }
+            if (read_res == SUCCESS && first_block) {
+                *is_directory = compressed_file->is_dir;
+                *original_name = strdup(compressed_file->original_file);
+                if (*original_name == NULL) read_res = MALLOC_ERROR;
+            }
+            free(compressed_file->original_file);
+            compressed_file->original_file = NULL;
+            if (read_res == MALLOC_ERROR) {
+                printf("Nem sikerult lefoglalni a memoriat.\n");
+                res = ENOMEM;
+                break;
+            }
+            if (read_res != 0) {
+                if (read_res == FILE_MAGIC_ERROR) {
+                    printf("A tomoritett fajl (%s) serult, nem sikerult beolvasni.\n", args.input_file);
+                    res = EBADF;
+                    break;
+                }
+                printf("Nem sikerult beolvasni a tomoritett fajlt (%s).\n", args.input_file);
+                res = EIO;
+                break;
+            }
+
+            bool member_empty = true;
+            while (true) {
+                read_res = read_compressed_block(f, compressed_file);
+                if (read_res != 0) {
+                    if (read_res == FILE_MAGIC_ERROR) {
+                        printf("A tomoritett fajl (%s) serult, nem sikerult beolvasni.\n", args.input_file);
+                        res = EBADF;
+                        break;
+                    }
+                    printf("Nem sikerult beolvasni a tomoritett fajlt (%s).\n", args.input_file);
+                    res = EIO;
+                    break;
+                }
+                if (compressed_file->block_type == BLOCK_END) break;
+                member_empty = false;
+
+                /* A keveres es az oszlopos bontas csak az elso blokkon allhat, es a teljes adatra vonatkozik; az elorejelzes blokkonkenti. */
+                bool whole_filter = compressed_file->filter == FILTER_SHUFFLE || compressed_file->filter == FILTER_COLUMNS;
+                bool bad_filter = whole_filter ? !first_block || compressed_file->filter_width < 2
+                        || (compressed_file->filter == FILTER_COLUMNS && compressed_file->filter_width > COLUMNS_MAX)
+                        : compressed_file->filter != FILTER_NONE && !valid_prediction(compressed_file->filter, compressed_file->filter_width);
+                if (compressed_file->original_size <= 0 || bad_filter) {
+                    printf("A tomoritett fajl (%s) serult, nem sikerult beolvasni.\n", args.input_file);
+                    res = EINVAL;
+                    break;
+                }
+
+                char *temp = realloc(*raw_data, (*raw_size + compressed_file->original_size) * sizeof(char));
+                if (temp == NULL) {
+                    printf("Nem sikerult lefoglalni a memoriat.\n");
+                    res = ENOMEM;
+                    break;
+                }
+                *raw_data = temp;
+
+                /* Az ujrahasznalt fat egy korabbi Huffman blokktol kolcsonozzuk, a blokk legfeljebb a tavolsagot tarolja. */
+                if (compressed_file->block_type == BLOCK_HUFFMAN_REUSE || compressed_file->block_type == BLOCK_HUFFMAN_REF) {
+                    int distance = 0;
+                    if (compressed_file->block_type == BLOCK_HUFFMAN_REF) {
+                        distance = compressed_file->tree_size == 1 ? *(unsigned char*)compressed_file->huffman_tree : -1;
+                    }
+                    long tree_size = 0;
+                    Node *tree = get_history_tree(&history, distance, &tree_size);
+                    if (tree == NULL) {
+                        printf("A tomoritett fajl (%s) serult, nem sikerult beolvasni.\n", args.input_file);
+                        res = EINVAL;
+                        break;
+                    }
+                    free(compressed_file->huffman_tree);
+                    compressed_file->huffman_tree = tree;
+                    compressed_file->tree_size = tree_size;
+                }
+                /* A szotaras blokk a fa helyen a szotar hash-et tarolja; a fat a --dict szotarbol vesszuk, ha a hash egyezik. */
+                if (compressed_file->block_type == BLOCK_DICT) {
+                    if (args.dict == NULL) {
+                        printf("A fajl (%s) kitomoritesehez meg kell adni a tomoriteskor hasznalt szotarat (--dict).\n", args.input_file);
+                        res = EINVAL;
+                        break;
+                    }
+                    if (dictionary == NULL) {
+                        dictionary = malloc(sizeof(Dictionary));
+                        if (dictionary == NULL) {
+                            printf("Nem sikerult lefoglalni a memoriat.\n");
+                            res = ENOMEM;
+                            break;
+                        }
+                        if (load_dictionary(args.dict, dictionary) != 0) {
+                            printf("Nem sikerult beolvasni a szotarfajlt (%s).\n", args.dict);
+                            res = EIO;
+                            break;
+                        }
+                    }
+                    if (compressed_file->tree_size != DICTIONARY_HASH_SIZE
+                            || memcmp(compressed_file->huffman_tree, &dictionary->hash, DICTIONARY_HASH_SIZE) != 0) {
+                        printf("A megadott szotar (%s) nem az, amellyel a fajlt (%s) tomoritettek.\n", args.dict, args.input_file);
+                        res = EINVAL;
+                        break;
+                    }
+                    free(compressed_file->huffman_tree);
+                    compressed_file->huffman_tree = dictionary->nodes;
+                    compressed_file->tree_size = sizeof(dictionary->nodes);
+                }
+                int decompress_result = decompress_block(compressed_file, *raw_data + *raw_size);
+                if (compressed_file->block_type == BLOCK_HUFFMAN_REUSE || compressed_file->block_type == BLOCK_HUFFMAN_REF
+                        || compressed_file->block_type == BLOCK_DICT) {
+                    compressed_file->huffman_tree = NULL;
+                } else if (compressed_file->block_type == BLOCK_HUFFMAN) {
+                    push_tree_history(&history, compressed_file->huffman_tree, compressed_file->tree_size);
+                    compressed_file->huffman_tree = NULL;
+                }
+                if (decompress_result == 0 && compressed_file->filter != FILTER_NONE && !whole_filter) {
+                    decompress_result = unpredict_block(*raw_data + *raw_size, compressed_file->original_size,
+                                                        compressed_file->filter, compressed_file->filter_width);
+                }
+                if (decompress_result != 0) {
+                    printf("Nem sikerult a kitomorites.\n");
+                    res = EIO;
+                    break;
+                }
+                *raw_size += compressed_file->original_size;
+
+                if (first_block) {
+                    if (compressed_file->filter == FILTER_SHUFFLE) shuffle_width = compressed_file->filter_width;
+                    if (compressed_file->filter == FILTER_COLUMNS) column_count = compressed_file->filter_width;
+                    first_block = false;
+                }
+
+                free(compressed_file->huffman_tree);
+                free(compressed_file->compressed_data);
+                compressed_file->huffman_tree = NULL;
+                compressed_file->compressed_data = NULL;
+            }
+            if (res != 0) break;
+            /* Blokk nelkuli tagot nem irunk, ilyen csak serult fajlban lehet. */
+            if (member_empty) {
+                printf("A tomoritett fajl (%s) serult, nem sikerult beolvasni.\n", args.input_file);
+                res = EINVAL;
+                break;
+            }
         }
+        if (res != 0) break;
 
-        *raw_size = compressed_file->original_size;
-        *is_directory = compressed_file->is_dir;
-        *original_name = strdup(compressed_file->original_file);
-        if (*original_name == NULL) {
-            printf("Nem sikerult lefoglalni a memoriat.\n");
-            res = ENOMEM;
-            break;
+        if (shuffle_width > 0) {
+            char *unshuffled = malloc(*raw_size);
+            if (unshuffled == NULL) {
+                printf("Nem sikerult lefoglalni a memoriat.\n");
+                res = ENOMEM;
+                break;
+            }
+            unshuffle_bytes(*raw_data, *raw_size, shuffle_width, unshuffled);
+            free(*raw_data);
+            *raw_data = unshuffled;
+        }
+        if (column_count > 0) {
+            long joined_size = *raw_size - columns_header_size(column_count);
+            char *joined = malloc(joined_size > 0 ? joined_size : 1);
+            if (joined == NULL) {
+                printf("Nem sikerult lefoglalni a memoriat.\n");
+                res = ENOMEM;
+                break;
+            }
+            if (join_columns(*raw_data, *raw_size, column_count, joined) != 0) {
+                printf("A tomoritett fajl (%s) serult, nem sikerult beolvasni.\n", args.input_file);
+                free(joined);
+                res = EINVAL;
+                break;
+            }
+            free(*raw_data);
+            *raw_data = joined;
+            *raw_size = joined_size;
         }
         break;
     }
 
+    if (f != NULL) fclose(f);
+    free_tree_history(&history);
+    free(dictionary);
     if (compressed_file != NULL) {
-        free(compressed_file->file_name);
         free(compressed_file->original_file);
         free(compressed_file->huffman_tree);
         free(compressed_file->compressed_data);
@@ -134,6 +464,11 @@ int run_decompression(Arguments args, char **raw_data, long *raw_size, bool *is_
     if (res != 0 && raw_data != NULL && *raw_data != NULL) {
         free(*raw_data);
         *raw_data = NULL;
+        *raw_size = 0;
+    }
+    if (res != 0 && *original_name != NULL) {
+        free(*original_name);
+        *original_name = NULL;
     }
 
     return res;
@@ -0,0 +1,144 @@
+#include "dictionary.h"
+#include "compress.h"
+#include "data_types.h"
+#include "file.h"
+#include "hash.h"
+#include "debugmalloc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+/*
+ * Hozzaadja a frequencies tombhoz a fajl (vagy rekurzivan a mappa osszes fajljanak) bajtgyakorisagait.
+ * A fajlokat darabonkent olvassa, a buffer DICTIONARY_READ_CHUNK meretu. Siker eseten a beolvasott
+ * bajtok szamat adja vissza, hiba eseten negativ kodot. A szimbolikus linkeket kihagyja, igy egy
+ * onmagara mutato link sem okoz vegtelen rekurziot.
+ */
+static long count_corpus(char *path, char *buffer, long *frequencies) {
+    struct stat st;
+    if (lstat(path, &st) != 0) return FILE_READ_ERROR;
+
+    if (S_ISREG(st.st_mode)) {
+        FILE *f = fopen(path, "rb");
+        if (f == NULL) return FILE_READ_ERROR;
+        long total = 0;
+        size_t read_size;
+        while ((read_size = fread(buffer, sizeof(char), DICTIONARY_READ_CHUNK, f)) > 0) {
+            count_frequencies(buffer, read_size, frequencies);
+            total += read_size;
+        }
+        bool read_error = ferror(f);
+        fclose(f);
+        return read_error ? FILE_READ_ERROR : total;
+    }
+    if (!S_ISDIR(st.st_mode)) return 0;
+
+    DIR *directory = opendir(path);
+    if (directory == NULL) return DIRECTORY_OPEN_ERROR;
+    long total = 0;
+    while (true) {
+        struct dirent *dir = readdir(directory);
+        if (dir == NULL) break;
+        else if (strcmp(dir->d_name, ".") == 0 || strcmp(dir->d_name, "..") == 0) continue;
+
+        char *newpath = malloc(strlen(path) + strlen(dir->d_name) + 2);
+        if (newpath == NULL) {
+            total = MALLOC_ERROR;
+            break;
+        }
+        strcpy(newpath, path);
+        strcat(newpath, "/");
+        strcat(newpath, dir->d_name);
+        long count = count_corpus(newpath, buffer, frequencies);
+        free(newpath);
+        if (count < 0) {
+            total = count;
+            break;
+        }
+        total += count;
+    }
+    closedir(directory);
+    return total;
+}
+
+/*
+ * Beolvassa a --train altal irt szotarfajlt, kiszamolja a hash-et es felepiti a fat. A fa felepitese
+ * determinisztikus, igy a kodolo es a dekodolo ugyanazt a kodot kapja. Siker eseten 0-t, kulonben negativ kodot ad vissza.
+ */
+int load_dictionary(char *file_name, Dictionary *dictionary) {
+    char *data = NULL;
+    long read_res = read_raw(file_name, &data);
+    if (read_res < 0) return read_res == EMPTY_FILE ? FILE_MAGIC_ERROR : read_res;
+
+    int res = 0;
+    if (read_res != DICTIONARY_FILE_SIZE || memcmp(data, dict_magic, sizeof(dict_magic)) != 0) {
+        res = FILE_MAGIC_ERROR;
+    } else {
+        memcpy(dictionary->weights, data + sizeof(dict_magic), sizeof(dictionary->weights));
+        dictionary->hash = hash_data(data + sizeof(dict_magic), sizeof(dictionary->weights));
+        for (int i = 0; i < 256; i++) {
+            if (dictionary->weights[i] <= 0) res = FILE_MAGIC_ERROR;
+            dictionary->nodes[i] = construct_leaf(dictionary->weights[i], (char)i);
+        }
+        if (res == 0) {
+            sort_nodes(dictionary->nodes, 256);
+            construct_tree(dictionary->nodes, 256);
+        }
+    }
+    free(data);
+    return res;
+}
+
+/*
+ * A --train mod: a korpusz osszesitett bajtgyakorisagaibol szotarfajlt ir. Minden gyakorisaghoz 1-et adunk,
+ * hogy a korpuszban elo nem fordulo bajtoknak is legyen kodja. A hibakat kiirja, es errno jellegu kodot ad vissza.
+ */
+int run_training(Arguments args) {
+    if (args.output_file == NULL) {
+        printf("A --train modban az -o kapcsoloval meg kell adni a szotarfajlt.\n");
+        return EINVAL;
+    }
+
+    long frequencies[256] = {0};
+    char *buffer = malloc(DICTIONARY_READ_CHUNK);
+    if (buffer == NULL) {
+        printf("Nem sikerult lefoglalni a memoriat.\n");
+        return ENOMEM;
+    }
+    long corpus_size = count_corpus(args.input_file, buffer, frequencies);
+    free(buffer);
+    if (corpus_size < 0) {
+        printf("Nem sikerult beolvasni a korpuszt (%s).\n", args.input_file);
+        return EIO;
+    }
+    if (corpus_size == 0) {
+        printf("A korpusz (%s) ures.\n", args.input_file);
+        return EINVAL;
+    }
+
+    char data[DICTIONARY_FILE_SIZE];
+    memcpy(data, dict_magic, sizeof(dict_magic));
+    for (int i = 0; i < 256; i++) {
+        frequencies[i]++;
+    }
+    memcpy(data + sizeof(dict_magic), frequencies, sizeof(frequencies));
+    long write_res = write_raw(args.output_file, data, DICTIONARY_FILE_SIZE, args.force);
+    if (write_res < 0) {
+        if (write_res == NO_OVERWRITE) {
+            printf("A fajlt nem irtam felul, nem keszult szotar.\n");
+            return ECANCELED;
+        }
+        printf("Nem sikerult kiirni a szotarfajlt (%s).\n", args.output_file);
+        return EIO;
+    }
+
+    long shown_size = corpus_size;
+    printf("Szotar kesz.\n"
+            "Korpusz merete:   %ld%s\n"
+            "Szotar hash:      %016llx\n", shown_size, get_unit(&shown_size),
+                                          (unsigned long long)hash_data(data + sizeof(dict_magic), sizeof(frequencies)));
+    return SUCCESS;
+}
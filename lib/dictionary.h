@@ -0,0 +1,16 @@
+#ifndef DICTIONARY_H
+#define DICTIONARY_H
+
+#include "data_types.h"
+
+// A szotarfajl: azonosito, majd a 256 bajt gyakorisaga long-kent.
+#define DICTIONARY_FILE_SIZE (sizeof(dict_magic) + 256 * sizeof(long))
+// A DICT blokk fa helyen tarolt szotar-hash merete.
+#define DICTIONARY_HASH_SIZE 8
+// A korpusz fajljait ekkora darabokban olvassuk, igy a fajlok merete nincs korlatozva.
+#define DICTIONARY_READ_CHUNK 65536
+
+int load_dictionary(char *file_name, Dictionary *dictionary);
+int run_training(Arguments args);
+
+#endif // DICTIONARY_H
@@ -1,6 +1,8 @@
 #include "directory.h"
 #include "data_types.h"
 #include "file.h"
+#include "hash.h"
+#include "chunk.h"
 #include "debugmalloc.h"
 #include <stdlib.h>
 #include <stdbool.h>
@@ -12,11 +14,22 @@
 #include <stdio.h>
 #include <limits.h>
 
+static int parse_archive_view(Directory_item **archive, char *buffer, long buffer_size, long *consumed);
+
 /*
  * Rekurzivan bejarja a mappat es fajlonkent egy tombbe menti az adatokat.
  * Siker eseten a mappa meretet adja vissza bajtokban, hiba eseten negativ kodot.
  */
 long archive_directory(char *path, Directory_item **archive, int *current_index, int *archive_size) {
+    return archive_directory_incremental(path, archive, current_index, archive_size, NULL);
+}
+
+/*
+ * Az archive_directory inkrementalis valtozata. Ha a base index adott, azokat a fajlokat, amelyek
+ * merete, modositasi ideje es inode-ja megegyezik az indexben tarolttal, nem olvassa be: a bejegyzes
+ * in_base jelolest kap, es a meretet es hash-et az indexbol veszi at.
+ */
+long archive_directory_incremental(char *path, Directory_item **archive, int *current_index, int *archive_size, Archive_index *base) {
     DIR *directory = NULL;
     long dir_size = 0;
     long result = 0;
@@ -101,7 +114,7 @@ long archive_directory(char *path, Directory_item **archive, int *current_index,
                 }
                 (*archive_size)++;
                 (*archive)[(*current_index)++] = subdir;
-                long subdir_size = archive_directory(newpath, archive, current_index, archive_size);
+                long subdir_size = archive_directory_incremental(newpath, archive, current_index, archive_size, base);
                 if (subdir_size < 0) {
                     result = subdir_size;
                     break;
@@ -117,17 +130,34 @@ long archive_directory(char *path, Directory_item **archive, int *current_index,
                     current_item = file;
                     break;
                 }
-                file.file_size = read_raw(newpath, &file.file_data);
-                if (file.file_size < 0) {
-                    if (file.file_size == EMPTY_FILE) {
-                        /* Empty files are valid - include them with size 0 */
-                        file.file_size = 0;
-                        file.file_data = NULL;
-                    } else {
-                        result = FILE_READ_ERROR;
-                        current_item = file;
-                        break;
+                file.file_mtime = st.st_mtim.tv_sec;
+                file.file_mtime_nsec = st.st_mtim.tv_nsec;
+                file.file_inode = st.st_ino;
+                /* A modositasi idot nanoszekundumra hasonlitjuk, igy az ugyanabban a masodpercben modositott fajl is valtozottnak szamit. */
+                Index_entry *previous = base != NULL ? find_index_entry(base, newpath) : NULL;
+                if (previous != NULL && previous->file_size == st.st_size && previous->mtime == file.file_mtime
+                        && previous->mtime_nsec == file.file_mtime_nsec && previous->inode == file.file_inode) {
+                    /* A valtozatlan fajl tartalma az alap archivumban van, nem olvassuk be ujra. */
+                    file.in_base = true;
+                    file.file_size = previous->file_size;
+                    file.file_hash = previous->hash;
+                    file.file_data = NULL;
+                }
+                else {
+                    file.file_size = read_raw(newpath, &file.file_data);
+                    if (file.file_size < 0) {
+                        if (file.file_size == EMPTY_FILE) {
+                            /* Empty files are valid - include them with size 0 */
+                            file.file_size = 0;
+                            file.file_data = NULL;
+                        } else {
+                            result = FILE_READ_ERROR;
+                            current_item = file;
+                            break;
+                        }
                     }
+                    /* A hash-t az olvasas utan azonnal kiszamoljuk, amig az adat meg a gyorsitotarban van. */
+                    file.file_hash = hash_data(file.file_data, file.file_size);
                 }
                 dir_size += file.file_size;
                 Directory_item *temp = realloc(*archive, (*archive_size + 1) * sizeof(Directory_item));
@@ -164,27 +194,306 @@ long archive_directory(char *path, Directory_item **archive, int *current_index,
 }
 
 /*
- * Szerializalja az archivalt mappat egy bufferbe.
- * Siker eseten a buffer meretet adja vissza, hiba eseten negativ kodot.
+ * Hozzafuzi a tomoritett fajl vegehez az archivum fajljainak tomoritetlen indexet (utvonal, meret,
+ * modositasi ido, inode, hash). Az index a fajl vegerol visszafele olvashato, igy a kovetkezo
+ * inkrementalis mentes a tomoritett adat dekodolasa nelkul hasonlithat ossze.
+ * Ha previous adott (hozzafuzes), annak bejegyzesei is bekerulnek, kiveve amelyeket az archivum ujra tartalmaz.
+ * Siker eseten 0-t, hiba eseten negativ kodot ad vissza.
  */
-long serialize_archive(Directory_item *archive, int archive_size, char **buffer) {
+int write_archive_index(char *file_name, Archive_index *previous, Directory_item *archive, int archive_size) {
+    int entry_count = 0;
+    long index_size = sizeof(int);
+    int previous_count = previous != NULL ? previous->entry_count : 0;
+    bool *replaced = calloc(previous_count + 1, sizeof(bool));
+    if (replaced == NULL) return MALLOC_ERROR;
+    for (int i = 0; i < archive_size; i++) {
+        if (archive[i].is_dir || previous == NULL) continue;
+        Index_entry *old = find_index_entry(previous, archive[i].file_path);
+        if (old != NULL) replaced[old - previous->entries] = true;
+    }
+    for (int i = 0; i < previous_count; i++) {
+        if (replaced[i]) continue;
+        entry_count++;
+        index_size += 4 * sizeof(long) + sizeof(uint64_t) + strlen(previous->entries[i].path) + 1;
+    }
+    for (int i = 0; i < archive_size; i++) {
+        if (archive[i].is_dir) continue;
+        entry_count++;
+        index_size += 4 * sizeof(long) + sizeof(uint64_t) + strlen(archive[i].file_path) + 1;
+    }
+
+    char *buffer = malloc(index_size + sizeof(long) + sizeof(index_magic));
+    if (buffer == NULL) {
+        free(replaced);
+        return MALLOC_ERROR;
+    }
+    char *current = buffer;
+    for (int i = 0; i < previous_count; i++) {
+        if (replaced[i]) continue;
+        Index_entry *entry = &previous->entries[i];
+        memcpy(current, &entry->file_size, sizeof(long));
+        current += sizeof(long);
+        memcpy(current, &entry->mtime, sizeof(long));
+        current += sizeof(long);
+        memcpy(current, &entry->mtime_nsec, sizeof(long));
+        current += sizeof(long);
+        memcpy(current, &entry->inode, sizeof(long));
+        current += sizeof(long);
+        memcpy(current, &entry->hash, sizeof(uint64_t));
+        current += sizeof(uint64_t);
+        memcpy(current, entry->path, strlen(entry->path) + 1);
+        current += strlen(entry->path) + 1;
+    }
+    free(replaced);
+    for (int i = 0; i < archive_size; i++) {
+        if (archive[i].is_dir) continue;
+        memcpy(current, &archive[i].file_size, sizeof(long));
+        current += sizeof(long);
+        memcpy(current, &archive[i].file_mtime, sizeof(long));
+        current += sizeof(long);
+        memcpy(current, &archive[i].file_mtime_nsec, sizeof(long));
+        current += sizeof(long);
+        memcpy(current, &archive[i].file_inode, sizeof(long));
+        current += sizeof(long);
+        memcpy(current, &archive[i].file_hash, sizeof(uint64_t));
+        current += sizeof(uint64_t);
+        memcpy(current, archive[i].file_path, strlen(archive[i].file_path) + 1);
+        current += strlen(archive[i].file_path) + 1;
+    }
+    memcpy(current, &entry_count, sizeof(int));
+    current += sizeof(int);
+    memcpy(current, &index_size, sizeof(long));
+    current += sizeof(long);
+    memcpy(current, index_magic, sizeof(index_magic));
+    current += sizeof(index_magic);
+
+    FILE *f = fopen(file_name, "ab");
+    if (f == NULL) {
+        free(buffer);
+        return FILE_WRITE_ERROR;
+    }
+    long written = fwrite(buffer, sizeof(char), current - buffer, f);
+    fclose(f);
+    int res = (written == current - buffer) ? SUCCESS : FILE_WRITE_ERROR;
+    free(buffer);
+    return res;
+}
+
+// Kimasol size bajtot a bufferbol es atlep rajta; false-t ad vissza, ha a mezo tullogna a buffer vegen.
+static bool read_field(char **current, char *end, void *value, long size) {
+    if (end - *current < size) return false;
+    memcpy(value, *current, size);
+    *current += size;
+    return true;
+}
+
+// Atlep size bajton, ha az meg a bufferben van (negativ meret eseten false-t ad vissza).
+static bool skip_field(char **current, char *end, long size) {
+    if (size < 0 || end - *current < size) return false;
+    *current += size;
+    return true;
+}
+
+// Visszaadja a nullval lezart utvonalat es atlep rajta; NULL-t ad vissza, ha a lezaro nulla nincs a bufferben.
+static char* read_path(char **current, char *end) {
+    char *path_end = memchr(*current, '\0', end - *current);
+    if (path_end == NULL) return NULL;
+    char *path = *current;
+    *current = path_end + 1;
+    return path;
+}
+
+/*
+ * Beolvassa a tomoritett fajl vegen talalhato indexet, es utvonal szerinti keresotablat epit hozza.
+ * Ha a fajl vegen nincs index, FILE_MAGIC_ERROR-t ad vissza. Siker eseten 0-t ad vissza,
+ * az indexet a hivo a free_archive_index fuggvennyel szabaditja fel.
+ */
+int read_archive_index(char *file_name, Archive_index *index) {
+    *index = (Archive_index){0};
+    FILE *f = fopen(file_name, "rb");
+    if (f == NULL) return FILE_READ_ERROR;
+
+    int res = SUCCESS;
+    char *buffer = NULL;
+    while (true) {
+        long index_size = 0;
+        char trailer_magic[sizeof(index_magic)];
+        if (fseek(f, -(long)(sizeof(long) + sizeof(index_magic)), SEEK_END) != 0
+                || fread(&index_size, sizeof(long), 1, f) != 1
+                || fread(trailer_magic, sizeof(char), sizeof(index_magic), f) != sizeof(index_magic)
+                || memcmp(trailer_magic, index_magic, sizeof(index_magic)) != 0
+                || index_size < (long)sizeof(int)) {
+            res = FILE_MAGIC_ERROR;
+            break;
+        }
+        /* A zaro mezok utan a fajl vegen allunk, az index nem lehet hosszabb a megelozo tartalomnal. */
+        if (index_size > ftell(f) - (long)(sizeof(long) + sizeof(index_magic))) {
+            res = DECOMPRESSION_ERROR;
+            break;
+        }
+        if (fseek(f, -(long)(index_size + sizeof(long) + sizeof(index_magic)), SEEK_END) != 0) {
+            res = FILE_MAGIC_ERROR;
+            break;
+        }
+        buffer = malloc(index_size);
+        if (buffer == NULL) {
+            res = MALLOC_ERROR;
+            break;
+        }
+        if ((long)fread(buffer, sizeof(char), index_size, f) != index_size) {
+            res = FILE_READ_ERROR;
+            break;
+        }
+        memcpy(&index->entry_count, buffer + index_size - sizeof(int), sizeof(int));
+        /* Egy bejegyzes legalabb a rogzitett mezokbol es a lezaro nullabol all, ennel tobb nem ferhet az indexbe. */
+        long entry_min = 4 * sizeof(long) + sizeof(uint64_t) + 1;
+        if (index->entry_count < 0 || index->entry_count > (index_size - (long)sizeof(int)) / entry_min) {
+            res = DECOMPRESSION_ERROR;
+            break;
+        }
+        index->entries = calloc(index->entry_count + 1, sizeof(Index_entry));
+        index->slot_count = 16;
+        while (index->slot_count < 2 * index->entry_count) index->slot_count *= 2;
+        index->slots = calloc(index->slot_count, sizeof(int));
+        if (index->entries == NULL || index->slots == NULL) {
+            res = MALLOC_ERROR;
+            break;
+        }
+
+        char *current = buffer;
+        char *end = buffer + index_size - sizeof(int);
+        for (int i = 0; i < index->entry_count; i++) {
+            Index_entry *entry = &index->entries[i];
+            if (!read_field(&current, end, &entry->file_size, sizeof(long))
+                    || !read_field(&current, end, &entry->mtime, sizeof(long))
+                    || !read_field(&current, end, &entry->mtime_nsec, sizeof(long))
+                    || !read_field(&current, end, &entry->inode, sizeof(long))
+                    || !read_field(&current, end, &entry->hash, sizeof(uint64_t))
+                    || (entry->path = read_path(&current, end)) == NULL) {
+                res = DECOMPRESSION_ERROR;
+                break;
+            }
+
+            int slot = hash_data(entry->path, current - 1 - entry->path) & (index->slot_count - 1);
+            while (index->slots[slot] != 0) slot = (slot + 1) & (index->slot_count - 1);
+            index->slots[slot] = i + 1;
+        }
+        break;
+    }
+    fclose(f);
+
+    if (res != SUCCESS) {
+        free(buffer);
+        free(index->entries);
+        free(index->slots);
+        *index = (Archive_index){0};
+    } else {
+        index->paths = buffer;
+    }
+    return res;
+}
+
+// Utvonal szerint megkeresi a bejegyzest az indexben, NULL-t ad vissza, ha nincs ilyen.
+Index_entry* find_index_entry(Archive_index *index, const char *path) {
+    if (index->slot_count == 0) return NULL;
+    int slot = hash_data(path, strlen(path)) & (index->slot_count - 1);
+    while (index->slots[slot] != 0) {
+        Index_entry *entry = &index->entries[index->slots[slot] - 1];
+        if (strcmp(entry->path, path) == 0) return entry;
+        slot = (slot + 1) & (index->slot_count - 1);
+    }
+    return NULL;
+}
+
+void free_archive_index(Archive_index *index) {
+    free(index->entries);
+    free(index->paths);
+    free(index->slots);
+    *index = (Archive_index){0};
+}
+
+/*
+ * Megkeresi az archivumban a tartalmilag azonos fajlokat a beolvasaskor szamolt hash alapjan.
+ * Az ismetlodo fajlok tartalmat felszabaditja, es a duplicate_of mezoben az elso elofordulasra hivatkozik,
+ * igy az azonos tartalom csak egyszer kerul kodolasra es tarolasra.
+ * Siker eseten a megtalalt ismetlodesek szamat, hiba eseten negativ kodot ad vissza.
+ */
+int deduplicate_archive(Directory_item *archive, int archive_size) {
+    int table_size = 16;
+    while (table_size < 2 * archive_size) table_size *= 2;
+    /* Nyilt cimzesu hash tabla, az elso elofordulasok indexeit tarolja (0 = ures hely). */
+    int *table = calloc(table_size, sizeof(int));
+    if (table == NULL) return MALLOC_ERROR;
+
+    int duplicates = 0;
+    for (int i = 0; i < archive_size; i++) {
+        Directory_item *item = &archive[i];
+        if (item->is_dir || item->file_size == 0 || item->in_base) continue;
+        int slot = item->file_hash & (table_size - 1);
+        while (table[slot] != 0) {
+            Directory_item *first = &archive[table[slot]];
+            if (first->file_hash == item->file_hash && first->file_size == item->file_size
+                    && memcmp(first->file_data, item->file_data, item->file_size) == 0) {
+                item->duplicate_of = table[slot];
+                break;
+            }
+            slot = (slot + 1) & (table_size - 1);
+        }
+        if (item->duplicate_of != 0) {
+            free(item->file_data);
+            item->file_data = NULL;
+            duplicates++;
+        } else {
+            table[slot] = i;
+        }
+    }
+    free(table);
+    return duplicates;
+}
+
+/*
+ * Szerializalja az archivalt mappat szeletekre bontva. A bejegyzesek fejleceit (tipus, jogosultsag
+ * vagy meret, utvonal) a headers bufferbe irja, a fajltartalmakat pedig masolas nelkul, az archivumra
+ * mutato szeletkent adja at. Siker eseten a szerializalt adat teljes hosszat adja vissza, hiba eseten negativ kodot.
+ */
+long serialize_archive_segments(Directory_item *archive, int archive_size, char **headers, Data_segment **segments, int *segment_count) {
     if (archive_size == 0) return EMPTY_DIRECTORY;
-    int data_size = sizeof(int);
+    long header_size = sizeof(int);
+    long data_size = 0;
+    long max_segments = 2 * archive_size + 1;
     for (int i = 0; i < archive_size; i++) {
-        data_size += sizeof(bool);
+        header_size += sizeof(bool);
         if (archive[i].is_dir) {
-            data_size += sizeof(int);
-            data_size += strlen(archive[i].dir_path) + 1;
+            header_size += sizeof(int);
+            header_size += strlen(archive[i].dir_path) + 1;
         }
         else {
-            data_size += sizeof(long);
-            data_size += strlen(archive[i].file_path) + 1;
-            data_size += archive[i].file_size;
+            header_size += sizeof(long) + sizeof(uint64_t) + 2 * sizeof(int) + sizeof(bool);
+            header_size += strlen(archive[i].file_path) + 1;
+            if (archive[i].in_base) continue;
+            if (archive[i].chunk_count > 0) {
+                header_size += archive[i].chunk_count * (sizeof(long) + sizeof(int));
+                for (int c = 0; c < archive[i].chunk_count; c++) {
+                    if (archive[i].chunks[c].ref == -1) data_size += archive[i].chunks[c].size;
+                }
+                max_segments += 2 * archive[i].chunk_count;
+            }
+            else if (archive[i].duplicate_of == 0) data_size += archive[i].file_size;
         }
     }
-    *buffer = malloc(data_size);
-    if (*buffer == NULL) return MALLOC_ERROR;
-    char *current = *buffer;
+    *headers = malloc(header_size);
+    if (*headers == NULL) return MALLOC_ERROR;
+    /* Legrosszabb esetben minden fajlhoz (es darabhoz) egy fejlec- es egy adatszelet tartozik. */
+    *segments = malloc(max_segments * sizeof(Data_segment));
+    if (*segments == NULL) {
+        free(*headers);
+        *headers = NULL;
+        return MALLOC_ERROR;
+    }
+    *segment_count = 0;
+
+    char *current = *headers;
+    char *run_start = *headers;
     memcpy(current, &archive_size, sizeof(int));
     current += sizeof(int);
     for (int i = 0; i < archive_size; i++) {
@@ -199,21 +508,91 @@ long serialize_archive(Directory_item *archive, int archive_size, char **buffer)
         else {
             memcpy(current, &archive[i].file_size, sizeof(long));
             current += sizeof(long);
+            memcpy(current, &archive[i].file_hash, sizeof(uint64_t));
+            current += sizeof(uint64_t);
+            memcpy(current, &archive[i].duplicate_of, sizeof(int));
+            current += sizeof(int);
+            memcpy(current, &archive[i].chunk_count, sizeof(int));
+            current += sizeof(int);
+            memcpy(current, &archive[i].in_base, sizeof(bool));
+            current += sizeof(bool);
             memcpy(current, archive[i].file_path, strlen(archive[i].file_path) + 1);
             current += strlen(archive[i].file_path) + 1;
-            memcpy(current, archive[i].file_data, archive[i].file_size);
-            current += archive[i].file_size;
+            /* Darabolt fajlnal minden darab hossza es hivatkozasa kerul a fejlecbe, tartalom csak az uj darabokhoz. */
+            for (int c = 0; c < archive[i].chunk_count; c++) {
+                File_chunk *chunk = &archive[i].chunks[c];
+                memcpy(current, &chunk->size, sizeof(long));
+                current += sizeof(long);
+                memcpy(current, &chunk->ref, sizeof(int));
+                current += sizeof(int);
+                if (chunk->ref == -1) {
+                    (*segments)[(*segment_count)++] = (Data_segment){run_start, current - run_start};
+                    (*segments)[(*segment_count)++] = (Data_segment){chunk->data, chunk->size};
+                    run_start = current;
+                }
+            }
+            /* Az ismetlodo fajlok tartalma nem kerul a folyamba, csak a hivatkozas. */
+            if (archive[i].file_size > 0 && archive[i].duplicate_of == 0 && archive[i].chunk_count == 0 && !archive[i].in_base) {
+                (*segments)[(*segment_count)++] = (Data_segment){run_start, current - run_start};
+                (*segments)[(*segment_count)++] = (Data_segment){archive[i].file_data, archive[i].file_size};
+                run_start = current;
+            }
         }
     }
+    if (current > run_start) {
+        (*segments)[(*segment_count)++] = (Data_segment){run_start, current - run_start};
+    }
+    return header_size + data_size;
+}
+
+/*
+ * Szerializalja az archivalt mappat egy osszefuggo bufferbe.
+ * Siker eseten a buffer meretet adja vissza, hiba eseten negativ kodot.
+ */
+long serialize_archive(Directory_item *archive, int archive_size, char **buffer) {
+    char *headers = NULL;
+    Data_segment *segments = NULL;
+    int segment_count = 0;
+    long data_size = serialize_archive_segments(archive, archive_size, &headers, &segments, &segment_count);
+    if (data_size < 0) return data_size;
+    *buffer = malloc(data_size);
+    if (*buffer == NULL) {
+        free(headers);
+        free(segments);
+        return MALLOC_ERROR;
+    }
+    char *current = *buffer;
+    for (int i = 0; i < segment_count; i++) {
+        memcpy(current, segments[i].data, segments[i].size);
+        current += segments[i].size;
+    }
+    free(headers);
+    free(segments);
     return data_size;
 }
 
 
+/*
+ * Megallapitja, hogy a celhelyen levo fajl megegyezik-e a bejegyzessel: eloszor a meretet,
+ * egyezes eseten a tarolt tartalom hash-et hasonlitja ossze a lemezen levo fajleval.
+ */
+static bool file_up_to_date(char *full_path, Directory_item *item) {
+    struct stat st;
+    if (stat(full_path, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size != item->file_size) return false;
+    if (item->file_size == 0) return true;
+    /* A fajlt darabonkent olvasva hash-eljuk, igy a memoriaba nem fero fajlok is ellenorizhetok. */
+    uint64_t existing_hash = 0;
+    if (hash_file(full_path, &existing_hash) != 0) return false;
+    return existing_hash == item->file_hash;
+}
+
 /*
  * Kicsomagolja az archivalt mappat a megadott utvonalra, letrehozza a mappakat es fajlokat.
+ * Sync modban csak azokat a fajlokat irja ujra, amelyek merete vagy hash-e elter a celhelyen levotol,
+ * ilyenkor a kulonbozo fajlokat kerdes nelkul felulirja.
  * Siker eseten 0-t ad vissza, hiba eseten negativ kodot.
  */
-int extract_directory(char *path, Directory_item *archive, int archive_size, bool force, bool no_preserve_perms) {
+int extract_directory(char *path, Directory_item *archive, int archive_size, bool force, bool no_preserve_perms, bool sync) {
     if (path == NULL) path = ".";
     for (int current_index = 0; current_index < archive_size; current_index++) {
         Directory_item *current = &archive[current_index];
@@ -238,7 +617,21 @@ int extract_directory(char *path, Directory_item *archive, int archive_size, boo
                }
            }
         }
+        else if (current->in_base) {
+            /* Inkrementalis bejegyzes: a fajlnak az alap archivum kibontasabol mar a helyen kell lennie. */
+            struct stat st;
+            if (stat(full_path, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size != current->file_size) {
+                printf("A valtozatlan fajl (%s) hianyzik, elobb az alap archivumot kell kibontani.\n", full_path);
+                free(full_path);
+                return INCREMENTAL_BASE_ERROR;
+            }
+        }
+        else if (sync && file_up_to_date(full_path, current)) {
+            /* A fajl mar naprakesz, nem irjuk ujra. */
+        }
         else {
+            /* Sync modban az elterest mutato fajlokat kerdes nelkul irjuk felul. */
+            bool overwrite = force || sync;
             if (current->file_size == 0) {
                 /* Create an empty file */
                 FILE *f = fopen(full_path, "wb");
@@ -247,8 +640,24 @@ int extract_directory(char *path, Directory_item *archive, int archive_size, boo
                     return FILE_WRITE_ERROR;
                 }
                 fclose(f);
+            } else if (current->chunk_count > 0) {
+                /* Darabolt fajl: a darabokat sorban, kozvetlenul a kitomoritett bufferbol irjuk ki. */
+                Data_segment *pieces = malloc(current->chunk_count * sizeof(Data_segment));
+                if (pieces == NULL) {
+                    free(full_path);
+                    return MALLOC_ERROR;
+                }
+                for (int c = 0; c < current->chunk_count; c++) {
+                    pieces[c] = (Data_segment){current->chunks[c].data, current->chunks[c].size};
+                }
+                long ret = write_segments(full_path, pieces, current->chunk_count, overwrite);
+                free(pieces);
+                if (ret < 0) {
+                    free(full_path);
+                    return FILE_WRITE_ERROR;
+                }
             } else {
-                int ret = write_raw(full_path, current->file_data, current->file_size, force);
+                long ret = write_raw(full_path, current->file_data, current->file_size, overwrite);
                 if (ret < 0) {
                     free(full_path);
                     return FILE_WRITE_ERROR;
@@ -261,69 +670,467 @@ int extract_directory(char *path, Directory_item *archive, int archive_size, boo
 }
 
 /*
- * Visszaalakitja a szerializalt bufferbol az archivum tombot.
+ * Visszaalakitja a szerializalt bufferbol az archivum tombot masolas nelkul.
+ * Az elemek utvonalai es fajltartalmai a bufferbe mutatnak, ezert a buffernek az archivum
+ * hasznalata vegeig elnek kell maradnia. A darabolt fajlok darablistai az elemekkel egy
+ * foglalasban vannak, igy a hivo csak magat a tombot szabaditja fel.
  * Siker eseten az archivum meretet adja vissza, hiba eseten negativ kodot.
  */
-int deserialize_archive(Directory_item **archive, char *buffer) {
+int deserialize_archive_view(Directory_item **archive, char *buffer, long buffer_size) {
+    long consumed = 0;
+    return parse_archive_view(archive, buffer, buffer_size, &consumed);
+}
+
+/*
+ * A deserialize_archive_view megvalositasa: a consumed parameterben visszaadja a feldolgozott bajtok szamat,
+ * hogy a hozzafuzott archivumok egymas utan kovetkezo szerializalt reszei sorban beolvashatok legyenek.
+ * A buffer_size bajton tulnyulo (csonka vagy serult) adat eseten DECOMPRESSION_ERROR-t ad vissza.
+ */
+static int parse_archive_view(Directory_item **archive, char *buffer, long buffer_size, long *consumed) {
     int archive_size;
     char *current = buffer;
-    memcpy(&archive_size, current, sizeof(int));
-    current += sizeof(int);
-    *archive = calloc(archive_size, sizeof(Directory_item));
+    char *end = buffer + buffer_size;
+    if (!read_field(&current, end, &archive_size, sizeof(int))) return DECOMPRESSION_ERROR;
+    if (archive_size < 0) return DIRECTORY_ERROR;
+
+    /*
+     * Elso menet: megszamoljuk a darabokat, hogy egyetlen foglalasba ferjenek az elemekkel.
+     * Kozben minden mezot a buffer vegehez merunk, igy a masodik menet mar csak ervenyes adatot olvas.
+     */
+    long total_chunks = 0;
+    int unique_chunks = 0;
+    char *scan = current;
+    for (int i = 0; i < archive_size; i++) {
+        bool is_dir;
+        if (!read_field(&scan, end, &is_dir, sizeof(bool))) return DECOMPRESSION_ERROR;
+        if (is_dir) {
+            if (!skip_field(&scan, end, sizeof(int)) || read_path(&scan, end) == NULL) return DECOMPRESSION_ERROR;
+            continue;
+        }
+        long file_size;
+        int duplicate_of, chunk_count;
+        bool in_base;
+        if (!read_field(&scan, end, &file_size, sizeof(long))
+                || !skip_field(&scan, end, sizeof(uint64_t))
+                || !read_field(&scan, end, &duplicate_of, sizeof(int))
+                || !read_field(&scan, end, &chunk_count, sizeof(int))
+                || !read_field(&scan, end, &in_base, sizeof(bool))
+                || read_path(&scan, end) == NULL) {
+            return DECOMPRESSION_ERROR;
+        }
+        if (in_base) continue;
+        if (chunk_count < 0 || file_size < 0) return DIRECTORY_ERROR;
+        total_chunks += chunk_count;
+        for (int c = 0; c < chunk_count; c++) {
+            long size;
+            int ref;
+            if (!read_field(&scan, end, &size, sizeof(long)) || !read_field(&scan, end, &ref, sizeof(int))) return DECOMPRESSION_ERROR;
+            if (ref == -1) {
+                if (!skip_field(&scan, end, size)) return DECOMPRESSION_ERROR;
+                unique_chunks++;
+            }
+        }
+        if (chunk_count == 0 && duplicate_of == 0 && !skip_field(&scan, end, file_size)) return DECOMPRESSION_ERROR;
+    }
+
+    *archive = calloc(1, archive_size * sizeof(Directory_item) + total_chunks * sizeof(File_chunk));
     if (*archive == NULL) return MALLOC_ERROR;
-    int i = 0;
-    while (i < archive_size) {
-        memcpy(&(*archive)[i].is_dir, current, sizeof(bool));
+    File_chunk *next_chunk = (File_chunk*)(*archive + archive_size);
+    /* Az egyedi darabok sorszam szerinti cimei, a hivatkozasok feloldasahoz. */
+    char **unique = NULL;
+    if (unique_chunks > 0) {
+        unique = malloc(unique_chunks * sizeof(char*));
+        if (unique == NULL) {
+            free(*archive);
+            *archive = NULL;
+            return MALLOC_ERROR;
+        }
+    }
+    int unique_seen = 0;
+
+    int res = archive_size;
+    for (int i = 0; i < archive_size && res >= 0; i++) {
+        Directory_item *item = &(*archive)[i];
+        memcpy(&item->is_dir, current, sizeof(bool));
         current += sizeof(bool);
-        if ((*archive)[i].is_dir) {
-            memcpy(&(*archive)[i].perms, current, sizeof(int));
+        if (item->is_dir) {
+            memcpy(&item->perms, current, sizeof(int));
             current += sizeof(int);
-            char *end = strchr(current, '\0');
-            int n = end - current + 1;
-            (*archive)[i].dir_path = malloc(n);
-            if ((*archive)[i].dir_path == NULL) return MALLOC_ERROR;
-            memcpy((*archive)[i].dir_path, current, n);
-            current += n;
+            item->dir_path = current;
+            current += strlen(current) + 1;
         }
         else {
-            memcpy(&(*archive)[i].file_size, current, sizeof(long));
+            memcpy(&item->file_size, current, sizeof(long));
             current += sizeof(long);
-            char *end = strchr(current, '\0');
-            int n = end - current + 1;
-            (*archive)[i].file_path = malloc(n);
-            if ((*archive)[i].file_path == NULL) return MALLOC_ERROR;
-            memcpy((*archive)[i].file_path, current, n);
-            current += n;
-            if ((*archive)[i].file_size > 0) {
-                (*archive)[i].file_data = malloc((*archive)[i].file_size);
-                if ((*archive)[i].file_data == NULL) return MALLOC_ERROR;
-                memcpy((*archive)[i].file_data, current, (*archive)[i].file_size);
-                current += (*archive)[i].file_size;
+            memcpy(&item->file_hash, current, sizeof(uint64_t));
+            current += sizeof(uint64_t);
+            memcpy(&item->duplicate_of, current, sizeof(int));
+            current += sizeof(int);
+            memcpy(&item->chunk_count, current, sizeof(int));
+            current += sizeof(int);
+            memcpy(&item->in_base, current, sizeof(bool));
+            current += sizeof(bool);
+            item->file_path = current;
+            current += strlen(current) + 1;
+            if (item->in_base) {
+                /* A tartalom az alap archivumban van, ebben a folyamban nincs adat. */
+                item->chunk_count = 0;
+                item->file_data = NULL;
+            }
+            else if (item->chunk_count > 0) {
+                item->chunks = next_chunk;
+                next_chunk += item->chunk_count;
+                for (int c = 0; c < item->chunk_count; c++) {
+                    File_chunk *chunk = &item->chunks[c];
+                    memcpy(&chunk->size, current, sizeof(long));
+                    current += sizeof(long);
+                    memcpy(&chunk->ref, current, sizeof(int));
+                    current += sizeof(int);
+                    if (chunk->ref == -1) {
+                        chunk->data = current;
+                        unique[unique_seen++] = current;
+                        current += chunk->size;
+                    } else if (chunk->ref >= 0 && chunk->ref < unique_seen) {
+                        chunk->data = unique[chunk->ref];
+                    } else {
+                        res = DIRECTORY_ERROR;
+                        break;
+                    }
+                }
+            }
+            else if (item->duplicate_of != 0) {
+                /* Az ismetlodes a mar beolvasott elso elofordulas tartalmara mutat. */
+                Directory_item *first = &(*archive)[item->duplicate_of];
+                if (item->duplicate_of < 0 || item->duplicate_of >= i || first->is_dir || first->file_size != item->file_size || first->in_base) {
+                    res = DIRECTORY_ERROR;
+                    break;
+                }
+                item->file_data = first->file_data;
+                item->chunks = first->chunks;
+                item->chunk_count = first->chunk_count;
             } else {
-                (*archive)[i].file_data = NULL;
+                item->file_data = item->file_size > 0 ? current : NULL;
+                current += item->file_size;
             }
         }
-        i++;
     }
-    return archive_size;
+    free(unique);
+    if (res < 0) {
+        free(*archive);
+        *archive = NULL;
+    }
+    *consumed = current - buffer;
+    return res;
+}
+
+/*
+ * Visszaalakitja a szerializalt bufferbol az archivum tombot, az elemek sajat masolatot kapnak.
+ * Siker eseten az archivum meretet adja vissza, hiba eseten negativ kodot.
+ */
+int deserialize_archive(Directory_item **archive, char *buffer, long buffer_size) {
+    int archive_size = deserialize_archive_view(archive, buffer, buffer_size);
+    if (archive_size < 0) return archive_size;
+    int i = 0;
+    for (; i < archive_size; i++) {
+        Directory_item *item = &(*archive)[i];
+        if (item->is_dir) {
+            item->dir_path = strdup(item->dir_path);
+            if (item->dir_path == NULL) break;
+        }
+        else {
+            char *data = NULL;
+            if (item->file_size > 0 && !item->in_base) {
+                data = malloc(item->file_size);
+                if (data == NULL) break;
+                if (item->chunk_count > 0) {
+                    long offset = 0;
+                    for (int c = 0; c < item->chunk_count; c++) {
+                        memcpy(data + offset, item->chunks[c].data, item->chunks[c].size);
+                        offset += item->chunks[c].size;
+                    }
+                } else {
+                    memcpy(data, item->file_data, item->file_size);
+                }
+            }
+            item->file_path = strdup(item->file_path);
+            if (item->file_path == NULL) {
+                free(data);
+                break;
+            }
+            /* A masolat mar osszefuggo, a darablistara nincs tobbe szukseg. */
+            item->file_data = data;
+            item->chunks = NULL;
+            item->chunk_count = 0;
+        }
+    }
+    if (i == archive_size) return archive_size;
+
+    /* Hiba eseten csak a mar lemasolt elemeket szabaditjuk fel, a tobbi meg a bufferbe mutat. */
+    for (int j = 0; j < i; j++) {
+        if ((*archive)[j].is_dir) {
+            free((*archive)[j].dir_path);
+        } else {
+            free((*archive)[j].file_path);
+            free((*archive)[j].file_data);
+        }
+    }
+    free(*archive);
+    *archive = NULL;
+    return MALLOC_ERROR;
+}
+
+/*
+ * Hozzaad egy bejegyzest az archivum tombhoz. Siker eseten 0-t, hiba eseten MALLOC_ERROR-t ad vissza,
+ * ilyenkor a bejegyzes tulajdonjoga a hivonal marad.
+ */
+static int push_item(Directory_item **archive, int *archive_size, Directory_item item) {
+    Directory_item *temp = realloc(*archive, (*archive_size + 1) * sizeof(Directory_item));
+    if (temp == NULL) return MALLOC_ERROR;
+    *archive = temp;
+    (*archive)[(*archive_size)++] = item;
+    return SUCCESS;
+}
+
+/*
+ * Egy hozzafuzendo utvonalat az archivum belso alakjara hoz: elhagyja az ures es "." tagokat, es ha az utvonal
+ * nem az archivum gyoker mappajaval kezdodik, a gyoker ala helyezi. Abszolut utvonalnal, ".." tagnal vagy ures
+ * utvonalnal NULL-t ad vissza es *error-ba PATH_ERROR kerul, memoria hiba eseten MALLOC_ERROR.
+ */
+static char* normalize_append_path(const char *input, const char *root, int root_len, int *error) {
+    *error = PATH_ERROR;
+    if (input[0] == '/') return NULL;
+    char *path = malloc(root_len + strlen(input) + 2);
+    if (path == NULL) {
+        *error = MALLOC_ERROR;
+        return NULL;
+    }
+    long len = 0;
+    const char *current = input;
+    while (*current != '\0') {
+        long part_len = strcspn(current, "/");
+        if (part_len == 2 && strncmp(current, "..", 2) == 0) {
+            free(path);
+            return NULL;
+        }
+        if (part_len > 0 && !(part_len == 1 && current[0] == '.')) {
+            if (len > 0) path[len++] = '/';
+            memcpy(path + len, current, part_len);
+            len += part_len;
+        }
+        current += part_len;
+        if (*current == '/') current++;
+    }
+    path[len] = '\0';
+    if (len == 0) {
+        free(path);
+        return NULL;
+    }
+    bool in_root = strncmp(path, root, root_len) == 0 && (path[root_len] == '/' || path[root_len] == '\0');
+    if (root_len > 0 && !in_root) {
+        memmove(path + root_len + 1, path, len + 1);
+        memcpy(path, root, root_len);
+        path[root_len] = '/';
+    }
+    return path;
+}
+
+/*
+ * Hozzafuzeshez szukseges feldolgozas: a megadott fajlokat es mappakat a korabbi index gyoker mappaja ala
+ * normalizalt utvonalon archivalja, a tartalmukat viszont a megadott utvonalrol olvassa. Abszolut utvonalat
+ * es ".." tagot nem fogad el. A szulo mappak is bejegyzest kapnak, hogy kibontaskor letrejojjenek. A tobbi lepes
+ * (deduplikacio, darabolas, szerializacio) megegyezik a prepare_directory_stream lepeseivel.
+ * Siker eseten a szerializalt adat hosszat, hiba eseten negativ erteket ad vissza.
+ */
+long prepare_append_stream(Arguments args, Archive_index *previous, Directory_stream *stream, long *directory_size) {
+    long data_len = 0;
+    *directory_size = 0;
+    *stream = (Directory_stream){0};
+
+    /* Az archivum gyokere az indexbeli utvonalak elso tagja (pl. "project/a.txt" -> "project"). */
+    const char *root = previous != NULL && previous->entry_count > 0 ? previous->entries[0].path : "";
+    int root_len = strcspn(root, "/");
+
+    for (int n = 0; n < args.input_count && data_len >= 0; n++) {
+        char *input = args.input_files[n];
+        int path_error = SUCCESS;
+        char *path = normalize_append_path(input, root, root_len, &path_error);
+        if (path == NULL) {
+            if (path_error == PATH_ERROR) {
+                printf("Csak az archivumon beluli relativ utvonal fuzheto hozza (%s).\n", input);
+            }
+            data_len = path_error;
+            break;
+        }
+        struct stat st;
+        if (stat(input, &st) != 0) {
+            printf("A (%s) fajl nem talalhato.\n", input);
+            free(path);
+            data_len = FILE_READ_ERROR;
+            break;
+        }
+
+        /* A szulo mappakat elobb vesszuk fel, igy kibontaskor mar leteznek. */
+        for (char *sep = strchr(path, '/'); sep != NULL && data_len >= 0; sep = strchr(sep + 1, '/')) {
+            Directory_item parent = {0};
+            parent.is_dir = true;
+            parent.dir_path = malloc(sep - path + 1);
+            if (parent.dir_path == NULL) {
+                data_len = MALLOC_ERROR;
+                break;
+            }
+            memcpy(parent.dir_path, path, sep - path);
+            parent.dir_path[sep - path] = '\0';
+            struct stat parent_st;
+            parent.perms = stat(parent.dir_path, &parent_st) == 0 ? (parent_st.st_mode & 0777) : 0755;
+            if (push_item(&stream->archive, &stream->archive_size, parent) != SUCCESS) {
+                free(parent.dir_path);
+                data_len = MALLOC_ERROR;
+            }
+        }
+        if (data_len < 0) {
+            free(path);
+            break;
+        }
+
+        if (S_ISDIR(st.st_mode)) {
+            Directory_item *sub = NULL;
+            int sub_size = 0;
+            int sub_index = 0;
+            long sub_bytes = archive_directory(input, &sub, &sub_index, &sub_size);
+            if (sub_bytes < 0) {
+                printf("Nem sikerult a mappa (%s) archivallasa.\n", input);
+                data_len = sub_bytes;
+            }
+            /* A bejart utvonalak a megadott utvonallal kezdodnek, ezt csereljuk a normalizaltra. */
+            long input_len = strlen(input);
+            for (int i = 0; i < sub_size && data_len >= 0; i++) {
+                char **item_path = sub[i].is_dir ? &sub[i].dir_path : &sub[i].file_path;
+                char *renamed = malloc(strlen(path) + strlen(*item_path + input_len) + 1);
+                if (renamed == NULL) {
+                    data_len = MALLOC_ERROR;
+                    break;
+                }
+                strcpy(renamed, path);
+                strcat(renamed, *item_path + input_len);
+                free(*item_path);
+                *item_path = renamed;
+            }
+            for (int i = 0; i < sub_size; i++) {
+                if (data_len >= 0 && push_item(&stream->archive, &stream->archive_size, sub[i]) == SUCCESS) continue;
+                if (data_len >= 0) data_len = MALLOC_ERROR;
+                if (sub[i].is_dir) {
+                    free(sub[i].dir_path);
+                } else {
+                    free(sub[i].file_path);
+                    free(sub[i].file_data);
+                }
+            }
+            free(sub);
+            free(path);
+            *directory_size += sub_bytes;
+            continue;
+        }
+
+        Directory_item file = {0};
+        file.file_path = path;
+        file.file_mtime = st.st_mtim.tv_sec;
+        file.file_mtime_nsec = st.st_mtim.tv_nsec;
+        file.file_inode = st.st_ino;
+        file.file_size = read_raw(input, &file.file_data);
+        if (file.file_size == EMPTY_FILE) {
+            file.file_size = 0;
+            file.file_data = NULL;
+        } else if (file.file_size < 0) {
+            printf("Nem sikerult megnyitni a fajlt (%s).\n", input);
+            free(file.file_path);
+            data_len = FILE_READ_ERROR;
+            break;
+        }
+        file.file_hash = hash_data(file.file_data, file.file_size);
+        *directory_size += file.file_size;
+        if (push_item(&stream->archive, &stream->archive_size, file) != SUCCESS) {
+            free(file.file_path);
+            free(file.file_data);
+            data_len = MALLOC_ERROR;
+        }
+    }
+
+    if (data_len >= 0 && deduplicate_archive(stream->archive, stream->archive_size) < 0) {
+        data_len = MALLOC_ERROR;
+    }
+    if (data_len >= 0 && args.chunk_dedup && chunk_archive(stream->archive, stream->archive_size) < 0) {
+        data_len = MALLOC_ERROR;
+    }
+    if (data_len >= 0) {
+        data_len = serialize_archive_segments(stream->archive, stream->archive_size, &stream->headers, &stream->segments, &stream->segment_count);
+    }
+    if (data_len == MALLOC_ERROR) {
+        printf("Nem sikerult lefoglalni a memoriat a hozzafuzeskor.\n");
+    }
+
+    if (data_len < 0) {
+        free_directory_stream(stream);
+    } else {
+        stream->data_len = data_len;
+    }
+    return data_len;
+}
+
+/*
+ * Felszabaditja a prepare_directory_stream altal lefoglalt archivumot, fejleceket es szeleteket.
+ */
+void free_directory_stream(Directory_stream *stream) {
+    for (int i = 0; i < stream->archive_size; ++i) {
+        if (stream->archive[i].is_dir) {
+            free(stream->archive[i].dir_path);
+        } else {
+            free(stream->archive[i].file_path);
+            free(stream->archive[i].file_data);
+            free(stream->archive[i].chunks);
+        }
+    }
+    free(stream->archive);
+    free(stream->headers);
+    free(stream->segments);
+    stream->archive = NULL;
+    stream->archive_size = 0;
+    stream->headers = NULL;
+    stream->segments = NULL;
+    stream->segment_count = 0;
+    stream->data_len = 0;
 }
 
 /*
  * Tomoriteshez szukseges mappa feldolgozas.
- * Bejarja a mappat, archivalja es szerializalja az adatokat.
+ * Bejarja a mappat, archivalja es szeletekre bontva szerializalja az adatokat, a fajltartalmakat nem masolja.
  * Sikeres muveletek eseten a szerializalt adat hosszat adja vissza, hiba eseten negativ erteket.
+ * A stream tartalmat a hivo a free_directory_stream fuggvennyel szabaditja fel.
  */
-int prepare_directory(char *input_file, char **data, int *directory_size) {
+long prepare_directory_stream(Arguments args, Directory_stream *stream, long *directory_size) {
+    char *input_file = args.input_file;
     char current_path[PATH_MAX];
     char *sep = strrchr(input_file, '/');
     char *parent_dir = NULL;
     char *file_name = NULL;
-    Directory_item *archive = NULL;
-    int archive_size = 0;
     int current_index = 0;
-    int data_len = 0;  
+    long data_len = 0;
+    Archive_index base = {0};
+    *stream = (Directory_stream){0};
     
     while (true) {
+        /* Az alap archivum indexet meg a mappavaltas elott olvassuk be, mert az utvonala a hivohoz relativ. */
+        if (args.incremental_from != NULL) {
+            int index_res = read_archive_index(args.incremental_from, &base);
+            if (index_res != SUCCESS) {
+                if (index_res == FILE_MAGIC_ERROR) {
+                    printf("Az alap archivum (%s) nem tartalmaz indexet.\n", args.incremental_from);
+                } else {
+                    printf("Nem sikerult beolvasni az alap archivumot (%s).\n", args.incremental_from);
+                }
+                data_len = INCREMENTAL_BASE_ERROR;
+                break;
+            }
+        }
         if (getcwd(current_path, sizeof(current_path)) == NULL) {
             printf("Nem sikerult elmenteni az utat.\n");
             data_len = DIRECTORY_ERROR;
@@ -360,7 +1167,8 @@ int prepare_directory(char *input_file, char **data, int *directory_size) {
             }
         }
         
-        *directory_size = archive_directory((file_name != NULL) ? file_name : input_file, &archive, &current_index, &archive_size);
+        *directory_size = archive_directory_incremental((file_name != NULL) ? file_name : input_file, &stream->archive, &current_index, &stream->archive_size,
+                                                        args.incremental_from != NULL ? &base : NULL);
         if (*directory_size < 0) {
             if (*directory_size == MALLOC_ERROR) {
                 printf("Nem sikerult lefoglalni a memoriat a mappa archivallasakor.\n");
@@ -372,82 +1180,103 @@ int prepare_directory(char *input_file, char **data, int *directory_size) {
                 printf("Nem sikerult a mappa archivallasa.\n");
             }
             data_len = *directory_size;
-            /* Visszalepunk az eredeti mappaba hibaeseten is. */
-            if (sep != NULL) {
-                if (chdir(current_path) != 0) {
-                    printf("Nem sikerult kilepni a mappabol.\n");
-                    data_len = DIRECTORY_ERROR;
-                }
-            }
-            break;
         }
-        
-        data_len = serialize_archive(archive, archive_size, data);
-        if (data_len < 0) {
-            if (data_len == MALLOC_ERROR) {
-                printf("Nem sikerult lefoglalni a memoriat a szerializalaskor.\n");
-            } else if (data_len == EMPTY_DIRECTORY) {
-                printf("A mappa ures.\n");
-            } else {
-                printf("Nem sikerult a mappa szerializalasa.\n");
-            }
-            if (sep != NULL) {
-                if (chdir(current_path) != 0) {
-                    printf("Nem sikerult kilepni a mappabol.\n");
-                    data_len = DIRECTORY_ERROR;
-                    if (*data != NULL) {
-                        free(*data);
-                        *data = NULL;
-                    }
+        /* Az azonos tartalmu fajlokat csak egyszer taroljuk. */
+        else if (deduplicate_archive(stream->archive, stream->archive_size) < 0) {
+            printf("Nem sikerult lefoglalni a memoriat a mappa archivallasakor.\n");
+            data_len = MALLOC_ERROR;
+        }
+        /* Opcionalisan a fajlokon beluli ismetlodo darabokat is csak egyszer taroljuk. */
+        else if (args.chunk_dedup && chunk_archive(stream->archive, stream->archive_size) < 0) {
+            printf("Nem sikerult lefoglalni a memoriat a mappa darabolasakor.\n");
+            data_len = MALLOC_ERROR;
+        }
+        else {
+            data_len = serialize_archive_segments(stream->archive, stream->archive_size, &stream->headers, &stream->segments, &stream->segment_count);
+            if (data_len < 0) {
+                if (data_len == MALLOC_ERROR) {
+                    printf("Nem sikerult lefoglalni a memoriat a szerializalaskor.\n");
+                } else if (data_len == EMPTY_DIRECTORY) {
+                    printf("A mappa ures.\n");
+                } else {
+                    printf("Nem sikerult a mappa szerializalasa.\n");
                 }
             }
-            break;
         }
         
-        /* Visszalepunk az eredeti mappaba. */
+        /* Visszalepunk az eredeti mappaba, hibaeseten is. */
         if (sep != NULL) {
             if (chdir(current_path) != 0) {
                 printf("Nem sikerult kilepni a mappabol.\n");
                 data_len = DIRECTORY_ERROR;
-                if (*data != NULL) {
-                    free(*data);
-                    *data = NULL;
-                }
-                break;
             }
         }
         break;
     }
     
-    if (archive_size > 0) {
-        for (int i = 0; i < archive_size; ++i) {
-            if (archive[i].is_dir) {
-                free(archive[i].dir_path);
-            } else {
-                free(archive[i].file_path);
-                free(archive[i].file_data);
-            }
-        }
+    if (data_len < 0) {
+        free_directory_stream(stream);
+    } else {
+        stream->data_len = data_len;
     }
-    free(archive);
+    free_archive_index(&base);
     free(parent_dir);
     free(file_name);
     
     return data_len;
 }
 
+/*
+ * Tomoriteshez szukseges mappa feldolgozas, a szerializalt adatot egy osszefuggo bufferbe gyujti.
+ * Sikeres muveletek eseten a szerializalt adat hosszat adja vissza, hiba eseten negativ erteket.
+ */
+long prepare_directory(char *input_file, char **data, long *directory_size) {
+    Directory_stream stream;
+    long dir_size = 0;
+    Arguments args = {0};
+    args.input_file = input_file;
+    long data_len = prepare_directory_stream(args, &stream, &dir_size);
+    *directory_size = dir_size;
+    if (data_len < 0) return data_len;
+
+    *data = malloc(data_len);
+    if (*data == NULL) {
+        printf("Nem sikerult lefoglalni a memoriat a szerializalaskor.\n");
+        free_directory_stream(&stream);
+        return MALLOC_ERROR;
+    }
+    char *current = *data;
+    for (int i = 0; i < stream.segment_count; i++) {
+        memcpy(current, stream.segments[i].data, stream.segments[i].size);
+        current += stream.segments[i].size;
+    }
+    free_directory_stream(&stream);
+    return data_len;
+}
+
 /*
  * Kitomoriteshez szukseges mappa feldolgozas.
- * Deszerializalja es kitomoriti az archivalt mappakat.
+ * Deszerializalja es kitomoriti az archivalt mappakat. Hozzafuzott archivum eseten a nyers adat
+ * tobb egymast koveto szerializalt reszbol all, ezeket sorban bontja ki.
  * Sikeres muveletek eseten 0-t, hiba eseten negativ erteket ad vissza.
  */
-int restore_directory(char *raw_data, char *output_file, bool force, bool no_preserve_perms) {
+int restore_directory(char *raw_data, long raw_size, char *output_file, bool force, bool no_preserve_perms, bool sync) {
     Directory_item *archive = NULL;
     int archive_size = 0;
     int res = 0;
+    long offset = 0;
     
-    while (true) {
-        archive_size = deserialize_archive(&archive, raw_data);
+    if (output_file != NULL) {
+        if (mkdir(output_file, 0755) != 0 && errno != EEXIST) {
+            printf("Nem sikerult letrehozni a kimeneti mappat.\n");
+            return MKDIR_ERROR;
+        }
+    }
+
+    while (offset < raw_size) {
+        /* Az elemek a kitomoritett bufferbe mutatnak, igy a fajltartalmak nem duplikalodnak. */
+        long consumed = 0;
+        archive_size = parse_archive_view(&archive, raw_data + offset, raw_size - offset, &consumed);
         if (archive_size < 0) {
             if (archive_size == MALLOC_ERROR) {
                 printf("Nem sikerult lefoglalni a memoriat a beolvasaskor.\n");
@@ -457,16 +1286,11 @@ int restore_directory(char *raw_data, char *output_file, bool force, bool no_pre
             res = archive_size;
             break;
         }
+        offset += consumed;
         
-        if (output_file != NULL) {
-            if (mkdir(output_file, 0755) != 0 && errno != EEXIST) {
-                printf("Nem sikerult letrehozni a kimeneti mappat.\n");
-                res = MKDIR_ERROR;
-                break;
-            }
-        }
-        
-        int ret = extract_directory(output_file != NULL ? output_file : ".", archive, archive_size, force, no_preserve_perms);
+        int ret = extract_directory(output_file != NULL ? output_file : ".", archive, archive_size, force, no_preserve_perms, sync);
+        free(archive);
+        archive = NULL;
         if (ret != 0) {
             if (ret == MKDIR_ERROR) {
                 printf("Nem sikerult letrehozni egy mappat a kitomoriteskor.\n");
@@ -478,19 +1302,7 @@ int restore_directory(char *raw_data, char *output_file, bool force, bool no_pre
             res = ret;
             break;
         }
-        break;
-    }
-    if (archive_size > 0) {
-        for (int i = 0; i < archive_size; ++i) {
-            if (archive[i].is_dir) {
-                free(archive[i].dir_path);
-            } else {
-                free(archive[i].file_path);
-                free(archive[i].file_data);
-            }
-        }
     }
-    free(archive);
     
     return res;
 }
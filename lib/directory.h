@@ -4,10 +4,21 @@
 #include "data_types.h"
 
 long archive_directory(char *path, Directory_item **archive, int *current, int *archive_size);
+long archive_directory_incremental(char *path, Directory_item **archive, int *current, int *archive_size, Archive_index *base);
+int write_archive_index(char *file_name, Archive_index *previous, Directory_item *archive, int archive_size);
+int read_archive_index(char *file_name, Archive_index *index);
+Index_entry* find_index_entry(Archive_index *index, const char *path);
+void free_archive_index(Archive_index *index);
+int deduplicate_archive(Directory_item *archive, int archive_size);
 long serialize_archive(Directory_item *archive, int archive_size, char **buffer);
-int deserialize_archive(Directory_item **archive, char *buffer);
-int extract_directory(char *path, Directory_item *archive, int archive_size, bool force, bool no_preserve_perms);
-int prepare_directory(char *input_file, char **data, int *directory_size);
-int restore_directory(char *raw_data, char *output_file, bool force, bool no_preserve_perms);
+long serialize_archive_segments(Directory_item *archive, int archive_size, char **headers, Data_segment **segments, int *segment_count);
+int deserialize_archive(Directory_item **archive, char *buffer, long buffer_size);
+int deserialize_archive_view(Directory_item **archive, char *buffer, long buffer_size);
+int extract_directory(char *path, Directory_item *archive, int archive_size, bool force, bool no_preserve_perms, bool sync);
+long prepare_directory(char *input_file, char **data, long *directory_size);
+long prepare_directory_stream(Arguments args, Directory_stream *stream, long *directory_size);
+void free_directory_stream(Directory_stream *stream);
+long prepare_append_stream(Arguments args, Archive_index *previous, Directory_stream *stream, long *directory_size);
+int restore_directory(char *raw_data, long raw_size, char *output_file, bool force, bool no_preserve_perms, bool sync);
 
 #endif // DIRECTORY_H
@@ -18,7 +18,7 @@ long get_file_size(FILE *f){
     long current = ftell(f);
     if (fseek(f, 0, SEEK_END) != 0) return FILE_READ_ERROR;
     long size = ftell(f);
-    fseek(f, 0, current);
+    fseek(f, current, SEEK_SET);
     return size;
 } 
 
@@ -26,7 +26,7 @@ long get_file_size(FILE *f){
  * A bajtok szamat nagyobb egysegkent jeleniti meg, kozben frissiti a bemenetul adott meretet.
  * A valasztott mertekegyseg roviditeset adja vissza.
  */
-const char* get_unit(int *bytes) {
+const char* get_unit(long *bytes) {
     if (*bytes < 1024) return "B";
     *bytes /= 1024;
     if (*bytes < 1024) return "KB";
@@ -38,9 +38,11 @@ const char* get_unit(int *bytes) {
 
 /*
  * Beolvassa a fajlt memoriaba, a pointert a hivo adja meg.
+ * A teljes fajl egyetlen foglalasba kerul, igy a long meret ellenere a fajl nem lehet nagyobb a legnagyobb
+ * foglalhato blokknal (debugmalloc mellett alapertelmezetten 1 MB, a debugmalloc_max_block_size-zal novelheto).
  * Siker eseten a beolvasott bajtok szamat, hibakor negativ kodot ad vissza.
  */
-int read_raw(char file_name[], char** data){
+long read_raw(char file_name[], char** data){
     FILE* f;
     f = fopen(file_name, "rb");
     if (f == NULL) return FILE_READ_ERROR; // Not exists.
@@ -55,7 +57,7 @@ int read_raw(char file_name[], char** data){
         fclose(f);
         return MALLOC_ERROR;
     }
-    size_t read_size = fread(*data, sizeof(char), file_size, f);
+    long read_size = (long)fread(*data, sizeof(char), file_size, f);
     if (read_size != file_size) {
         free(*data);
         *data = NULL;
@@ -70,22 +72,42 @@ int read_raw(char file_name[], char** data){
  * Kiirja a megadott buffert lemezre, feluliras elott rakerdez, ha az overwrite parameter hamis.
  * Ellenorzi hogy a teljes fajlt sikerult-e kiirni, hiba eseten negativ error kodokat ad vissza.
  */
-int write_raw(char *file_name, char *data, long file_size, bool overwrite){
-    FILE* f;
-    f = fopen(file_name, "r");
-    if (f != NULL) { 
-        if (!overwrite) {
-            fclose(f);
-            printf("Letezik a fajl (%s). Felulirjam? [I/n]>", file_name);
-            char input;
-            if (scanf(" %c", &input) != 1) return SCANF_FAILED; 
-            if (tolower(input) != 'i') return NO_OVERWRITE;
-        }
-        else fclose(f);
-    }
-    f = fopen(file_name, "wb");
+long write_raw(char *file_name, char *data, long file_size, bool overwrite){
+    Data_segment segment = {data, file_size};
+    return write_segments(file_name, &segment, 1, overwrite);
+}
+
+/*
+ * Ha a fajl letezik es az overwrite hamis, rakerdez a felulirasra.
+ * Ha irhato, 0-t, kulonben negativ error kodot ad vissza.
+ */
+static int confirm_overwrite(char *file_name, bool overwrite) {
+    FILE *f = fopen(file_name, "r");
+    if (f == NULL) return 0;
+    fclose(f);
+    if (overwrite) return 0;
+    printf("Letezik a fajl (%s). Felulirjam? [I/n]>", file_name);
+    char input;
+    if (scanf(" %c", &input) != 1) return SCANF_FAILED;
+    if (tolower(input) != 'i') return NO_OVERWRITE;
+    return 0;
+}
+
+/*
+ * A write_raw szeletenkenti valtozata: a szeleteket sorban egyetlen fajlba irja, elotte nem kell oket osszefuzni.
+ * Siker eseten a kiirt bajtok szamat, hiba eseten negativ error kodot ad vissza.
+ */
+long write_segments(char *file_name, Data_segment *segments, int segment_count, bool overwrite){
+    int confirm_res = confirm_overwrite(file_name, overwrite);
+    if (confirm_res != 0) return confirm_res;
+    FILE *f = fopen(file_name, "wb");
     if (f == NULL) return FILE_WRITE_ERROR;
-    long written_size = fwrite(data, sizeof(char), file_size, f);
+    long file_size = 0;
+    long written_size = 0;
+    for (int i = 0; i < segment_count; i++) {
+        file_size += segments[i].size;
+        written_size += fwrite(segments[i].data, sizeof(char), segments[i].size, f);
+    }
     fclose(f);
     if (file_size != written_size) return FILE_WRITE_ERROR;
     return written_size;
@@ -94,18 +116,45 @@ int write_raw(char *file_name, char *data, long file_size, bool overwrite){
 /*
  * Beolvassa a tarolt Compressed_file formatumot, ellenorzi hogy megvannak-e a szukseges adatok.
  * Az osszes szukseges buffert lefoglalja, visszaadja azt a Compressed_file strukturat amit a write_compressed funkcio kiirt.
+ * Tobb blokkbol vagy tagbol allo fajl eseten csak az elso tag fejlecet es elso blokkjat olvassa be.
  */
 int read_compressed(char file_name[], Compressed_file *compressed){
-    int ret = SUCCESS;
     FILE* f = fopen(file_name, "rb");
     if (f == NULL) {
         return FILE_READ_ERROR; 
     }
+    compressed->file_name = NULL;
+    int ret = read_member_header(f, compressed);
+    if (ret == SUCCESS) {
+        ret = read_compressed_block(f, compressed);
+        if (ret == SUCCESS && compressed->block_type == BLOCK_END) ret = FILE_MAGIC_ERROR;
+    }
+    fclose(f);
+    if (ret == SUCCESS) {
+        compressed->file_name = strdup(file_name);
+        if (compressed->file_name == NULL) ret = MALLOC_ERROR;
+    }
+    if (ret != SUCCESS) {
+        free(compressed->original_file);
+        free(compressed->huffman_tree);
+        free(compressed->compressed_data);
+        compressed->original_file = NULL;
+        compressed->huffman_tree = NULL;
+        compressed->compressed_data = NULL;
+    }
+    return ret;
+}
+
+/*
+ * Beolvas egy tag fejlecet (azonosito, verzio, mappa jelzo, eredeti nev) a megnyitott fajl aktualis poziciojarol.
+ * Utana a tag blokkjai kovetkeznek, ezeket a read_compressed_block olvassa. A file_name mezot nem tolti ki.
+ */
+int read_member_header(FILE *f, Compressed_file *compressed){
+    int ret = SUCCESS;
 
     compressed->original_file = NULL;
     compressed->huffman_tree = NULL;
     compressed->compressed_data = NULL;
-    compressed->file_name = NULL;
 
     while (true) {
         if (fread(compressed->magic, sizeof(char), sizeof(magic), f) != sizeof(magic)) {
@@ -118,12 +167,17 @@ int read_compressed(char file_name[], Compressed_file *compressed){
             break;
         }
 
-        if (fread(&compressed->is_dir, sizeof(bool), 1, f) != 1) {
+        unsigned char version = 0;
+        if (fread(&version, sizeof(unsigned char), 1, f) != 1) {
             ret = FILE_READ_ERROR;
             break;
         }
+        if (version != format_version) {
+            ret = FILE_MAGIC_ERROR;
+            break;
+        }
 
-        if (fread(&compressed->original_size, sizeof(long), 1, f) != 1) {
+        if (fread(&compressed->is_dir, sizeof(bool), 1, f) != 1) {
             ret = FILE_READ_ERROR;
             break;
         }
@@ -148,6 +202,52 @@ int read_compressed(char file_name[], Compressed_file *compressed){
             break;
         }
         compressed->original_file[name_len] = '\0';
+        break;
+    }
+
+    if (ret != SUCCESS) {
+        free(compressed->original_file);
+        compressed->original_file = NULL;
+    }
+
+    return ret;
+}
+
+/*
+ * Beolvassa a tag kovetkezo blokkjat (tipus, szuro, meretek, fa, kodolt adat). A tag veget jelzo bajtnal a
+ * block_type BLOCK_END lesz, es mas mezot nem tolt ki. Az original_file mezohoz nem nyul.
+ */
+int read_compressed_block(FILE *f, Compressed_file *compressed){
+    int ret = SUCCESS;
+
+    compressed->huffman_tree = NULL;
+    compressed->compressed_data = NULL;
+
+    while (true) {
+        if (fread(&compressed->block_type, sizeof(unsigned char), 1, f) != 1) {
+            ret = FILE_READ_ERROR;
+            break;
+        }
+        if (compressed->block_type == BLOCK_END) break;
+        compressed->filter = FILTER_NONE;
+        compressed->filter_width = 0;
+        if (compressed->block_type & BLOCK_FILTERED) {
+            compressed->block_type &= ~BLOCK_FILTERED;
+            if (fread(&compressed->filter, sizeof(unsigned char), 1, f) != 1
+                    || fread(&compressed->filter_width, sizeof(unsigned char), 1, f) != 1) {
+                ret = FILE_READ_ERROR;
+                break;
+            }
+            if (compressed->filter == FILTER_NONE) {
+                ret = FILE_MAGIC_ERROR;
+                break;
+            }
+        }
+
+        if (fread(&compressed->original_size, sizeof(long), 1, f) != 1) {
+            ret = FILE_READ_ERROR;
+            break;
+        }
 
         if (fread(&compressed->tree_size, sizeof(long), 1, f) != 1) {
             ret = FILE_READ_ERROR;
@@ -158,10 +258,13 @@ int read_compressed(char file_name[], Compressed_file *compressed){
             break;
         }
 
-        compressed->huffman_tree = (Node*)malloc(compressed->tree_size);
-        if (compressed->huffman_tree == NULL) {
-            ret = MALLOC_ERROR;
-            break;
+        /* Tarolt blokknak nincs faja, ilyenkor a huffman_tree NULL marad. */
+        if (compressed->tree_size > 0) {
+            compressed->huffman_tree = (Node*)malloc(compressed->tree_size);
+            if (compressed->huffman_tree == NULL) {
+                ret = MALLOC_ERROR;
+                break;
+            }
         }
         if ((long)fread(compressed->huffman_tree, sizeof(char), compressed->tree_size, f) != compressed->tree_size) {
             ret = FILE_READ_ERROR;
@@ -177,73 +280,179 @@ int read_compressed(char file_name[], Compressed_file *compressed){
             break;
         }
 
+        /* A kontextusos blokk akar egyetlen bitet sem tartalmazhat, ilyenkor a compressed_data NULL marad. */
         long compressed_bytes = (long)ceil((double)compressed->data_size / 8.0);
-        compressed->compressed_data = (char*)malloc(compressed_bytes * sizeof(char));
-        if (compressed->compressed_data == NULL) {
-            ret = MALLOC_ERROR;
-            break;
+        if (compressed_bytes > 0) {
+            compressed->compressed_data = (char*)malloc(compressed_bytes * sizeof(char));
+            if (compressed->compressed_data == NULL) {
+                ret = MALLOC_ERROR;
+                break;
+            }
         }
         if ((long)fread(compressed->compressed_data, sizeof(char), compressed_bytes, f) != compressed_bytes) {
             ret = FILE_READ_ERROR;
             break;
         }
 
-        compressed->file_name = strdup(file_name);
-        if (compressed->file_name == NULL) {
-            ret = MALLOC_ERROR;
-            break;
-        }
-
         break;
     }
 
-    fclose(f);
-
     if (ret != SUCCESS) {
-        free(compressed->original_file);
         free(compressed->huffman_tree);
         free(compressed->compressed_data);
-        free(compressed->file_name);
-        compressed->original_file = NULL;
         compressed->huffman_tree = NULL;
         compressed->compressed_data = NULL;
-        compressed->file_name = NULL;
     }
 
     return ret;
 }
+
 /*
- * Szerializalja a kapott strukturat majd kiirja a megadott fajlba.
- * A kiirast a write_raw funkcio vegzi.
+ * Meghatarozza, hol er veget a megnyitott archivumban a tomoritett tagok sorozata.
+ * Ha a fajl vegen mappa index talalhato, annak kezdetet, kulonben a fajl meretet adja vissza.
  */
-int write_compressed(Compressed_file *compressed, bool overwrite) {
+long get_payload_end(FILE *f) {
+    long file_size = get_file_size(f);
+    if (file_size < 0) return FILE_READ_ERROR;
+    long trailer_size = sizeof(long) + sizeof(index_magic);
+    if (file_size < trailer_size) return file_size;
+
+    long index_size = 0;
+    char trailer_magic[sizeof(index_magic)];
+    if (fseek(f, file_size - trailer_size, SEEK_SET) != 0
+            || fread(&index_size, sizeof(long), 1, f) != 1
+            || fread(trailer_magic, sizeof(char), sizeof(index_magic), f) != sizeof(index_magic)) {
+        return FILE_READ_ERROR;
+    }
+    if (memcmp(trailer_magic, index_magic, sizeof(index_magic)) != 0) return file_size;
+    if (index_size < 0 || index_size > file_size - trailer_size) return FILE_MAGIC_ERROR;
+    return file_size - trailer_size - index_size;
+}
+
+// A tag fejlecenek merete a fajlban (azonosito, verzio, mappa jelzo, a nev hossza es a nev).
+static long member_header_size(Compressed_file *compressed) {
+    return sizeof(magic) + sizeof(format_version) + sizeof(bool) + sizeof(long) + strlen(compressed->original_file);
+}
+
+/*
+ * Megnyitja a kimeneti fajlt (append eseten a vegere fuzve, kulonben feluliras elotti rakerdezessel, ha az overwrite
+ * hamis), es kiirja egy uj tag fejlecet. A blokkokat a write_compressed_block irja, a tagot a close_compressed_member
+ * zarja le. A result-ba siker eseten a fejlec merete kerul, ilyenkor a megnyitott fajlt adja vissza;
+ * hiba eseten NULL-t ad vissza, es a result-ba a negativ hibakod kerul.
+ */
+FILE* open_compressed_member(Compressed_file *compressed, bool append, bool overwrite, long *result) {
+    if (!append) {
+        int confirm_res = confirm_overwrite(compressed->file_name, overwrite);
+        if (confirm_res != 0) {
+            *result = confirm_res;
+            return NULL;
+        }
+    }
+    FILE *f = fopen(compressed->file_name, append ? "ab" : "wb");
+    if (f == NULL) {
+        *result = FILE_WRITE_ERROR;
+        return NULL;
+    }
     long name_len = strlen(compressed->original_file);
-    long file_size = (sizeof(char) * 4) + sizeof(bool) + sizeof(long) + sizeof(long) + name_len * sizeof(char) + sizeof(long) + compressed->tree_size + sizeof(long) + (compressed->data_size + 7) / 8;
-    char *data = malloc(file_size);
-    if (data == NULL) {
-        return MALLOC_ERROR;
+    bool ok = fwrite(magic, sizeof(char), sizeof(magic), f) == sizeof(magic)
+            && fwrite(&format_version, sizeof(unsigned char), 1, f) == 1
+            && fwrite(&compressed->is_dir, sizeof(bool), 1, f) == 1
+            && fwrite(&name_len, sizeof(long), 1, f) == 1
+            && (long)fwrite(compressed->original_file, sizeof(char), name_len, f) == name_len;
+    if (!ok) {
+        fclose(f);
+        *result = FILE_WRITE_ERROR;
+        return NULL;
+    }
+    *result = member_header_size(compressed);
+    return f;
+}
+
+/*
+ * Kiirja a kapott strukturat egy blokkent a megnyitott tag vegere. A fa es a kodolt adat kozvetlenul
+ * a strukturabol irodik ki, a blokkot nem masoljuk ossze egy bufferbe.
+ * Siker eseten a kiirt bajtok szamat, hiba eseten FILE_WRITE_ERROR-t ad vissza.
+ */
+long write_compressed_block(FILE *f, Compressed_file *compressed) {
+    bool filtered = compressed->filter != FILTER_NONE;
+    unsigned char block_type = compressed->block_type | (filtered ? BLOCK_FILTERED : 0);
+    long data_bytes = (compressed->data_size + 7) / 8;
+    long block_size = sizeof(unsigned char) + (filtered ? 2 : 0) + sizeof(long) + sizeof(long) + compressed->tree_size
+                      + sizeof(long) + data_bytes;
+    bool ok = fwrite(&block_type, sizeof(unsigned char), 1, f) == 1
+            && (!filtered || (fwrite(&compressed->filter, sizeof(unsigned char), 1, f) == 1
+                              && fwrite(&compressed->filter_width, sizeof(unsigned char), 1, f) == 1))
+            && fwrite(&compressed->original_size, sizeof(long), 1, f) == 1
+            && fwrite(&compressed->tree_size, sizeof(long), 1, f) == 1
+            && (long)fwrite(compressed->huffman_tree, sizeof(char), compressed->tree_size, f) == compressed->tree_size
+            && fwrite(&compressed->data_size, sizeof(long), 1, f) == 1
+            && (long)fwrite(compressed->compressed_data, sizeof(char), data_bytes, f) == data_bytes;
+    return ok ? block_size : FILE_WRITE_ERROR;
+}
+
+/*
+ * A tag veget jelzo bajt kiirasa utan lezarja a fajlt.
+ * Siker eseten a kiirt bajtok szamat, hiba eseten FILE_WRITE_ERROR-t ad vissza.
+ */
+long close_compressed_member(FILE *f) {
+    unsigned char end = BLOCK_END;
+    bool ok = fwrite(&end, sizeof(unsigned char), 1, f) == 1;
+    if (fclose(f) != 0) ok = false;
+    return ok ? (long)sizeof(end) : FILE_WRITE_ERROR;
+}
+
+/*
+ * Egyetlen blokkbol allo tagkent kiirja a kapott strukturat a megadott fajlba (feluliras elott rakerdez, ha az
+ * overwrite hamis). Siker eseten a kiirt bajtok szamat, hiba eseten negativ kodot ad vissza.
+ */
+long write_compressed(Compressed_file *compressed, bool overwrite) {
+    long header_res = 0;
+    FILE *f = open_compressed_member(compressed, false, overwrite, &header_res);
+    if (f == NULL) return header_res;
+    long block_res = write_compressed_block(f, compressed);
+    long close_res = close_compressed_member(f);
+    if (block_res < 0 || close_res < 0) return FILE_WRITE_ERROR;
+    return header_res + block_res + close_res;
+}
+
+/*
+ * Folyamkent kodolt tag irasanak kezdete: kiirja a tag fejlecet es az egyetlen blokk fejlecet (a meretek helyen
+ * meg 0-val), majd a fajlt a blokk fejlece utan allva adja vissza. A hivo a kodolt bajtokat ide irja, a meretek
+ * beirasat es a lezarast a finish_compressed_stream vegzi. Hiba eseten NULL-t ad vissza, a hibakod az error-ba kerul.
+ */
+FILE* begin_compressed_stream(Compressed_file *compressed, bool overwrite, int *error) {
+    compressed->original_size = 0;
+    compressed->data_size = 0;
+    long header_res = 0;
+    FILE *f = open_compressed_member(compressed, false, overwrite, &header_res);
+    if (f == NULL) {
+        *error = (int)header_res;
+        return NULL;
     }
-    char *current = &data[0];
-    for (int i = 0; i < 4; i++) {
-        data[i] = magic[i];
-    }
-    current += 4;
-    memcpy(current, &compressed->is_dir, sizeof(bool));
-    current += sizeof(bool);
-    memcpy(current, &compressed->original_size, sizeof(long));
-    current += sizeof(long);
-    memcpy(current, &name_len, sizeof(long));
-    current += sizeof(long);
-    memcpy(current, compressed->original_file, name_len);
-    current += name_len;
-    memcpy(current, &compressed->tree_size, sizeof(long));
-    current += sizeof(long);
-    memcpy(current, compressed->huffman_tree, compressed->tree_size);
-    current += compressed->tree_size;
-    memcpy(current, &compressed->data_size, sizeof(long));
-    current += sizeof(long);
-    memcpy(current, compressed->compressed_data, (compressed->data_size + 7) / 8);
-    int res = write_raw(compressed->file_name, data, file_size, overwrite);
-    free(data);
-    return res;
+    if (write_compressed_block(f, compressed) < 0) {
+        fclose(f);
+        *error = FILE_WRITE_ERROR;
+        return NULL;
+    }
+    return f;
+}
+
+/*
+ * Lezarja a folyamkent kodolt tagot, majd a blokk fejlecebe beirja a vegleges eredeti meretet es a kodolt bitek szamat.
+ * Siker eseten a fajl teljes meretet, hiba eseten negativ kodot ad vissza.
+ */
+long finish_compressed_stream(FILE *f, Compressed_file *compressed) {
+    long original_size_offset = member_header_size(compressed) + sizeof(unsigned char)
+                                + (compressed->filter != FILTER_NONE ? 2 : 0);
+    long data_size_offset = original_size_offset + sizeof(long) + sizeof(long) + compressed->tree_size;
+    unsigned char end = BLOCK_END;
+    bool ok = fwrite(&end, sizeof(unsigned char), 1, f) == 1;
+    long file_size = get_file_size(f);
+    ok = ok && file_size >= 0
+            && fseek(f, original_size_offset, SEEK_SET) == 0
+            && fwrite(&compressed->original_size, sizeof(long), 1, f) == 1
+            && fseek(f, data_size_offset, SEEK_SET) == 0
+            && fwrite(&compressed->data_size, sizeof(long), 1, f) == 1;
+    if (fclose(f) != 0) ok = false;
+    return ok ? file_size : FILE_WRITE_ERROR;
 }
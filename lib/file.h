@@ -4,11 +4,20 @@
 #include <stdio_ext.h>
 #include <stdbool.h>
 
-int read_raw(char file_name[], char** data);
-int write_raw(char file_name[], char* data, long file_size, bool overwrite);
+long read_raw(char file_name[], char** data);
+long write_raw(char file_name[], char* data, long file_size, bool overwrite);
+long write_segments(char file_name[], Data_segment *segments, int segment_count, bool overwrite);
 int read_compressed(char file_name[], Compressed_file *compressed);
-int write_compressed(Compressed_file *compressed, bool overwrite); 
+int read_member_header(FILE *f, Compressed_file *compressed);
+int read_compressed_block(FILE *f, Compressed_file *compressed);
+long write_compressed(Compressed_file *compressed, bool overwrite);
+FILE* open_compressed_member(Compressed_file *compressed, bool append, bool overwrite, long *result);
+long write_compressed_block(FILE *f, Compressed_file *compressed);
+long close_compressed_member(FILE *f);
+FILE* begin_compressed_stream(Compressed_file *compressed, bool overwrite, int *error);
+long finish_compressed_stream(FILE *f, Compressed_file *compressed);
 long get_file_size(FILE* f);
-const char* get_unit(int *bytes);
+long get_payload_end(FILE *f);
+const char* get_unit(long *bytes);
 
 #endif
@@ -0,0 +1,355 @@
+#include "filter.h"
+#include "data_types.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Bajtsik-kevero (shuffle) szuro rogzitett szelessegu binaris rekordokhoz: a width bajtos rekordok i. bajtjai
+ * kerulnek egymas utan az i. sikba, igy a rekordok josolhato felso bajtjai es zajos also bajtjai kulon
+ * blokkokba (kulon fakhoz) kerulhetnek. A maradek (len % width) bajt valtozatlanul a kimenet vegere kerul.
+ * A gyakori 2, 4 es 8 bajtos rekordokra rogzitett lepesu ciklus fut, a belso ciklust a fordito (-O2) kibontja;
+ * a transzponalas skalaris, SIMD kernel nincs benne.
+ */
+
+static inline void shuffle_fixed(const unsigned char *in, long records, int width, unsigned char *out) {
+    for (long r = 0; r < records; r++) {
+        for (int b = 0; b < width; b++) {
+            out[b * records + r] = in[r * width + b];
+        }
+    }
+}
+
+static inline void unshuffle_fixed(const unsigned char *in, long records, int width, unsigned char *out) {
+    for (long r = 0; r < records; r++) {
+        for (int b = 0; b < width; b++) {
+            out[r * width + b] = in[b * records + r];
+        }
+    }
+}
+
+// Az in len bajtjat bajtsikokra bontva az out bufferbe irja (az out legalabb len meretu, nem fedi at az in-t).
+void shuffle_bytes(const char *in, long len, int width, char *out) {
+    long records = len / width;
+    const unsigned char *source = (const unsigned char*)in;
+    unsigned char *target = (unsigned char*)out;
+    switch (width) {
+        case 2: shuffle_fixed(source, records, 2, target); break;
+        case 4: shuffle_fixed(source, records, 4, target); break;
+        case 8: shuffle_fixed(source, records, 8, target); break;
+        default: shuffle_fixed(source, records, width, target); break;
+    }
+    memcpy(target + records * width, source + records * width, len - records * width);
+}
+
+// A shuffle_bytes inverze: a bajtsikokbol visszaallitja a rekordokat.
+void unshuffle_bytes(const char *in, long len, int width, char *out) {
+    long records = len / width;
+    const unsigned char *source = (const unsigned char*)in;
+    unsigned char *target = (unsigned char*)out;
+    switch (width) {
+        case 2: unshuffle_fixed(source, records, 2, target); break;
+        case 4: unshuffle_fixed(source, records, 4, target); break;
+        case 8: unshuffle_fixed(source, records, 8, target); break;
+        default: unshuffle_fixed(source, records, width, target); break;
+    }
+    memcpy(target + records * width, source + records * width, len - records * width);
+}
+
+/*
+ * Elorejelzo szurok szamfolyamokhoz: a width bajtos ertekek helyett az elozo ertektol vett kulonbseget (delta,
+ * egesz szamokhoz) vagy bitenkenti XOR-t (lebegopontos ertekekhez) kodolunk. Monoton szamlalokon es idobelyegeken
+ * a maradek kicsi, igy a Huffman fa rovid kodokat ad neki. Az ertekek a gep bajtsorrendjeben olvasodnak
+ * (mint a fajlformatum tobbi szama), a maradek (len % width) bajt valtozatlan marad.
+ * A kodolo irany (predict) minden maradekot kozvetlenul a bemenet ket szomszedos ertekebol szamol, igy a lepesek
+ * nem fuggnek egymastol; csak a dekodolo irany (unpredict) viszi tovabb a futo prefixet.
+ */
+
+// Delta maradekok: out[i] = in[i] - in[i - 1], az elso ertek valtozatlan (elotte 0 all).
+static void delta8(const char *in, long count, char *out) {
+    if (count > 0) memcpy(out, in, sizeof(uint8_t));
+    for (long i = 1; i < count; i++) {
+        uint8_t value, previous;
+        memcpy(&value, in + i * sizeof(value), sizeof(value));
+        memcpy(&previous, in + (i - 1) * sizeof(previous), sizeof(previous));
+        uint8_t result = value - previous;
+        memcpy(out + i * sizeof(result), &result, sizeof(result));
+    }
+}
+
+static void delta16(const char *in, long count, char *out) {
+    if (count > 0) memcpy(out, in, sizeof(uint16_t));
+    for (long i = 1; i < count; i++) {
+        uint16_t value, previous;
+        memcpy(&value, in + i * sizeof(value), sizeof(value));
+        memcpy(&previous, in + (i - 1) * sizeof(previous), sizeof(previous));
+        uint16_t result = value - previous;
+        memcpy(out + i * sizeof(result), &result, sizeof(result));
+    }
+}
+
+static void delta32(const char *in, long count, char *out) {
+    if (count > 0) memcpy(out, in, sizeof(uint32_t));
+    for (long i = 1; i < count; i++) {
+        uint32_t value, previous;
+        memcpy(&value, in + i * sizeof(value), sizeof(value));
+        memcpy(&previous, in + (i - 1) * sizeof(previous), sizeof(previous));
+        uint32_t result = value - previous;
+        memcpy(out + i * sizeof(result), &result, sizeof(result));
+    }
+}
+
+static void delta64(const char *in, long count, char *out) {
+    if (count > 0) memcpy(out, in, sizeof(uint64_t));
+    for (long i = 1; i < count; i++) {
+        uint64_t value, previous;
+        memcpy(&value, in + i * sizeof(value), sizeof(value));
+        memcpy(&previous, in + (i - 1) * sizeof(previous), sizeof(previous));
+        uint64_t result = value - previous;
+        memcpy(out + i * sizeof(result), &result, sizeof(result));
+    }
+}
+
+// XOR maradekok: out[i] = in[i] ^ in[i - 1], az elso ertek valtozatlan.
+static void xor32(const char *in, long count, char *out) {
+    if (count > 0) memcpy(out, in, sizeof(uint32_t));
+    for (long i = 1; i < count; i++) {
+        uint32_t value, previous;
+        memcpy(&value, in + i * sizeof(value), sizeof(value));
+        memcpy(&previous, in + (i - 1) * sizeof(previous), sizeof(previous));
+        uint32_t result = value ^ previous;
+        memcpy(out + i * sizeof(result), &result, sizeof(result));
+    }
+}
+
+static void xor64(const char *in, long count, char *out) {
+    if (count > 0) memcpy(out, in, sizeof(uint64_t));
+    for (long i = 1; i < count; i++) {
+        uint64_t value, previous;
+        memcpy(&value, in + i * sizeof(value), sizeof(value));
+        memcpy(&previous, in + (i - 1) * sizeof(previous), sizeof(previous));
+        uint64_t result = value ^ previous;
+        memcpy(out + i * sizeof(result), &result, sizeof(result));
+    }
+}
+
+/* A maradekokbol helyben allitjuk vissza az ertekeket; az elozo visszaallitott ertek a futo prefix. */
+static void unpredict8(char *data, long count, bool use_xor) {
+    uint8_t previous = 0;
+    for (long i = 0; i < count; i++) {
+        uint8_t value = (uint8_t)data[i];
+        previous = use_xor ? value ^ previous : value + previous;
+        data[i] = (char)previous;
+    }
+}
+
+static void unpredict16(char *data, long count, bool use_xor) {
+    uint16_t previous = 0;
+    for (long i = 0; i < count; i++) {
+        uint16_t value;
+        memcpy(&value, data + i * sizeof(value), sizeof(value));
+        previous = use_xor ? value ^ previous : value + previous;
+        memcpy(data + i * sizeof(previous), &previous, sizeof(previous));
+    }
+}
+
+static void unpredict32(char *data, long count, bool use_xor) {
+    uint32_t previous = 0;
+    for (long i = 0; i < count; i++) {
+        uint32_t value;
+        memcpy(&value, data + i * sizeof(value), sizeof(value));
+        previous = use_xor ? value ^ previous : value + previous;
+        memcpy(data + i * sizeof(previous), &previous, sizeof(previous));
+    }
+}
+
+static void unpredict64(char *data, long count, bool use_xor) {
+    uint64_t previous = 0;
+    for (long i = 0; i < count; i++) {
+        uint64_t value;
+        memcpy(&value, data + i * sizeof(value), sizeof(value));
+        previous = use_xor ? value ^ previous : value + previous;
+        memcpy(data + i * sizeof(previous), &previous, sizeof(previous));
+    }
+}
+
+// Igaz, ha a szuro es a szelesseg egy tagra alkalmazhato elorejelzest ir le.
+bool valid_prediction(unsigned char filter, unsigned char width) {
+    if (filter == FILTER_DELTA) return width == 1 || width == 2 || width == 4 || width == 8;
+    if (filter == FILTER_XOR) return width == 4 || width == 8;
+    return false;
+}
+
+// Az in len bajtjanak elorejelzesi maradekat az out bufferbe irja (a szurot a valid_prediction-nel kell ellenorizni).
+void predict_block(const char *in, long len, unsigned char filter, int width, char *out) {
+    long count = len / width;
+    if (filter == FILTER_XOR) {
+        if (width == 4) xor32(in, count, out);
+        else xor64(in, count, out);
+    } else {
+        switch (width) {
+            case 1: delta8(in, count, out); break;
+            case 2: delta16(in, count, out); break;
+            case 4: delta32(in, count, out); break;
+            default: delta64(in, count, out); break;
+        }
+    }
+    memcpy(out + count * width, in + count * width, len - count * width);
+}
+
+// A predict_block inverze helyben. Ervenytelen szuro eseten DECOMPRESSION_ERROR-t ad vissza.
+int unpredict_block(char *data, long len, unsigned char filter, int width) {
+    if (!valid_prediction(filter, width)) return DECOMPRESSION_ERROR;
+    long count = len / width;
+    bool use_xor = filter == FILTER_XOR;
+    switch (width) {
+        case 1: unpredict8(data, count, use_xor); break;
+        case 2: unpredict16(data, count, use_xor); break;
+        case 4: unpredict32(data, count, use_xor); break;
+        default: unpredict64(data, count, use_xor); break;
+    }
+    return 0;
+}
+
+/*
+ * Oszlopos (columnar) szuro tagolt szoveges rekordokhoz (CSV, TSV): a sorok mezoi oszloponkent egymas utan kerulnek
+ * egy-egy folyamba, igy az oszlopok (allapotkodok, gepnevek, idobelyegek) szuk eloszlasa kulon fat kaphat. Minden mezo
+ * a lezarojaval (elvalaszto vagy sorvege) egyutt kerul a folyamba, igy a sorok visszaallithatok. Idezojelen belul az
+ * elvalaszto es a sorvege a mezo resze. Az utolso oszlop a sor vegeig tart, a rovidebb sorok kevesebb oszlopot toltenek.
+ */
+
+// Az elvalaszto jelolt bajtjai, gyakorisagi sorrendben.
+static const char column_delimiters[] = {',', '\t', ';', '|'};
+
+/*
+ * Az in elejen allo mezo hossza a lezaroval egyutt. A last oszlop mezojet csak a sorvege zarja.
+ * A row_continues kimenetbe irja, hogy a mezot elvalaszto zarta-e (a sor folytatodik).
+ */
+static long field_length(const char *in, long len, char delimiter, bool last, bool *row_continues) {
+    bool quoted = false;
+    for (long i = 0; i < len; i++) {
+        if (in[i] == '"') {
+            quoted = !quoted;
+        } else if (!quoted && (in[i] == '\n' || (in[i] == delimiter && !last))) {
+            *row_continues = in[i] == delimiter;
+            return i + 1;
+        }
+    }
+    *row_continues = false;
+    return len;
+}
+
+/*
+ * Az adat elso COLUMNS_SAMPLE_LINES soraban keresi az elvalasztot: az a jelolt nyer, amelynel a legtobb sor mezoszama
+ * egyezik (legalabb 2 mezo, es a sorok legalabb haromnegyede). Az oszlopok szamat adja vissza (legfeljebb COLUMNS_MAX),
+ * az elvalasztot a delimiter kimenetbe irja; ha az adat nem tagolt, 0-t ad vissza.
+ */
+int detect_columns(const char *data, long len, char *delimiter) {
+    int best_columns = 0;
+    int best_lines = 0;
+    for (int d = 0; d < (int)sizeof(column_delimiters); d++) {
+        int field_counts[COLUMNS_SAMPLE_LINES];
+        int line_count = 0;
+        long position = 0;
+        while (position < len && line_count < COLUMNS_SAMPLE_LINES) {
+            int fields = 0;
+            bool row_continues = true;
+            while (row_continues && position < len) {
+                position += field_length(data + position, len - position, column_delimiters[d], false, &row_continues);
+                fields++;
+            }
+            field_counts[line_count++] = fields;
+        }
+        for (int i = 0; i < line_count; i++) {
+            if (field_counts[i] < 2) continue;
+            int matching = 0;
+            for (int j = 0; j < line_count; j++) {
+                if (field_counts[j] == field_counts[i]) matching++;
+            }
+            if (line_count >= 2 && 4 * matching >= 3 * line_count
+                    && (matching > best_lines || (matching == best_lines && field_counts[i] > best_columns))) {
+                best_lines = matching;
+                best_columns = field_counts[i];
+                *delimiter = column_delimiters[d];
+            }
+        }
+    }
+    return best_columns < COLUMNS_MAX ? best_columns : COLUMNS_MAX;
+}
+
+long columns_header_size(int column_count) {
+    return 1 + column_count * (long)sizeof(long);
+}
+
+/*
+ * Az in len bajtjat column_count oszlop folyamara bontja az out bufferbe (len meretu, nem fedi at az in-t). A header
+ * (columns_header_size meretu) az elvalasztot es az oszlopfolyamok hosszat kapja, a hosszakat a column_sizes-ba is irja.
+ */
+void split_columns(const char *in, long len, char delimiter, int column_count, char *header, char *out, long *column_sizes) {
+    for (int c = 0; c < column_count; c++) {
+        column_sizes[c] = 0;
+    }
+    bool row_continues = false;
+    int column = 0;
+    for (long position = 0; position < len; ) {
+        long size = field_length(in + position, len - position, delimiter, column == column_count - 1, &row_continues);
+        column_sizes[column] += size;
+        position += size;
+        column = row_continues ? column + 1 : 0;
+    }
+    long offsets[COLUMNS_MAX];
+    long offset = 0;
+    for (int c = 0; c < column_count; c++) {
+        offsets[c] = offset;
+        offset += column_sizes[c];
+    }
+    column = 0;
+    for (long position = 0; position < len; ) {
+        long size = field_length(in + position, len - position, delimiter, column == column_count - 1, &row_continues);
+        memcpy(out + offsets[column], in + position, size);
+        offsets[column] += size;
+        position += size;
+        column = row_continues ? column + 1 : 0;
+    }
+    header[0] = delimiter;
+    memcpy(header + 1, column_sizes, column_count * sizeof(long));
+}
+
+/*
+ * A split_columns inverze: az in (a fejlec es az oszlopfolyamok, len bajt) sorait az out bufferbe
+ * (len - columns_header_size meretu) allitja vissza. Serult adat eseten DECOMPRESSION_ERROR-t ad vissza.
+ */
+int join_columns(const char *in, long len, int column_count, char *out) {
+    long header_size = columns_header_size(column_count);
+    if (column_count < 2 || column_count > COLUMNS_MAX || len < header_size) return DECOMPRESSION_ERROR;
+    char delimiter = in[0];
+    long offsets[COLUMNS_MAX];
+    long ends[COLUMNS_MAX];
+    long offset = header_size;
+    for (int c = 0; c < column_count; c++) {
+        long size = 0;
+        memcpy(&size, in + 1 + c * sizeof(long), sizeof(long));
+        if (size < 0 || size > len - offset) return DECOMPRESSION_ERROR;
+        offsets[c] = offset;
+        offset += size;
+        ends[c] = offset;
+    }
+    if (offset != len) return DECOMPRESSION_ERROR;
+
+    long written = 0;
+    int column = 0;
+    while (written < len - header_size) {
+        if (offsets[column] == ends[column]) return DECOMPRESSION_ERROR;
+        bool row_continues = false;
+        long size = field_length(in + offsets[column], ends[column] - offsets[column], delimiter, column == column_count - 1, &row_continues);
+        if (size <= 0 || size > len - header_size - written) return DECOMPRESSION_ERROR;
+        memcpy(out + written, in + offsets[column], size);
+        offsets[column] += size;
+        written += size;
+        column = row_continues ? column + 1 : 0;
+    }
+    for (int c = 0; c < column_count; c++) {
+        if (offsets[c] != ends[c]) return DECOMPRESSION_ERROR;
+    }
+    return 0;
+}
@@ -0,0 +1,24 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include "data_types.h"
+#include <stdbool.h>
+
+// A --shuffle=N rekordmerete legalabb 2 es legfeljebb ennyi bajt (a tag fejleceben egy bajton tarolodik).
+#define SHUFFLE_WIDTH_MAX 255
+// A --columnar legfeljebb ennyi oszlopot bont szet, a tobbi mezo az utolso oszlopba kerul.
+#define COLUMNS_MAX 64
+// Az elvalaszto felismeresehez az adat elso ennyi sorat vizsgaljuk.
+#define COLUMNS_SAMPLE_LINES 64
+
+void shuffle_bytes(const char *in, long len, int width, char *out);
+void unshuffle_bytes(const char *in, long len, int width, char *out);
+bool valid_prediction(unsigned char filter, unsigned char width);
+void predict_block(const char *in, long len, unsigned char filter, int width, char *out);
+int unpredict_block(char *data, long len, unsigned char filter, int width);
+int detect_columns(const char *data, long len, char *delimiter);
+long columns_header_size(int column_count);
+void split_columns(const char *in, long len, char delimiter, int column_count, char *header, char *out, long *column_sizes);
+int join_columns(const char *in, long len, int column_count, char *out);
+
+#endif // FILTER_H
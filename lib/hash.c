@@ -0,0 +1,143 @@
+#include "hash.h"
+#include "data_types.h"
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
+/*
+ * XXH64 alapu 64 bites tartalom hash. Nem kriptografiai, a fajlok es adatreszek
+ * azonossaganak gyors elodontesere szolgal; egyezes eseten a hivo bajtonkent is osszehasonlit.
+ */
+static const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+static const uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+static uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static uint64_t read64(const char *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint32_t read32(const char *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint64_t hash_round(uint64_t acc, uint64_t input) {
+    acc += input * PRIME64_2;
+    acc = rotl64(acc, 31);
+    return acc * PRIME64_1;
+}
+
+static uint64_t merge_round(uint64_t acc, uint64_t val) {
+    acc ^= hash_round(0, val);
+    return acc * PRIME64_1 + PRIME64_4;
+}
+
+// A 32 bajtos csikokat feldolgozo negy akkumulator kezdoerteke.
+static void init_lanes(uint64_t *lanes) {
+    lanes[0] = PRIME64_1 + PRIME64_2;
+    lanes[1] = PRIME64_2;
+    lanes[2] = 0;
+    lanes[3] = -PRIME64_1;
+}
+
+// Feldolgozza a p-tol kezdodo teljes 32 bajtos csikokat, a feldolgozott bajtok szamat adja vissza.
+static long hash_stripes(uint64_t *lanes, const char *p, long len) {
+    long done = 0;
+    while (len - done >= 32) {
+        lanes[0] = hash_round(lanes[0], read64(p + done));
+        lanes[1] = hash_round(lanes[1], read64(p + done + 8));
+        lanes[2] = hash_round(lanes[2], read64(p + done + 16));
+        lanes[3] = hash_round(lanes[3], read64(p + done + 24));
+        done += 32;
+    }
+    return done;
+}
+
+/*
+ * A hash befejezese: az akkumulatorokat (ha volt teljes csik) osszevonja, hozzaveszi a teljes hosszt
+ * es a 32 bajtnal rovidebb maradekot, majd elvegzi a vegso keverest.
+ */
+static uint64_t hash_finish(const uint64_t *lanes, long total_len, const char *p, const char *end) {
+    uint64_t h;
+    if (total_len >= 32) {
+        h = rotl64(lanes[0], 1) + rotl64(lanes[1], 7) + rotl64(lanes[2], 12) + rotl64(lanes[3], 18);
+        h = merge_round(h, lanes[0]);
+        h = merge_round(h, lanes[1]);
+        h = merge_round(h, lanes[2]);
+        h = merge_round(h, lanes[3]);
+    } else {
+        h = PRIME64_5;
+    }
+
+    h += (uint64_t)total_len;
+
+    while (p + 8 <= end) {
+        h ^= hash_round(0, read64(p));
+        h = rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        h ^= (uint64_t)read32(p) * PRIME64_1;
+        h = rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= (uint64_t)(unsigned char)*p * PRIME64_5;
+        h = rotl64(h, 11) * PRIME64_1;
+        p++;
+    }
+
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+/*
+ * Kiszamolja az adat 64 bites hash erteket. Ures adatra is ervenyes erteket ad.
+ */
+uint64_t hash_data(const char *data, long data_len) {
+    uint64_t lanes[4];
+    init_lanes(lanes);
+    long done = hash_stripes(lanes, data, data_len);
+    return hash_finish(lanes, data_len, data + done, data + data_len);
+}
+
+/*
+ * A fajl tartalmanak hash-e (ugyanaz, mint a teljes tartalomra hivott hash_data), a fajlt darabonkent olvasva,
+ * igy a memoriaba nem fero meretu fajlokra is mukodik. Siker eseten 0-t, hiba eseten FILE_READ_ERROR-t ad vissza.
+ */
+int hash_file(const char *file_name, uint64_t *hash) {
+    FILE *f = fopen(file_name, "rb");
+    if (f == NULL) return FILE_READ_ERROR;
+    char buffer[HASH_READ_CHUNK + 32];
+    uint64_t lanes[4];
+    init_lanes(lanes);
+    long pending = 0;
+    long total_len = 0;
+    while (true) {
+        long read_size = (long)fread(buffer + pending, sizeof(char), HASH_READ_CHUNK, f);
+        if (read_size == 0) break;
+        total_len += read_size;
+        pending += read_size;
+        long done = hash_stripes(lanes, buffer, pending);
+        memmove(buffer, buffer + done, pending - done);
+        pending -= done;
+    }
+    bool failed = ferror(f) != 0;
+    fclose(f);
+    if (failed) return FILE_READ_ERROR;
+    *hash = hash_finish(lanes, total_len, buffer, buffer + pending);
+    return 0;
+}
@@ -0,0 +1,12 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stdint.h>
+
+// A hash_file ekkora darabokban olvassa a fajlt.
+#define HASH_READ_CHUNK 65536
+
+uint64_t hash_data(const char *data, long data_len);
+int hash_file(const char *file_name, uint64_t *hash);
+
+#endif // HASH_H
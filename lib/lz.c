@@ -0,0 +1,182 @@
+#include "lz.h"
+#include "alphabet.h"
+#include "compress.h"
+#include "data_types.h"
+#include "debugmalloc.h"
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+/*
+ * LZ77 elofeldolgozas hash lancos egyezeskeresessel. A blokk szekvenciak sorozata: literal-futas hossza, a literalok,
+ * majd (ha a blokk meg nem ert veget) az egyezes hossza es tavolsaga. A hosszakat es a tavolsagot logaritmikus
+ * osztalykodra es extra bitekre bontjuk (sink_value), igy mind a negy abece elfer egy 256 elemu Huffman faban.
+ * A kodolo a determinisztikus elemzest ketszer futtatja: eloszor csak szamol (ebbol epulnek a fak), masodszor kodol,
+ * igy a szekvenciakat nem kell eltarolni.
+ */
+
+enum {
+    LZ_LITERAL_RUN = 0,
+    LZ_LITERAL = 1,
+    LZ_MATCH_LENGTH = 2,
+    LZ_DISTANCE = 3
+};
+
+static int put_sequence(Symbol_sink *sink, const char *literals, long literal_count, long match_length, long distance) {
+    int res = sink_value(sink, LZ_LITERAL_RUN, literal_count);
+    for (long i = 0; i < literal_count && res == 0; i++) {
+        res = sink_symbol(sink, LZ_LITERAL, (unsigned char)literals[i]);
+    }
+    if (res == 0 && match_length > 0) {
+        res = sink_value(sink, LZ_MATCH_LENGTH, match_length - LZ_MATCH_MIN);
+        if (res == 0) res = sink_value(sink, LZ_DISTANCE, distance - 1);
+    }
+    return res;
+}
+
+static unsigned int hash4(const char *data) {
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return (value * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/*
+ * Moho LZ77 elemzes: minden pozicion a hash lanc legfeljebb LZ_CHAIN_MAX jeloltje kozul a leghosszabb egyezest
+ * valasztja (egyenlo hossznal a legkozelebbit). A szekvenciakat a sink-be irja. Siker eseten 0-t, kulonben negativ kodot ad.
+ */
+static int lz_parse(char *data, long data_len, int window, Symbol_sink *sink) {
+    int *head = malloc((1 << LZ_HASH_BITS) * sizeof(int));
+    int *previous = malloc(window * sizeof(int));
+    if (head == NULL || previous == NULL) {
+        free(head);
+        free(previous);
+        return MALLOC_ERROR;
+    }
+    memset(head, -1, (1 << LZ_HASH_BITS) * sizeof(int));
+
+    int res = 0;
+    long position = 0;
+    long literal_start = 0;
+    long inserted = 0;
+    while (position < data_len && res == 0) {
+        long best_length = 0;
+        long best_distance = 0;
+        if (position + LZ_MATCH_MIN <= data_len) {
+            long candidate = head[hash4(data + position)];
+            long limit = data_len - position < LZ_MATCH_MAX ? data_len - position : LZ_MATCH_MAX;
+            for (int chain = 0; chain < LZ_CHAIN_MAX && candidate >= 0 && position - candidate < window; chain++) {
+                long length = 0;
+                while (length < limit && data[candidate + length] == data[position + length]) length++;
+                if (length > best_length) {
+                    best_length = length;
+                    best_distance = position - candidate;
+                    if (length == limit) break;
+                }
+                long next = previous[candidate & (window - 1)];
+                if (next >= candidate) break;
+                candidate = next;
+            }
+        }
+
+        long step = best_length >= LZ_MATCH_MIN ? best_length : 1;
+        if (best_length >= LZ_MATCH_MIN) {
+            res = put_sequence(sink, data + literal_start, position - literal_start, best_length, best_distance);
+        }
+        /* A lepes minden poziciojat felvesszuk a hash lancokba. */
+        for (; inserted < position + step && inserted + LZ_MATCH_MIN <= data_len; inserted++) {
+            unsigned int h = hash4(data + inserted);
+            previous[inserted & (window - 1)] = head[h];
+            head[h] = (int)inserted;
+        }
+        position += step;
+        if (best_length >= LZ_MATCH_MIN) literal_start = position;
+    }
+    /* A zaro szekvencia csak literalokat tartalmaz (akar nullat is), a dekodolo itt eri el a blokk veget. */
+    if (res == 0) res = put_sequence(sink, data + literal_start, data_len - literal_start, 0, 0);
+
+    free(head);
+    free(previous);
+    return res;
+}
+
+/*
+ * Szamlalo elemzessel felepiti a negy abece fajat, es visszaadja a kodolt blokk becsult meretet bajtokban
+ * (a fak tarolasaval egyutt). Hiba eseten negativ kodot ad vissza.
+ */
+long lz_estimate(char *data, long data_len, int window, Alphabet_model *model) {
+    memset(model, 0, sizeof(Alphabet_model));
+    Symbol_sink *sink = calloc(1, sizeof(Symbol_sink));
+    if (sink == NULL) return MALLOC_ERROR;
+    long res = lz_parse(data, data_len, window, sink);
+    if (res == 0) res = build_alphabet_model(sink, LZ_ALPHABETS, model);
+    free(sink);
+    return res;
+}
+
+/*
+ * Az lz_estimate altal epitett fakkal kodolja a blokkot. A fak szerializalt alakjat a tree kimenetbe irja
+ * (a hivo szabaditja fel), a compressed_file fa es adat mezoit kitolti.
+ */
+int lz_encode(char *data, long data_len, int window, Alphabet_model *model, Compressed_file *compressed_file, Node **tree) {
+    long tree_size = alphabet_model_size(model);
+    char *serialized = malloc(tree_size);
+    Symbol_sink *sink = calloc(1, sizeof(Symbol_sink));
+    int res = 0;
+    while (true) {
+        if (serialized == NULL || sink == NULL) {
+            res = MALLOC_ERROR;
+            break;
+        }
+        res = open_sink_output(sink, model, data_len / 2 + 16);
+        if (res != 0) break;
+        serialize_alphabet_model(model, serialized);
+        res = lz_parse(data, data_len, window, sink);
+        if (res != 0) break;
+
+        compressed_file->compressed_data = (char*)sink->out;
+        compressed_file->data_size = sink->bits;
+        compressed_file->huffman_tree = (Node*)serialized;
+        compressed_file->tree_size = tree_size;
+        *tree = (Node*)serialized;
+        sink->out = NULL;
+        serialized = NULL;
+        break;
+    }
+    if (sink != NULL) close_sink(sink);
+    free(sink);
+    free(serialized);
+    return res;
+}
+
+/*
+ * A fa helyen allo negy abece alapjan visszaallitja a blokk raw_size bajtjat. Serult adat eseten DECOMPRESSION_ERROR-t ad.
+ */
+int lz_decode(const char *tree, long tree_size, const unsigned char *in, long bit_count, char *raw, long raw_size) {
+    Alphabet_model model;
+    if (parse_alphabet_model(tree, tree_size, LZ_ALPHABETS, &model) != tree_size) return DECOMPRESSION_ERROR;
+
+    long position = 0;
+    long written = 0;
+    while (true) {
+        long literal_count = read_alphabet_value(&model, LZ_LITERAL_RUN, in, bit_count, &position);
+        if (literal_count < 0 || literal_count > raw_size - written) return DECOMPRESSION_ERROR;
+        for (long i = 0; i < literal_count; i++) {
+            int literal = read_alphabet_symbol(&model, LZ_LITERAL, in, bit_count, &position);
+            if (literal < 0) return DECOMPRESSION_ERROR;
+            raw[written++] = (char)literal;
+        }
+        if (written == raw_size) break;
+
+        long length = read_alphabet_value(&model, LZ_MATCH_LENGTH, in, bit_count, &position);
+        long distance = read_alphabet_value(&model, LZ_DISTANCE, in, bit_count, &position);
+        if (length < 0 || distance < 0) return DECOMPRESSION_ERROR;
+        length += LZ_MATCH_MIN;
+        distance += 1;
+        if (distance > written || length > raw_size - written) return DECOMPRESSION_ERROR;
+        /* Atfedo egyezesnel (tavolsag < hossz) bajtonkent kell masolni. */
+        for (long i = 0; i < length; i++, written++) {
+            raw[written] = raw[written - distance];
+        }
+    }
+    return position == bit_count ? 0 : DECOMPRESSION_ERROR;
+}
@@ -0,0 +1,23 @@
+#ifndef LZ_H
+#define LZ_H
+
+#include "data_types.h"
+
+// Az LZ77 ablak alapertelmezett, legkisebb es legnagyobb merete (2 hatvanya, bajtokban).
+#define LZ_WINDOW_DEFAULT 32768
+#define LZ_WINDOW_MIN 1024
+#define LZ_WINDOW_MAX 131072
+// Ennel rovidebb egyezest nem kodolunk, es egy egyezes legfeljebb LZ_MATCH_MAX hosszu.
+#define LZ_MATCH_MIN 4
+#define LZ_MATCH_MAX 65536
+// A hash lanc kereses ennyi jeloltet vizsgal meg legfeljebb; a hash tabla 2^LZ_HASH_BITS elemu.
+#define LZ_CHAIN_MAX 64
+#define LZ_HASH_BITS 15
+// Az LZ77 szekvenciak abecei: literal-futas hossza, literal, egyezes hossza, tavolsag.
+#define LZ_ALPHABETS 4
+
+long lz_estimate(char *data, long data_len, int window, Alphabet_model *model);
+int lz_encode(char *data, long data_len, int window, Alphabet_model *model, Compressed_file *compressed_file, Node **tree);
+int lz_decode(const char *tree, long tree_size, const unsigned char *in, long bit_count, char *raw, long raw_size);
+
+#endif // LZ_H
@@ -0,0 +1,101 @@
+#include "tables.h"
+#include "compress.h"
+#include "data_types.h"
+#include "debugmalloc.h"
+#include <string.h>
+
+/*
+ * Beepitett bajtgyakorisag-profilok (0-65000 koze skalazva, minden ertek legalabb 1, hogy minden bajtnak legyen kodja).
+ * Mintakorpuszokbol szamoltuk: angol nyelvu licenc- es dokumentacios szovegek, JSON fajlok es x86-64 ELF programok.
+ * A kodolo es a dekodolo ugyanebbol a profilbol, ugyanazzal a construct_tree-vel epiti fel a fat.
+ */
+static const unsigned short TEXT_WEIGHTS[256] = {
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 150, 9344, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    65000, 2, 501, 41, 1, 1, 5, 220, 715, 746, 485, 189, 4554, 3446, 5014, 3045,
+    2658, 1858, 2741, 861, 384, 307, 354, 240, 390, 1050, 1642, 345, 512, 1126, 513, 5,
+    473, 5654, 1422, 3644, 2732, 6344, 2769, 2039, 2305, 6938, 161, 231, 4406, 1690, 5353, 5506,
+    2487, 101, 5724, 5405, 6779, 2396, 598, 1359, 227, 1434, 49, 13, 2, 13, 1, 567,
+    127, 14343, 4148, 9334, 8220, 26269, 4911, 4450, 8824, 20602, 362, 1245, 8490, 6226, 15827, 18904,
+    5986, 143, 16224, 15014, 20263, 6536, 2272, 2975, 712, 4056, 292, 1, 29, 1, 4, 1,
+    14, 1, 2, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 4, 9, 1, 1, 1, 1, 1, 1,
+    1, 5, 1, 1, 7, 1, 1, 2, 1, 69, 1, 2, 1, 3, 1, 1,
+    2, 1, 1, 2, 4, 2, 20, 1, 2, 1, 1, 2, 5, 2, 1, 2,
+    1, 1, 64, 51, 3, 9, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    7, 2, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    4, 1, 13, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1
+};
+
+static const unsigned short JSON_WEIGHTS[256] = {
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 118, 7979, 1, 1, 6349, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    65000, 5, 22185, 165, 18, 101, 6, 8, 24, 24, 7, 345, 4798, 1670, 13508, 2887,
+    3651, 3172, 2611, 1953, 2358, 1731, 1346, 720, 589, 478, 7720, 5, 2, 530, 2, 25,
+    15, 812, 565, 1342, 619, 845, 487, 651, 573, 524, 389, 348, 527, 1351, 938, 598,
+    1007, 394, 1048, 1912, 1192, 444, 566, 455, 388, 355, 340, 182, 97, 182, 3, 1178,
+    9, 9106, 2128, 5460, 4041, 16480, 2489, 2552, 3534, 8575, 494, 1614, 6223, 4937, 7975, 8769,
+    4481, 436, 8845, 11747, 12874, 4272, 1618, 928, 1198, 3402, 646, 2034, 5, 2034, 5, 1,
+    2, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1
+};
+
+static const unsigned short X86_WEIGHTS[256] = {
+    65000, 5131, 2292, 1695, 1854, 1542, 888, 969, 3584, 542, 713, 875, 603, 603, 3759, 6372,
+    3389, 800, 441, 300, 390, 1369, 240, 226, 1738, 240, 221, 200, 360, 239, 250, 1361,
+    3188, 285, 228, 179, 7202, 524, 167, 197, 1413, 836, 160, 269, 333, 487, 772, 282,
+    1262, 1103, 209, 202, 354, 389, 185, 169, 894, 790, 240, 324, 483, 473, 260, 267,
+    1255, 3841, 1778, 562, 2768, 889, 483, 482, 14361, 2583, 264, 292, 3281, 745, 314, 259,
+    896, 207, 202, 582, 743, 510, 394, 421, 446, 144, 154, 535, 630, 533, 422, 685,
+    588, 940, 328, 758, 752, 1326, 1649, 386, 698, 932, 154, 268, 950, 476, 930, 1125,
+    975, 162, 1009, 1113, 2893, 1154, 381, 350, 524, 266, 157, 300, 957, 223, 284, 387,
+    1188, 416, 210, 2723, 2636, 2081, 361, 237, 618, 6781, 295, 4740, 596, 3363, 368, 351,
+    735, 178, 147, 288, 365, 173, 143, 148, 328, 131, 113, 141, 272, 128, 117, 139,
+    394, 118, 119, 146, 198, 116, 143, 162, 322, 130, 174, 152, 265, 123, 119, 136,
+    474, 144, 112, 132, 385, 169, 467, 295, 497, 391, 835, 208, 703, 170, 508, 328,
+    1774, 776, 350, 1015, 564, 417, 807, 1220, 466, 344, 191, 154, 173, 161, 187, 161,
+    520, 240, 322, 189, 204, 238, 220, 265, 404, 172, 203, 349, 167, 162, 265, 563,
+    571, 343, 253, 191, 244, 194, 296, 354, 2519, 1232, 248, 1025, 404, 393, 344, 445,
+    620, 201, 251, 411, 215, 216, 732, 654, 675, 323, 398, 452, 463, 586, 878, 9420
+};
+
+static const char *table_names[STATIC_TABLE_COUNT] = {"text", "json", "x86"};
+static const unsigned short *table_weights[STATIC_TABLE_COUNT] = {TEXT_WEIGHTS, JSON_WEIGHTS, X86_WEIGHTS};
+
+// A mar felepitett tablak fai, az elso hasznalatkor toltodnek fel.
+static Node table_nodes[STATIC_TABLE_COUNT][511];
+static bool table_ready[STATIC_TABLE_COUNT];
+
+// Visszaadja a nevhez tartozo tabla azonositojat, ismeretlen nev eseten -1-et.
+int find_static_table(const char *name) {
+    for (int i = 0; i < STATIC_TABLE_COUNT; i++) {
+        if (strcmp(name, table_names[i]) == 0) return i;
+    }
+    return -1;
+}
+
+/*
+ * Megadja a beepitett tabla Huffman fajat (a levelek a profil szerinti gyakorisagokkal). A fa statikus tarban el,
+ * nem kell felszabaditani. Ervenytelen azonosito eseten TREE_ERROR-t ad vissza.
+ */
+int get_static_tree(int table_id, Node **nodes, Node **root_node) {
+    if (table_id < 0 || table_id >= STATIC_TABLE_COUNT) return TREE_ERROR;
+    if (!table_ready[table_id]) {
+        for (int i = 0; i < 256; i++) {
+            table_nodes[table_id][i] = construct_leaf(table_weights[table_id][i], (char)i);
+        }
+        sort_nodes(table_nodes[table_id], 256);
+        construct_tree(table_nodes[table_id], 256);
+        table_ready[table_id] = true;
+    }
+    *nodes = table_nodes[table_id];
+    *root_node = &table_nodes[table_id][510];
+    return 0;
+}
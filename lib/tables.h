@@ -0,0 +1,12 @@
+#ifndef TABLES_H
+#define TABLES_H
+
+#include "data_types.h"
+
+// A beepitett kodtablak szama; az azonosito a tag fejleceben, a fa helyen tarolodik.
+#define STATIC_TABLE_COUNT 3
+
+int find_static_table(const char *name);
+int get_static_tree(int table_id, Node **nodes, Node **root_node);
+
+#endif // TABLES_H
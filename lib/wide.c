@@ -0,0 +1,365 @@
+#include "wide.h"
+#include "data_types.h"
+#include "debugmalloc.h"
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Nagy (legfeljebb 65536 szimbolumos) abecek Huffman kodolasa, es erre epulve a 16 bites szimbolumok (bajtparok)
+ * kodolasa. Ekkora abecere a Node alapu fa nem alkalmas (a Node adata egy bajt, es a fa a fajlban is Node tombkent
+ * tarolodik), ezert itt a kod hosszait szamoljuk ki (Moffat-Katajainen helyben futo algoritmusaval),
+ * CANONICAL_LENGTH_MAX bitre korlatozzuk, es kanonikus kodot rendelunk hozzajuk: a kodtablahoz eleg a hasznalt
+ * szimbolumokat es a hosszaikat tarolni. A kodtabla a hasznalt szimbolumok szama (long), majd szimbolum szerint
+ * novekvo sorrendben bejegyzesenkent a szimbolum ket bajtja (kis-endian) es a kod hossza.
+ */
+
+#define CANONICAL_ENTRY_SIZE 3
+// A korlat nelkuli kodhossz felso becslese (2^31-nel kevesebb szimbolum eseten a Huffman fa ennel nem melyebb).
+#define WIDE_DEPTH_MAX 64
+
+typedef struct {
+    uint32_t frequency;
+    uint16_t symbol;
+} Wide_leaf;
+
+static int compare_leaves(const void *a, const void *b) {
+    const Wide_leaf *left = a;
+    const Wide_leaf *right = b;
+    if (left->frequency != right->frequency) return left->frequency < right->frequency ? -1 : 1;
+    return (int)left->symbol - (int)right->symbol;
+}
+
+static long symbol_count_of(long data_len) {
+    return (data_len + 1) / 2;
+}
+
+// Az i. szimbolum: kis-endian bajtpar, paratlan meretnel az utolso bajt egyedul.
+static unsigned int symbol_at(const char *data, long data_len, long i) {
+    unsigned int symbol = (unsigned char)data[2 * i];
+    if (2 * i + 1 < data_len) symbol |= (unsigned int)(unsigned char)data[2 * i + 1] << 8;
+    return symbol;
+}
+
+/*
+ * Moffat-Katajainen: a novekvo sorrendbe rendezett gyakorisagok helyere a Huffman kod hosszait irja (n >= 2).
+ */
+static void minimum_redundancy(long *a, long n) {
+    a[0] += a[1];
+    long root = 0;
+    long leaf = 2;
+    for (long next = 1; next < n - 1; next++) {
+        if (leaf >= n || a[root] < a[leaf]) {
+            a[next] = a[root];
+            a[root++] = next;
+        } else {
+            a[next] = a[leaf++];
+        }
+        if (leaf >= n || (root < next && a[root] < a[leaf])) {
+            a[next] += a[root];
+            a[root++] = next;
+        } else {
+            a[next] += a[leaf++];
+        }
+    }
+    a[n - 2] = 0;
+    for (long next = n - 3; next >= 0; next--) {
+        a[next] = a[a[next]] + 1;
+    }
+    long available = 1;
+    long used = 0;
+    long depth = 0;
+    root = n - 2;
+    long next = n - 1;
+    while (available > 0) {
+        while (root >= 0 && a[root] == depth) {
+            used++;
+            root--;
+        }
+        while (available > used) {
+            a[next--] = depth;
+            available--;
+        }
+        available = 2 * used;
+        depth++;
+        used = 0;
+    }
+}
+
+// A kodhosszakbol (a novekvo szimbolum sorrendben kiosztott) kanonikus kodszavakat szamol.
+static void assign_codes(Canonical_code *code) {
+    long length_counts[CANONICAL_LENGTH_MAX + 1] = {0};
+    for (long s = 0; s < code->alphabet_size; s++) {
+        length_counts[code->lengths[s]]++;
+    }
+    length_counts[0] = 0;
+    uint32_t next_code[CANONICAL_LENGTH_MAX + 1] = {0};
+    for (int length = 1; length <= CANONICAL_LENGTH_MAX; length++) {
+        next_code[length] = (uint32_t)((next_code[length - 1] + length_counts[length - 1]) << 1);
+    }
+    for (long s = 0; s < code->alphabet_size; s++) {
+        if (code->lengths[s] > 0) code->codes[s] = next_code[code->lengths[s]]++;
+    }
+}
+
+// Lefoglalja egy alphabet_size meretu abece (ures) kodjat. Siker eseten 0-t, kulonben MALLOC_ERROR-t ad vissza.
+int canonical_code_init(Canonical_code *code, long alphabet_size) {
+    code->alphabet_size = alphabet_size;
+    code->used_count = 0;
+    code->lengths = calloc(alphabet_size, sizeof(unsigned char));
+    code->codes = calloc(alphabet_size, sizeof(uint32_t));
+    if (code->lengths == NULL || code->codes == NULL) {
+        free_canonical_code(code);
+        return MALLOC_ERROR;
+    }
+    return 0;
+}
+
+void free_canonical_code(Canonical_code *code) {
+    free(code->lengths);
+    free(code->codes);
+    code->lengths = NULL;
+    code->codes = NULL;
+    code->used_count = 0;
+}
+
+/*
+ * A gyakorisagokbol (alphabet_size elem) felepiti a hosszkorlatos kanonikus kodot a code tombjeibe, a kodolt adat
+ * bitszamat a bits kimenetbe irja. Az ures abece kodja ures marad. Siker eseten 0-t, hiba eseten negativ kodot ad vissza.
+ */
+int build_canonical_code(const uint32_t *frequencies, Canonical_code *code, long *bits) {
+    *bits = 0;
+    memset(code->lengths, 0, code->alphabet_size);
+    long used = 0;
+    for (long s = 0; s < code->alphabet_size; s++) {
+        if (frequencies[s] > 0) used++;
+    }
+    code->used_count = used;
+    if (used == 0) return 0;
+    Wide_leaf *leaves = malloc(used * sizeof(Wide_leaf));
+    long *lengths = malloc(used * sizeof(long));
+    if (leaves == NULL || lengths == NULL) {
+        free(leaves);
+        free(lengths);
+        return MALLOC_ERROR;
+    }
+    used = 0;
+    for (long s = 0; s < code->alphabet_size; s++) {
+        if (frequencies[s] == 0) continue;
+        leaves[used].frequency = frequencies[s];
+        leaves[used].symbol = (uint16_t)s;
+        used++;
+    }
+    qsort(leaves, used, sizeof(Wide_leaf), compare_leaves);
+
+    /* Az egyetlen szimbolum is egy bites kodot kap, igy a dekodolonak nem kell kulon esetet kezelnie. */
+    long length_counts[WIDE_DEPTH_MAX + 1] = {0};
+    if (used == 1) {
+        length_counts[1] = 1;
+    } else {
+        for (long i = 0; i < used; i++) {
+            lengths[i] = leaves[i].frequency;
+        }
+        minimum_redundancy(lengths, used);
+        for (long i = 0; i < used; i++) {
+            length_counts[lengths[i]]++;
+        }
+    }
+    /* Hosszkorlatozas (JPEG K.3 szerint): a korlatnal melyebb levelparokat egy sekelyebb level ala koltoztetjuk. */
+    for (int length = WIDE_DEPTH_MAX; length > CANONICAL_LENGTH_MAX; length--) {
+        while (length_counts[length] > 0) {
+            int shallower = length - 2;
+            while (length_counts[shallower] == 0) shallower--;
+            length_counts[length] -= 2;
+            length_counts[length - 1] += 1;
+            length_counts[shallower + 1] += 2;
+            length_counts[shallower] -= 1;
+        }
+    }
+    /* A leghosszabb kodokat a legritkabb szimbolumok kapjak. */
+    long i = 0;
+    for (int length = CANONICAL_LENGTH_MAX; length >= 1; length--) {
+        for (long k = 0; k < length_counts[length]; k++, i++) {
+            code->lengths[leaves[i].symbol] = (unsigned char)length;
+            *bits += (long)leaves[i].frequency * length;
+        }
+    }
+    assign_codes(code);
+    free(leaves);
+    free(lengths);
+    return 0;
+}
+
+long canonical_table_size(const Canonical_code *code) {
+    return sizeof(long) + code->used_count * CANONICAL_ENTRY_SIZE;
+}
+
+// A canonical_table_size meretu out bufferbe irja a kodtablat.
+void write_canonical_table(const Canonical_code *code, unsigned char *out) {
+    memcpy(out, &code->used_count, sizeof(long));
+    unsigned char *entry = out + sizeof(long);
+    for (long s = 0; s < code->alphabet_size; s++) {
+        if (code->lengths[s] == 0) continue;
+        entry[0] = (unsigned char)(s & 0xff);
+        entry[1] = (unsigned char)(s >> 8);
+        entry[2] = code->lengths[s];
+        entry += CANONICAL_ENTRY_SIZE;
+    }
+}
+
+// A szimbolum kodszavat az out bitfolyam position bitjetol irja (az out elore nullazott es eleg nagy).
+void put_canonical(const Canonical_code *code, unsigned int symbol, unsigned char *out, long *position) {
+    uint32_t codeword = code->codes[symbol];
+    for (int b = code->lengths[symbol] - 1; b >= 0; b--, (*position)++) {
+        if (codeword & (1u << b)) out[*position / 8] |= (unsigned char)(1 << (7 - *position % 8));
+    }
+}
+
+void free_canonical_decoder(Canonical_decoder *decoder) {
+    free(decoder->sorted);
+    decoder->sorted = NULL;
+}
+
+/*
+ * Beolvassa a table elejen allo kodtablat egy alphabet_size meretu abecehez. A felhasznalt bajtok szamat adja vissza,
+ * serult tabla eseten DECOMPRESSION_ERROR-t. Az ures kodtabla is ervenyes, ekkor a dekodolo minden kodszot elutasit.
+ */
+long read_canonical_table(const char *table, long table_size, long alphabet_size, Canonical_decoder *decoder) {
+    memset(decoder, 0, sizeof(Canonical_decoder));
+    long used = 0;
+    if (table_size < (long)sizeof(long)) return DECOMPRESSION_ERROR;
+    memcpy(&used, table, sizeof(long));
+    if (used < 0 || used > alphabet_size || table_size < (long)sizeof(long) + used * CANONICAL_ENTRY_SIZE) return DECOMPRESSION_ERROR;
+    const unsigned char *entries = (const unsigned char*)table + sizeof(long);
+
+    long previous = -1;
+    for (long e = 0; e < used; e++) {
+        long symbol = entries[e * CANONICAL_ENTRY_SIZE] | (long)entries[e * CANONICAL_ENTRY_SIZE + 1] << 8;
+        int length = entries[e * CANONICAL_ENTRY_SIZE + 2];
+        if (symbol <= previous || symbol >= alphabet_size || length < 1 || length > CANONICAL_LENGTH_MAX) return DECOMPRESSION_ERROR;
+        decoder->length_counts[length]++;
+        previous = symbol;
+    }
+    /* A kod nem lehet tulfoglalt (a Kraft-osszeg legfeljebb 1). */
+    long left = 1;
+    for (int length = 1; length <= CANONICAL_LENGTH_MAX; length++) {
+        left = 2 * left - decoder->length_counts[length];
+        if (left < 0) return DECOMPRESSION_ERROR;
+    }
+
+    decoder->sorted = malloc((used > 0 ? used : 1) * sizeof(uint16_t));
+    if (decoder->sorted == NULL) return MALLOC_ERROR;
+    long offsets[CANONICAL_LENGTH_MAX + 1] = {0};
+    for (int length = 2; length <= CANONICAL_LENGTH_MAX; length++) {
+        offsets[length] = offsets[length - 1] + decoder->length_counts[length - 1];
+    }
+    for (long e = 0; e < used; e++) {
+        int length = entries[e * CANONICAL_ENTRY_SIZE + 2];
+        decoder->sorted[offsets[length]++] = (uint16_t)(entries[e * CANONICAL_ENTRY_SIZE] | entries[e * CANONICAL_ENTRY_SIZE + 1] << 8);
+    }
+    return sizeof(long) + used * CANONICAL_ENTRY_SIZE;
+}
+
+/*
+ * Egy szimbolumot dekodol: a kanonikus kodot hosszankent az elso kodszo es a kodszavak szama alapjan bitenkent
+ * olvassa. Serult adat eseten DECOMPRESSION_ERROR-t ad vissza.
+ */
+int decode_canonical(const Canonical_decoder *decoder, const unsigned char *in, long bit_count, long *position) {
+    long codeword = 0;
+    long first = 0;
+    long index = 0;
+    for (int length = 1; length <= CANONICAL_LENGTH_MAX && *position < bit_count; length++) {
+        codeword |= (in[*position / 8] >> (7 - *position % 8)) & 1;
+        (*position)++;
+        if (codeword - first < decoder->length_counts[length]) return decoder->sorted[index + codeword - first];
+        index += decoder->length_counts[length];
+        first = (first + decoder->length_counts[length]) << 1;
+        codeword <<= 1;
+    }
+    return DECOMPRESSION_ERROR;
+}
+
+/*
+ * Felepiti a blokk 16 bites szimbolumainak kodjat, es visszaadja a kodolt blokk becsult meretet bajtokban
+ * (a kodtablaval egyutt). Hiba eseten negativ kodot ad vissza.
+ */
+long wide_estimate(const char *data, long data_len, Canonical_code *code) {
+    if (canonical_code_init(code, WIDE_SYMBOLS) != 0) return MALLOC_ERROR;
+    uint32_t *frequencies = calloc(WIDE_SYMBOLS, sizeof(uint32_t));
+    if (frequencies == NULL) {
+        free_canonical_code(code);
+        return MALLOC_ERROR;
+    }
+    long symbol_count = symbol_count_of(data_len);
+    for (long i = 0; i < symbol_count; i++) {
+        frequencies[symbol_at(data, data_len, i)]++;
+    }
+    long bits = 0;
+    int res = build_canonical_code(frequencies, code, &bits);
+    free(frequencies);
+    if (res != 0) {
+        free_canonical_code(code);
+        return res;
+    }
+    return canonical_table_size(code) + (bits + 7) / 8;
+}
+
+/*
+ * A wide_estimate kodjaval kodolja a blokkot. A kodtablat a tree kimenetbe irja (a hivo szabaditja fel),
+ * a compressed_file fa es adat mezoit kitolti.
+ */
+int wide_encode(const char *data, long data_len, Canonical_code *code, Compressed_file *compressed_file, Node **tree) {
+    long symbol_count = symbol_count_of(data_len);
+    long bit_count = 0;
+    for (long i = 0; i < symbol_count; i++) {
+        bit_count += code->lengths[symbol_at(data, data_len, i)];
+    }
+    long tree_size = canonical_table_size(code);
+    unsigned char *table = malloc(tree_size);
+    unsigned char *out = calloc((bit_count + 7) / 8 + 1, sizeof(char));
+    if (table == NULL || out == NULL) {
+        free(table);
+        free(out);
+        return MALLOC_ERROR;
+    }
+    write_canonical_table(code, table);
+    long position = 0;
+    for (long i = 0; i < symbol_count; i++) {
+        put_canonical(code, symbol_at(data, data_len, i), out, &position);
+    }
+    compressed_file->compressed_data = (char*)out;
+    compressed_file->data_size = bit_count;
+    compressed_file->huffman_tree = (Node*)table;
+    compressed_file->tree_size = tree_size;
+    *tree = (Node*)table;
+    return 0;
+}
+
+/*
+ * A fa helyen allo kodtabla alapjan visszaallitja a blokk raw_size bajtjat. Serult adat eseten DECOMPRESSION_ERROR-t ad.
+ */
+int wide_decode(const char *tree, long tree_size, const unsigned char *in, long bit_count, char *raw, long raw_size) {
+    Canonical_decoder decoder;
+    long table_size = read_canonical_table(tree, tree_size, WIDE_SYMBOLS, &decoder);
+    if (table_size < 0) {
+        free_canonical_decoder(&decoder);
+        return (int)table_size;
+    }
+    int res = table_size == tree_size ? 0 : DECOMPRESSION_ERROR;
+    long position = 0;
+    long symbol_count = symbol_count_of(raw_size);
+    for (long i = 0; i < symbol_count && res == 0; i++) {
+        int symbol = decode_canonical(&decoder, in, bit_count, &position);
+        /* Paratlan meretnel az utolso szimbolum egyetlen bajt. */
+        if (symbol < 0 || (2 * i + 1 == raw_size && symbol > 0xff)) {
+            res = DECOMPRESSION_ERROR;
+            break;
+        }
+        raw[2 * i] = (char)(symbol & 0xff);
+        if (2 * i + 1 < raw_size) raw[2 * i + 1] = (char)(symbol >> 8);
+    }
+    free_canonical_decoder(&decoder);
+    if (res != 0) return res;
+    return position == bit_count ? 0 : DECOMPRESSION_ERROR;
+}
@@ -0,0 +1,22 @@
+#ifndef WIDE_H
+#define WIDE_H
+
+#include "data_types.h"
+
+// A 16 bites szimbolumok szama (egyben a kanonikus kodok legnagyobb abeceje).
+#define WIDE_SYMBOLS 65536
+
+int canonical_code_init(Canonical_code *code, long alphabet_size);
+int build_canonical_code(const uint32_t *frequencies, Canonical_code *code, long *bits);
+long canonical_table_size(const Canonical_code *code);
+void write_canonical_table(const Canonical_code *code, unsigned char *out);
+void put_canonical(const Canonical_code *code, unsigned int symbol, unsigned char *out, long *position);
+void free_canonical_code(Canonical_code *code);
+long read_canonical_table(const char *table, long table_size, long alphabet_size, Canonical_decoder *decoder);
+int decode_canonical(const Canonical_decoder *decoder, const unsigned char *in, long bit_count, long *position);
+void free_canonical_decoder(Canonical_decoder *decoder);
+long wide_estimate(const char *data, long data_len, Canonical_code *code);
+int wide_encode(const char *data, long data_len, Canonical_code *code, Compressed_file *compressed_file, Node **tree);
+int wide_decode(const char *tree, long tree_size, const unsigned char *in, long bit_count, char *raw, long raw_size);
+
+#endif // WIDE_H
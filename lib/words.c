@@ -0,0 +1,333 @@
+#include "words.h"
+#include "wide.h"
+#include "hash.h"
+#include "data_types.h"
+#include "debugmalloc.h"
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Szavas kodolas szoveghez es naplokhoz. A blokkot szavakra (betuk, szamjegyek, '_' es a nem ASCII bajtok
+ * sorozatai) es elvalasztokra (minden mas bajt sorozatai) bontjuk. A gyakori szavak a blokk szotaraba kerulnek, es
+ * egyetlen, az azonositojukra epitett kanonikus Huffman kodszot kapnak; a ritka szavakat a 0 (kikerulo) azonosito
+ * utan a hosszuk es a bajtjaik kodja irja le. A szotarat a blokk elso menete epiti (hash tablaval szamolva a szavakat).
+ */
+
+enum {
+    WORDS_TOKEN = 0,
+    WORDS_LENGTH = 1,
+    WORDS_BYTE = 2
+};
+
+static bool is_word_byte(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c >= 0x80;
+}
+
+// A position-on kezdodo szo (vagy elvalaszto) hossza.
+static long token_length(const char *data, long data_len, long position) {
+    bool word = is_word_byte((unsigned char)data[position]);
+    long length = 1;
+    while (position + length < data_len && length < WORDS_TOKEN_MAX
+            && is_word_byte((unsigned char)data[position + length]) == word) {
+        length++;
+    }
+    return length;
+}
+
+// A szo helye a hash tablaban: a megtalalt elem, vagy az ures hely, ahova be kell szurni.
+static long find_slot(const Words_model *model, const char *token, long size, uint64_t hash) {
+    long slot = hash & (model->table_size - 1);
+    while (model->table[slot].data != NULL) {
+        Word_entry *entry = &model->table[slot];
+        if (entry->hash == hash && entry->size == size && memcmp(entry->data, token, size) == 0) break;
+        slot = (slot + 1) & (model->table_size - 1);
+    }
+    return slot;
+}
+
+/*
+ * Megszamolja a blokk szavait. A tablat ketszeres meretre noveli, ha a toltottseg eleri a felet; a WORDS_TABLE_MAX
+ * meretu tabla megtelte utan az uj szavakat mar nem vesszuk fel (ezek kikerulovel kodolodnak).
+ * Siker eseten 0-t, hiba eseten MALLOC_ERROR-t ad vissza.
+ */
+static int count_tokens(const char *data, long data_len, Words_model *model) {
+    long distinct = 0;
+    model->table_size = 1024;
+    model->table = calloc(model->table_size, sizeof(Word_entry));
+    if (model->table == NULL) return MALLOC_ERROR;
+    for (long position = 0; position < data_len; ) {
+        long size = token_length(data, data_len, position);
+        if (2 * (distinct + 1) > model->table_size && model->table_size < WORDS_TABLE_MAX) {
+            long new_size = model->table_size * 2;
+            Word_entry *new_table = calloc(new_size, sizeof(Word_entry));
+            if (new_table == NULL) return MALLOC_ERROR;
+            for (long j = 0; j < model->table_size; j++) {
+                if (model->table[j].data == NULL) continue;
+                long slot = model->table[j].hash & (new_size - 1);
+                while (new_table[slot].data != NULL) slot = (slot + 1) & (new_size - 1);
+                new_table[slot] = model->table[j];
+            }
+            free(model->table);
+            model->table = new_table;
+            model->table_size = new_size;
+        }
+        uint64_t hash = hash_data(data + position, size);
+        long slot = find_slot(model, data + position, size, hash);
+        if (model->table[slot].data == NULL && 2 * (distinct + 1) <= model->table_size) {
+            model->table[slot] = (Word_entry){hash, data + position, size, 0, 0};
+            distinct++;
+        }
+        if (model->table[slot].data != NULL) model->table[slot].count++;
+        position += size;
+    }
+    return 0;
+}
+
+// Gyakorisag szerint csokkeno, azonos gyakorisagnal tablabeli hely szerinti sorrend (a kimenet igy determinisztikus).
+static int compare_ranks(const void *a, const void *b) {
+    const Word_rank *left = (const Word_rank*)a;
+    const Word_rank *right = (const Word_rank*)b;
+    if (left->count != right->count) return left->count > right->count ? -1 : 1;
+    return left->slot < right->slot ? -1 : 1;
+}
+
+// A legalabb WORDS_MIN_COUNT-szor elofordulo szavakbol gyakorisag szerint kiosztja a szotar azonositoit.
+static int build_vocabulary(Words_model *model) {
+    long candidates = 0;
+    for (long slot = 0; slot < model->table_size; slot++) {
+        if (model->table[slot].data != NULL && model->table[slot].count >= WORDS_MIN_COUNT) candidates++;
+    }
+    model->vocabulary = malloc((candidates > 0 ? candidates : 1) * sizeof(long));
+    Word_rank *ranks = malloc((candidates > 0 ? candidates : 1) * sizeof(Word_rank));
+    if (model->vocabulary == NULL || ranks == NULL) {
+        free(ranks);
+        return MALLOC_ERROR;
+    }
+    candidates = 0;
+    for (long slot = 0; slot < model->table_size; slot++) {
+        if (model->table[slot].data != NULL && model->table[slot].count >= WORDS_MIN_COUNT) {
+            ranks[candidates].count = model->table[slot].count;
+            ranks[candidates].slot = slot;
+            candidates++;
+        }
+    }
+    qsort(ranks, candidates, sizeof(Word_rank), compare_ranks);
+    for (long i = 0; i < candidates; i++) {
+        model->vocabulary[i] = ranks[i].slot;
+    }
+    free(ranks);
+    model->vocabulary_count = candidates < WORDS_VOCABULARY_MAX ? candidates : WORDS_VOCABULARY_MAX;
+    for (long id = 0; id < model->vocabulary_count; id++) {
+        model->table[model->vocabulary[id]].id = id + 1;
+    }
+    return 0;
+}
+
+/*
+ * A blokk szavait a szotar alapjan vegigjarja: out NULL eseten a harom abece gyakorisagait szamolja, kulonben
+ * a kodszavakat az out bitfolyamba irja.
+ */
+static void walk_tokens(const char *data, long data_len, const Words_model *model, uint32_t **frequencies, unsigned char *out) {
+    long position = 0;
+    long bit_position = 0;
+    while (position < data_len) {
+        long size = token_length(data, data_len, position);
+        const Word_entry *entry = &model->table[find_slot(model, data + position, size, hash_data(data + position, size))];
+        if (out == NULL) {
+            frequencies[WORDS_TOKEN][entry->id]++;
+        } else {
+            put_canonical(&model->codes[WORDS_TOKEN], (unsigned int)entry->id, out, &bit_position);
+        }
+        if (entry->id == 0) {
+            if (out == NULL) {
+                frequencies[WORDS_LENGTH][size]++;
+            } else {
+                put_canonical(&model->codes[WORDS_LENGTH], (unsigned int)size, out, &bit_position);
+            }
+            for (long i = 0; i < size; i++) {
+                unsigned char c = (unsigned char)data[position + i];
+                if (out == NULL) {
+                    frequencies[WORDS_BYTE][c]++;
+                } else {
+                    put_canonical(&model->codes[WORDS_BYTE], c, out, &bit_position);
+                }
+            }
+        }
+        position += size;
+    }
+}
+
+void words_free(Words_model *model) {
+    free(model->table);
+    free(model->vocabulary);
+    model->table = NULL;
+    model->vocabulary = NULL;
+    for (int a = 0; a < WORDS_ALPHABETS; a++) {
+        free_canonical_code(&model->codes[a]);
+    }
+}
+
+static long vocabulary_size(const Words_model *model) {
+    long size = sizeof(long);
+    for (long id = 0; id < model->vocabulary_count; id++) {
+        size += 1 + model->table[model->vocabulary[id]].size;
+    }
+    return size;
+}
+
+/*
+ * Felepiti a blokk szotarat es kodjait, es visszaadja a kodolt blokk becsult meretet bajtokban (a szotarral es a
+ * kodtablakkal egyutt). Hiba eseten negativ kodot ad vissza.
+ */
+long words_estimate(const char *data, long data_len, Words_model *model) {
+    memset(model, 0, sizeof(Words_model));
+    uint32_t *frequencies[WORDS_ALPHABETS] = {NULL};
+    long res = count_tokens(data, data_len, model);
+    while (res == 0) {
+        res = build_vocabulary(model);
+        if (res != 0) break;
+        long alphabet_sizes[WORDS_ALPHABETS] = {model->vocabulary_count + 1, WORDS_TOKEN_MAX + 1, 256};
+        for (int a = 0; a < WORDS_ALPHABETS && res == 0; a++) {
+            frequencies[a] = calloc(alphabet_sizes[a], sizeof(uint32_t));
+            if (frequencies[a] == NULL || canonical_code_init(&model->codes[a], alphabet_sizes[a]) != 0) res = MALLOC_ERROR;
+        }
+        if (res != 0) break;
+        walk_tokens(data, data_len, model, frequencies, NULL);
+        long size = vocabulary_size(model);
+        for (int a = 0; a < WORDS_ALPHABETS && res == 0; a++) {
+            long bits = 0;
+            res = build_canonical_code(frequencies[a], &model->codes[a], &bits);
+            model->bits += bits;
+            size += canonical_table_size(&model->codes[a]);
+        }
+        if (res == 0) res = size + (model->bits + 7) / 8;
+        break;
+    }
+    for (int a = 0; a < WORDS_ALPHABETS; a++) {
+        free(frequencies[a]);
+    }
+    if (res < 0) words_free(model);
+    return res;
+}
+
+/*
+ * A words_estimate szotaraval es kodjaival kodolja a blokkot. A szotarat es a kodtablakat a tree kimenetbe irja
+ * (a hivo szabaditja fel), a compressed_file fa es adat mezoit kitolti.
+ */
+int words_encode(const char *data, long data_len, Words_model *model, Compressed_file *compressed_file, Node **tree) {
+    long tree_size = vocabulary_size(model);
+    for (int a = 0; a < WORDS_ALPHABETS; a++) {
+        tree_size += canonical_table_size(&model->codes[a]);
+    }
+    unsigned char *table = malloc(tree_size);
+    unsigned char *out = calloc((model->bits + 7) / 8 + 1, sizeof(char));
+    if (table == NULL || out == NULL) {
+        free(table);
+        free(out);
+        return MALLOC_ERROR;
+    }
+    memcpy(table, &model->vocabulary_count, sizeof(long));
+    unsigned char *current = table + sizeof(long);
+    for (long id = 0; id < model->vocabulary_count; id++) {
+        const Word_entry *entry = &model->table[model->vocabulary[id]];
+        *current++ = (unsigned char)entry->size;
+        memcpy(current, entry->data, entry->size);
+        current += entry->size;
+    }
+    for (int a = 0; a < WORDS_ALPHABETS; a++) {
+        write_canonical_table(&model->codes[a], current);
+        current += canonical_table_size(&model->codes[a]);
+    }
+    walk_tokens(data, data_len, model, NULL, out);
+
+    compressed_file->compressed_data = (char*)out;
+    compressed_file->data_size = model->bits;
+    compressed_file->huffman_tree = (Node*)table;
+    compressed_file->tree_size = tree_size;
+    *tree = (Node*)table;
+    return 0;
+}
+
+/*
+ * A fa helyen allo szotar es kodtablak alapjan visszaallitja a blokk raw_size bajtjat.
+ * Serult adat eseten DECOMPRESSION_ERROR-t ad.
+ */
+int words_decode(const char *tree, long tree_size, const unsigned char *in, long bit_count, char *raw, long raw_size) {
+    long vocabulary_count = 0;
+    if (tree_size < (long)sizeof(long)) return DECOMPRESSION_ERROR;
+    memcpy(&vocabulary_count, tree, sizeof(long));
+    if (vocabulary_count < 0 || vocabulary_count > WORDS_VOCABULARY_MAX) return DECOMPRESSION_ERROR;
+
+    Canonical_decoder decoders[WORDS_ALPHABETS] = {{{0}}};
+    const unsigned char **words = malloc((vocabulary_count > 0 ? vocabulary_count : 1) * sizeof(unsigned char*));
+    if (words == NULL) return MALLOC_ERROR;
+    int res = 0;
+    while (true) {
+        long offset = sizeof(long);
+        for (long id = 0; id < vocabulary_count && res == 0; id++) {
+            if (offset >= tree_size || offset + 1 + (unsigned char)tree[offset] > tree_size) {
+                res = DECOMPRESSION_ERROR;
+                break;
+            }
+            words[id] = (const unsigned char*)tree + offset;
+            offset += 1 + (unsigned char)tree[offset];
+        }
+        if (res != 0) break;
+        long alphabet_sizes[WORDS_ALPHABETS] = {vocabulary_count + 1, WORDS_TOKEN_MAX + 1, 256};
+        for (int a = 0; a < WORDS_ALPHABETS; a++) {
+            long table_size = read_canonical_table(tree + offset, tree_size - offset, alphabet_sizes[a], &decoders[a]);
+            if (table_size < 0) {
+                res = (int)table_size;
+                break;
+            }
+            offset += table_size;
+        }
+        if (res != 0 || offset != tree_size) {
+            res = DECOMPRESSION_ERROR;
+            break;
+        }
+
+        long position = 0;
+        long written = 0;
+        while (written < raw_size) {
+            int id = decode_canonical(&decoders[WORDS_TOKEN], in, bit_count, &position);
+            if (id < 0) {
+                res = DECOMPRESSION_ERROR;
+                break;
+            }
+            if (id > 0) {
+                const unsigned char *word = words[id - 1];
+                if (word[0] > raw_size - written) {
+                    res = DECOMPRESSION_ERROR;
+                    break;
+                }
+                memcpy(raw + written, word + 1, word[0]);
+                written += word[0];
+                continue;
+            }
+            int size = decode_canonical(&decoders[WORDS_LENGTH], in, bit_count, &position);
+            if (size <= 0 || size > raw_size - written) {
+                res = DECOMPRESSION_ERROR;
+                break;
+            }
+            for (int i = 0; i < size; i++) {
+                int c = decode_canonical(&decoders[WORDS_BYTE], in, bit_count, &position);
+                if (c < 0) {
+                    res = DECOMPRESSION_ERROR;
+                    break;
+                }
+                raw[written++] = (char)c;
+            }
+            if (res != 0) break;
+        }
+        if (res == 0 && position != bit_count) res = DECOMPRESSION_ERROR;
+        break;
+    }
+    for (int a = 0; a < WORDS_ALPHABETS; a++) {
+        free_canonical_decoder(&decoders[a]);
+    }
+    free(words);
+    return res;
+}
@@ -0,0 +1,19 @@
+#ifndef WORDS_H
+#define WORDS_H
+
+#include "data_types.h"
+
+// Egy szo (vagy elvalaszto) legfeljebb ennyi bajt, a hosszabb sorozatokat tobb szora bontjuk.
+#define WORDS_TOKEN_MAX 255
+// A szotarba legfeljebb ennyi szo kerul (a 0 azonosito a kikerulo), es csak a legalabb WORDS_MIN_COUNT-szor elofordulok.
+#define WORDS_VOCABULARY_MAX 65535
+#define WORDS_MIN_COUNT 2
+// A szavakat szamolo hash tabla legnagyobb merete (elemszam), hogy egy foglalas 1 MB alatt maradjon.
+#define WORDS_TABLE_MAX 16384
+
+long words_estimate(const char *data, long data_len, Words_model *model);
+int words_encode(const char *data, long data_len, Words_model *model, Compressed_file *compressed_file, Node **tree);
+void words_free(Words_model *model);
+int words_decode(const char *tree, long tree_size, const unsigned char *in, long bit_count, char *raw, long raw_size);
+
+#endif // WORDS_H
@@ -9,6 +9,10 @@
 #include "../lib/compress.h"
 #include "../lib/decompress.h"
 #include "../lib/directory.h"
+#include "../lib/tables.h"
+#include "../lib/dictionary.h"
+#include "../lib/lz.h"
+#include "../lib/filter.h"
 #include "../lib/data_types.h"
 #include "../lib/debugmalloc.h"
 
@@ -20,38 +24,155 @@ static void print_usage(const char *prog_name) {
     const char *usage =
         "Huffman kodolo\n"
         "Hasznalat: %s -c|-x [-o KIMENETI_FAJL] BEMENETI_FAJL\n"
+        "           %s -A ARCHIVUM BEMENETI_FAJL...\n"
+        "           %s --train KORPUSZ -o SZOTAR\n"
         "\n"
         "Opciok:\n"
         "\t-c                        Tomorites\n"
         "\t-x                        Kitomorites\n"
+        "\t-A ARCHIVUM               A megadott fajlokat es mappakat egy meglevo mappa archivum vegere fuzi.\n"
         "\t-o KIMENETI_FAJL          Kimeneti fajl megadasa (opcionalis).\n"
         "\t-h                        Kiirja ezt az utmutatot.\n"
         "\t-f                        Ha letezik a KIMENETI_FAJL, kerdes nelkul felulirja.\n"
         "\t-r                        Rekurzivan egy megadott mappat tomorit (csak tomoriteskor szukseges).\n"
         "\t-P, --no-preserve-perms   Kitomoriteskor a tarolt jogosultsagokat alkalmazza a letrehozott mappakra is.\n"
-        "\tBEMENETI_FAJL: A tomoritendo vagy visszaallitando fajl utvonala.\n"
-        "\tA -c es -x kapcsolok kizarjak egymast.";
+        "\t--chunk                   Mappa tomoritesekor a fajlokon atnyulo ismetlodo darabokat csak egyszer tarolja.\n"
+        "\t--incremental-from ALAP   Mappa tomoritesekor csak az ALAP archivum ota valtozott fajlokat tarolja.\n"
+        "\t--sync                    Mappa kitomoritesekor csak az eltero meretu vagy tartalmu fajlokat irja ujra.\n"
+        "\t--adaptive                Egymenetes adaptiv Huffman tomorites, a fa nem kerul a fajlba.\n"
+        "\t--context                 Rendu-1 kontextusos kodolast is merlegel (az elozo bajt osztalya szerinti fakkal).\n"
+        "\t--ans                     A Huffman kod mellett a tablas ANS (tANS) kodolast is merlegeli.\n"
+        "\t--lz[=ABLAK]              LZ77 elofeldolgozast is merlegel (az ABLAK 2 hatvanya 1024 es 131072 kozott,\n"
+        "\t                          alapertelmezetten 32768 bajt); a szekvenciakat Huffman koddal kodolja.\n"
+        "\t--bwt                     Burrows-Wheeler transzformaciot is merlegel (MTF es nullafutas-kodolassal, lassabb).\n"
+        "\t--wide                    16 bites szimbolumokkal (bajtparokkal) valo kodolast is merlegel (UTF-16, 16 bites mintak).\n"
+        "\t--words                   Szavas kodolast is merlegel (blokkonkenti szotarral, szoveghez es naplokhoz).\n"
+        "\t--shuffle=N               N bajtos rekordok bajtsikjait kulon kodolja (rogzitett szelessegu binaris adathoz).\n"
+        "\t--columnar                Tagolt (CSV, TSV) rekordok oszlopait kulon kodolja (az elvalasztot felismeri).\n"
+        "\t--numeric                 Blokkonkent delta (egesz) vagy XOR (lebegopontos) elorejelzest is merlegel.\n"
+        "\t--fast                    A fat az adat kb. 1%%-os mintajabol epiti, kulon szamlalo menet nelkul.\n"
+        "\t--table=NEV               Szamlalas es tarolt fa nelkul a beepitett kodtablaval tomorit (text, json, x86).\n"
+        "\t                          Enelkul is a beepitett tablat hasznalja, ahol az kisebb kimenetet ad.\n"
+        "\t--no-tables               A beepitett kodtablakat nem ajanlja fel, minden blokk sajat fat kap.\n"
+        "\t--train KORPUSZ           A KORPUSZ mappa (vagy fajl) bajtgyakorisagaibol kozos kodtablat (szotarat) ir az -o fajlba.\n"
+        "\t--dict SZOTAR             Tomoriteskor a szotarral kodol, a fajlba csak a szotar hash-e kerul fa helyett;\n"
+        "\t                          kitomoriteskor ugyanezt a szotarat kell megadni.\n"
+        "\tBEMENETI_FAJL: A tomoritendo vagy visszaallitando fajl utvonala, adaptiv tomoriteskor\n"
+        "\t               a \"-\" a szabvanyos bemenetet jelenti (ilyenkor az -o kotelezo).\n"
+        "\tA -c, -x, -A es --train kapcsolok kizarjak egymast.";
 
-    printf(usage, prog_name);
+    printf(usage, prog_name, prog_name, prog_name);
 }
 
 /* 
  * Parancssori opciok feldolgozasa: egy mod valaszthato, az -o a kimenetet, az -f a felulirast kezeli.
- * Az elso nem kapcsolos argumentum lesz a bemeneti fajl.
+ * Az elso nem kapcsolos argumentum lesz a bemeneti fajl. Hozzafuzes (-A) modban tobb bemenet is megadhato,
+ * ezeket a hivo altal adott (legalabb argc elemu) input_files tombbe gyujtjuk, az argv valtozatlan marad.
  */
-int parse_arguments(int argc, char* argv[], Arguments *args) {
+int parse_arguments(int argc, char* argv[], Arguments *args, char **input_files) {
     args->compress_mode = false;
     args->extract_mode = false;
     args->force = false;
     args->directory = false;
     args->no_preserve_perms = false;
+    args->chunk_dedup = false;
+    args->sync = false;
+    args->adaptive = false;
+    args->fast = false;
+    args->context = false;
+    args->ans = false;
+    args->lz_window = 0;
+    args->bwt = false;
+    args->wide = false;
+    args->words = false;
+    args->shuffle = 0;
+    args->columnar = false;
+    args->numeric = false;
+    args->table = NULL;
+    args->no_tables = false;
+    args->train = false;
+    args->dict = NULL;
+    args->incremental_from = NULL;
+    args->append_archive = NULL;
+    args->input_files = NULL;
+    args->input_count = 0;
     args->input_file = NULL;
     args->output_file = NULL;
 
     for (int i = 1; i < argc; i++) {
-        if (argv[i][0] == '-') {
+        /* Az onmagaban allo "-" a szabvanyos bemenetet jeloli, ez bemeneti fajlnak szamit. */
+        if (argv[i][0] == '-' && argv[i][1] != '\0') {
             if (strcmp(argv[i], "--no-preserve-perms") == 0) {
                 args->no_preserve_perms = true;
+            } else if (strcmp(argv[i], "--chunk") == 0) {
+                args->chunk_dedup = true;
+            } else if (strcmp(argv[i], "--sync") == 0) {
+                args->sync = true;
+            } else if (strcmp(argv[i], "--adaptive") == 0) {
+                args->adaptive = true;
+            } else if (strcmp(argv[i], "--context") == 0) {
+                args->context = true;
+            } else if (strcmp(argv[i], "--ans") == 0) {
+                args->ans = true;
+            } else if (strcmp(argv[i], "--lz") == 0) {
+                args->lz_window = LZ_WINDOW_DEFAULT;
+            } else if (strncmp(argv[i], "--lz=", 5) == 0) {
+                char *end = NULL;
+                long window = strtol(argv[i] + 5, &end, 10);
+                if (*end != '\0' || window < LZ_WINDOW_MIN || window > LZ_WINDOW_MAX || (window & (window - 1)) != 0) {
+                    printf("Ervenytelen LZ77 ablakmeret: %s (2 hatvanya %d es %d kozott).\n", argv[i] + 5, LZ_WINDOW_MIN, LZ_WINDOW_MAX);
+                    print_usage(argv[0]);
+                    return EINVAL;
+                }
+                args->lz_window = (int)window;
+            } else if (strcmp(argv[i], "--bwt") == 0) {
+                args->bwt = true;
+            } else if (strncmp(argv[i], "--shuffle=", 10) == 0) {
+                char *end = NULL;
+                long width = strtol(argv[i] + 10, &end, 10);
+                if (*end != '\0' || width < 2 || width > SHUFFLE_WIDTH_MAX) {
+                    printf("Ervenytelen rekordmeret: %s (2 es %d kozott).\n", argv[i] + 10, SHUFFLE_WIDTH_MAX);
+                    print_usage(argv[0]);
+                    return EINVAL;
+                }
+                args->shuffle = (int)width;
+            } else if (strcmp(argv[i], "--columnar") == 0) {
+                args->columnar = true;
+            } else if (strcmp(argv[i], "--wide") == 0) {
+                args->wide = true;
+            } else if (strcmp(argv[i], "--words") == 0) {
+                args->words = true;
+            } else if (strcmp(argv[i], "--numeric") == 0) {
+                args->numeric = true;
+            } else if (strcmp(argv[i], "--fast") == 0) {
+                args->fast = true;
+            } else if (strncmp(argv[i], "--table=", 8) == 0) {
+                args->table = argv[i] + 8;
+                if (find_static_table(args->table) < 0) {
+                    printf("Ismeretlen kodtabla: %s (text, json vagy x86 lehet).\n", args->table);
+                    print_usage(argv[0]);
+                    return EINVAL;
+                }
+            } else if (strcmp(argv[i], "--no-tables") == 0) {
+                args->no_tables = true;
+            } else if (strcmp(argv[i], "--train") == 0) {
+                args->train = true;
+            } else if (strcmp(argv[i], "--dict") == 0) {
+                if (++i < argc) {
+                    args->dict = argv[i];
+                } else {
+                    printf("A --dict kapcsolo utan add meg a szotarfajlt.\n");
+                    print_usage(argv[0]);
+                    return EINVAL;
+                }
+            } else if (strcmp(argv[i], "--incremental-from") == 0) {
+                if (++i < argc) {
+                    args->incremental_from = argv[i];
+                } else {
+                    printf("A --incremental-from kapcsolo utan add meg az alap archivumot.\n");
+                    print_usage(argv[0]);
+                    return EINVAL;
+                }
             } else {
                 switch (argv[i][1]) {
                     case 'h':
@@ -63,6 +184,15 @@ int parse_arguments(int argc, char* argv[], Arguments *args) {
                     case 'x':
                         args->extract_mode = true;
                         break;
+                    case 'A':
+                        if (++i < argc) {
+                            args->append_archive = argv[i];
+                        } else {
+                            printf("Az -A kapcsolo utan add meg az archivumot.\n");
+                            print_usage(argv[0]);
+                            return EINVAL;
+                        }
+                        break;
                     case 'f':
                         args->force = true;
                         break;
@@ -88,15 +218,16 @@ int parse_arguments(int argc, char* argv[], Arguments *args) {
                 }
             }
         } else {
-            if (args->input_file == NULL) {
-                args->input_file = argv[i];
-            } else {
-                printf("Tobb bemeneti fajl lett megadva.\n");
-                print_usage(argv[0]);
-                return EINVAL;
-            }
+            input_files[args->input_count++] = argv[i];
         }
     }
+    args->input_files = input_files;
+    if (args->input_count > 0) args->input_file = input_files[0];
+    if (args->input_count > 1 && args->append_archive == NULL) {
+        printf("Tobb bemeneti fajl lett megadva.\n");
+        print_usage(argv[0]);
+        return EINVAL;
+    }
 
     /*
      * Ellenorizzuk, hogy megadtak-e a bemeneti fajlt, majd leellenorizzuk, hogy letezik-e.
@@ -108,15 +239,17 @@ int parse_arguments(int argc, char* argv[], Arguments *args) {
         return EINVAL;
     }
     
-    struct stat st;
-    if (stat(args->input_file, &st) != 0) {
-        printf("A (%s) fajl nem talalhato.\n", args->input_file);
-        print_usage(argv[0]);
-        return FILE_READ_ERROR;
+    for (int i = 0; i < args->input_count; i++) {
+        struct stat st;
+        if (strcmp(args->input_files[i], "-") != 0 && stat(args->input_files[i], &st) != 0) {
+            printf("A (%s) fajl nem talalhato.\n", args->input_files[i]);
+            print_usage(argv[0]);
+            return FILE_READ_ERROR;
+        }
     }
 
-    if (args->compress_mode && args->extract_mode) {
-        printf("A -c es -x kapcsolok kizarjak egymast.\n");
+    if (args->compress_mode + args->extract_mode + (args->append_archive != NULL) + args->train > 1) {
+        printf("A -c, -x, -A es --train kapcsolok kizarjak egymast.\n");
         print_usage(argv[0]);
         return EINVAL;
     }
@@ -126,10 +259,11 @@ int parse_arguments(int argc, char* argv[], Arguments *args) {
 
 /*
  * A kapcsolokat feldolgozva elinditja a tomorites vagy kitomorites folyamatat, es a hibakodot adja vissza.
+ * A bemeneti fajlok listaja az input_files tombbe kerul.
  */
-int main(int argc, char* argv[]){
+static int run(int argc, char* argv[], char **input_files) {
     Arguments args;
-    int parse_result = parse_arguments(argc, argv, &args);
+    int parse_result = parse_arguments(argc, argv, &args, input_files);
     if (parse_result == HELP_REQUESTED) {
         return SUCCESS;
     }
@@ -140,6 +274,50 @@ int main(int argc, char* argv[]){
         return parse_result;
     }
 
+    if (args.dict != NULL && (args.table != NULL || args.adaptive)) {
+        printf("A --dict nem hasznalhato egyutt a --table es az --adaptive kapcsolokkal.\n");
+        return EINVAL;
+    }
+
+    if (args.shuffle > 0 && (args.directory || args.adaptive || args.append_archive != NULL)) {
+        printf("A --shuffle csak egyetlen fajl (nem adaptiv) tomoritesekor hasznalhato.\n");
+        return EINVAL;
+    }
+
+    if (args.columnar && (args.directory || args.adaptive || args.append_archive != NULL)) {
+        printf("A --columnar csak egyetlen fajl (nem adaptiv) tomoritesekor hasznalhato.\n");
+        return EINVAL;
+    }
+
+    if (args.shuffle > 0 && args.columnar) {
+        printf("A --shuffle es a --columnar kapcsolok kizarjak egymast.\n");
+        return EINVAL;
+    }
+
+    if (args.shuffle > 0 && args.numeric) {
+        printf("A --shuffle es a --numeric kapcsolok kizarjak egymast.\n");
+        return EINVAL;
+    }
+
+    /* A tanitas a korpusz mappat vagy fajlt csak olvassa, a kimenet a szotarfajl. */
+    if (args.train) {
+        return run_training(args);
+    }
+
+    /* Az adaptiv mod folyamkent olvassa a bemenetet, ezert a fajl tipusat sem vizsgaljuk elore. */
+    if (args.compress_mode && args.adaptive) {
+        if (args.directory) {
+            printf("Az --adaptive mod csak egyetlen fajlt vagy a szabvanyos bemenetet tomoriti.\n");
+            return EINVAL;
+        }
+        return run_adaptive_compression(args);
+    }
+
+    /* Hozzafuzeskor a bemenetek fajlok es mappak is lehetnek, a cel archivumnak mar leteznie kell. */
+    if (args.append_archive != NULL) {
+        return run_append(args);
+    }
+
     /* Ellenorizzuk, hogy az -r valoban mappat jelol, vagy hibasan lett megadva. */
     if (args.directory) {
         struct stat st;
@@ -165,33 +343,48 @@ int main(int argc, char* argv[]){
     }
     
     if (args.compress_mode) {
-        char *data = NULL;
-        long data_len = 0;
-        long directory_size = 0;
-        int directory_size_int = 0;
-
         if (args.directory) {
-            int prep_res = prepare_directory(args.input_file, &data, &directory_size_int);
+            /* A mappa fejlecei es fajltartalmai kulon szeletekkent, masolas nelkul jutnak el a kodoloig. */
+            Directory_stream stream;
+            long directory_size = 0;
+            long prep_res = prepare_directory_stream(args, &stream, &directory_size);
             if (prep_res < 0) {
                 return prep_res;
             }
-            data_len = prep_res;
-            directory_size = directory_size_int;
-        } else {
-            int read_res = read_raw(args.input_file, &data);
-            if (read_res < 0) {
-                if (read_res == EMPTY_FILE) {
-                    printf("A fajl (%s) ures.\n", args.input_file);
-                } else {
-                    printf("Nem sikerult megnyitni a fajlt (%s).\n", args.input_file);
+            /* A kimeneti nevet itt allitjuk elo, mert a tomoritett adat utan meg az indexet is hozza kell fuzni. */
+            bool output_generated = false;
+            if (args.output_file == NULL) {
+                args.output_file = generate_output_file(args.input_file);
+                if (args.output_file == NULL) {
+                    printf("Nem sikerult lefoglalni a memoriat.\n");
+                    free_directory_stream(&stream);
+                    return ENOMEM;
                 }
-                return read_res;
+                output_generated = true;
+            }
+            int compress_res = run_compression_segments(args, stream.segments, stream.segment_count, directory_size);
+            if (compress_res == SUCCESS && write_archive_index(args.output_file, NULL, stream.archive, stream.archive_size) != SUCCESS) {
+                printf("Nem sikerult kiirni az archivum indexet (%s).\n", args.output_file);
+                compress_res = EIO;
             }
-            data_len = read_res;
-            directory_size = data_len;
+            free_directory_stream(&stream);
+            if (output_generated) free(args.output_file);
+            return compress_res;
         }
 
-        int compress_res = run_compression(args, data, data_len, directory_size);
+        char *data = NULL;
+        long read_res = read_raw(args.input_file, &data);
+        if (read_res < 0) {
+            if (read_res == EMPTY_FILE) {
+                printf("A fajl (%s) ures.\n", args.input_file);
+            } else {
+                printf("Nem sikerult megnyitni a fajlt (%s).\n", args.input_file);
+            }
+            return read_res;
+        }
+        long data_len = read_res;
+
+        int compress_res = run_compression(args, data, data_len, data_len);
         free(data);
         return compress_res;
     } else if (args.extract_mode) {
@@ -209,10 +402,10 @@ int main(int argc, char* argv[]){
 
         int res = 0;
         if (is_dir) {
-            res = restore_directory(raw_data, args.output_file, args.force, args.no_preserve_perms);
+            res = restore_directory(raw_data, raw_size, args.output_file, args.force, args.no_preserve_perms, args.sync);
         } else {
             char *target = args.output_file != NULL ? args.output_file : original_name;
-            int write_res = write_raw(target, raw_data, raw_size, args.force);
+            long write_res = write_raw(target, raw_data, raw_size, args.force);
             if (write_res < 0) {
                 printf("Hiba tortent a kimeneti fajl (%s) irasa kozben.\n", target);
                 res = EIO;
@@ -229,3 +422,17 @@ int main(int argc, char* argv[]){
         return EINVAL;
     }
 }
+
+/*
+ * Lefoglalja a bemeneti fajlok listajat, lefuttatja a programot, majd a hibakodot adja vissza.
+ */
+int main(int argc, char* argv[]){
+    char **input_files = malloc(argc * sizeof(char*));
+    if (input_files == NULL) {
+        printf("Nem sikerult lefoglalni a memoriat.\n");
+        return ENOMEM;
+    }
+    int res = run(argc, argv, input_files);
+    free(input_files);
+    return res;
+}
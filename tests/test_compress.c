@@ -66,15 +66,13 @@ static int invoke_run_compression(Arguments args) {
     long directory_size = 0;
 
     if (args.directory) {
-        int directory_size_int = 0;
-        int prep_res = prepare_directory(args.input_file, &data, &directory_size_int);
+        long prep_res = prepare_directory(args.input_file, &data, &directory_size);
         if (prep_res < 0) {
             return prep_res;
         }
         data_len = prep_res;
-        directory_size = directory_size_int;
     } else {
-        int read_res = read_raw(args.input_file, &data);
+        long read_res = read_raw(args.input_file, &data);
         if (read_res < 0) {
             return read_res;
         }
@@ -163,6 +161,42 @@ static void test_compress_zero_length(void) {
     free_cache(cache);
 }
 
+static void test_compress_segments_matches_contiguous(void) {
+    const char *input = "header|file contents|header2|more data";
+    const long len = (long)strlen(input);
+
+    Node *nodes = NULL;
+    Node *root = NULL;
+    build_huffman_tree(input, len, &nodes, &root);
+
+    char **cache = calloc(256, sizeof(char *));
+    assert(cache != NULL);
+
+    Compressed_file contiguous = {0};
+    assert(compress((char *)input, len, nodes, root, cache, &contiguous) == 0);
+
+    Data_segment segments[3] = {
+        {(char *)input, 7},
+        {(char *)input + 7, 14},
+        {(char *)input + 21, len - 21}
+    };
+    long frequencies[256] = {0};
+    long expected[256] = {0};
+    count_segment_frequencies(segments, 3, frequencies);
+    count_frequencies((char *)input, len, expected);
+    assert(memcmp(frequencies, expected, sizeof(expected)) == 0);
+
+    Compressed_file segmented = {0};
+    assert(compress_segments(segments, 3, nodes, root, cache, &segmented) == 0);
+    assert(segmented.data_size == contiguous.data_size);
+    assert(memcmp(segmented.compressed_data, contiguous.compressed_data, (contiguous.data_size + 7) / 8) == 0);
+
+    free(contiguous.compressed_data);
+    free(segmented.compressed_data);
+    free_cache(cache);
+    free(nodes);
+}
+
 /* ===== Tests for run_compression function ===== */
 
 static void test_run_compression_basic_file(void) {
@@ -684,6 +718,7 @@ static void test_run_compression_single_byte_file(void) {
 int main(void) {
     test_compress_basic_pattern();
     test_compress_zero_length();
+    test_compress_segments_matches_contiguous();
     
     // run_compression tests
     test_run_compression_basic_file();
@@ -11,6 +11,14 @@
 #include "../lib/data_types.h"
 #include "../lib/debugmalloc.h"
 #include "../lib/directory.h"
+#include "../lib/adaptive.h"
+#include "../lib/tables.h"
+#include "../lib/dictionary.h"
+#include "../lib/ans.h"
+#include "../lib/lz.h"
+#include "../lib/bwt.h"
+#include "../lib/wide.h"
+#include "../lib/filter.h"
 
 static int invoke_run_compression(Arguments args) {
     char *data = NULL;
@@ -18,15 +26,13 @@ static int invoke_run_compression(Arguments args) {
     long directory_size = 0;
 
     if (args.directory) {
-        int directory_size_int = 0;
-        int prep_res = prepare_directory(args.input_file, &data, &directory_size_int);
+        long prep_res = prepare_directory(args.input_file, &data, &directory_size);
         if (prep_res < 0) {
             return prep_res;
         }
         data_len = prep_res;
-        directory_size = directory_size_int;
     } else {
-        int read_res = read_raw(args.input_file, &data);
+        long read_res = read_raw(args.input_file, &data);
         if (read_res < 0) {
             return read_res;
         }
@@ -53,7 +59,7 @@ static int invoke_run_decompression(Arguments args) {
     }
 
     if (is_dir) {
-        res = restore_directory(raw_data, args.output_file, args.force, args.no_preserve_perms);
+        res = restore_directory(raw_data, raw_size, args.output_file, args.force, args.no_preserve_perms, args.sync);
     } else {
         char *target = args.output_file != NULL ? args.output_file : original_name;
         int write_res = write_raw(target, raw_data, raw_size, args.force);
@@ -68,6 +74,55 @@ static int invoke_run_decompression(Arguments args) {
     return res;
 }
 
+/*
+ * Az args beallitasaival (tomorito modban, felulirassal) az args.output_file-ba tomoriti a szeleteket, majd kibontja,
+ * es ellenorzi, hogy a szeletek osszefuzott tartalmat kapja vissza. A first_block-ba az elso blokk fejlecmezoit
+ * (tipus, szuro, meretek) irja, a pointereit felszabaditja. A tomoritett fajl meretet adja vissza.
+ */
+static long roundtrip_with_args(Arguments args, Data_segment *segments, int segment_count, Compressed_file *first_block) {
+    long data_len = 0;
+    for (int i = 0; i < segment_count; i++) {
+        data_len += segments[i].size;
+    }
+    args.compress_mode = true;
+    args.force = true;
+    assert(run_compression_segments(args, segments, segment_count, data_len) == 0);
+
+    FILE *f = fopen(args.output_file, "rb");
+    assert(f != NULL);
+    long compressed_size = get_file_size(f);
+    fclose(f);
+
+    assert(read_compressed(args.output_file, first_block) == 0);
+    free(first_block->file_name);
+    free(first_block->original_file);
+    free(first_block->huffman_tree);
+    free(first_block->compressed_data);
+    first_block->file_name = NULL;
+    first_block->original_file = NULL;
+    first_block->huffman_tree = NULL;
+    first_block->compressed_data = NULL;
+
+    Arguments decomp_args = {0};
+    decomp_args.extract_mode = true;
+    decomp_args.input_file = args.output_file;
+    decomp_args.dict = args.dict;
+    char *raw = NULL;
+    long raw_size = 0;
+    bool is_dir = false;
+    char *name = NULL;
+    assert(run_decompression(decomp_args, &raw, &raw_size, &is_dir, &name) == 0);
+    assert(raw_size == data_len);
+    long offset = 0;
+    for (int i = 0; i < segment_count; i++) {
+        assert(memcmp(raw + offset, segments[i].data, segments[i].size) == 0);
+        offset += segments[i].size;
+    }
+    free(raw);
+    free(name);
+    return compressed_size;
+}
+
 int main() {
     char *data = "hello world";
     long data_len = strlen(data);
@@ -638,6 +693,1045 @@ int main() {
         printf("    Large file round-trip test passed.\n");
     }
     
+    // Edge case 7: Append a file to an existing directory archive
+    printf("  Edge case 7: Append to directory archive...\n");
+    {
+        char *dir_input = "test_append_dir";
+        char *dir_compressed = "test_append_dir.huff";
+        char *dir_output = "test_append_out";
+        mkdir(dir_input, 0755);
+        assert(write_raw("test_append_dir/first.txt", "first file", 10, true) == 10);
+
+        Arguments compress_args = {0};
+        compress_args.compress_mode = true;
+        compress_args.force = true;
+        compress_args.directory = true;
+        compress_args.input_file = dir_input;
+        compress_args.output_file = dir_compressed;
+
+        Directory_stream stream = {0};
+        long directory_size = 0;
+        assert(prepare_directory_stream(compress_args, &stream, &directory_size) > 0);
+        assert(run_compression_segments(compress_args, stream.segments, stream.segment_count, directory_size) == 0);
+        assert(write_archive_index(dir_compressed, NULL, stream.archive, stream.archive_size) == SUCCESS);
+        free_directory_stream(&stream);
+
+        // A hozzafuzendo fajl a mappaban jon letre, igy kibontaskor ugyanoda kerul
+        assert(write_raw("test_append_dir/second.txt", "second file", 11, true) == 11);
+        Arguments append_args = {0};
+        append_args.force = true;
+        append_args.append_archive = dir_compressed;
+
+        // Abszolut utvonal es ".." tag nem kerulhet az archivumba, az archivum valtozatlan marad
+        char *outside_inputs[] = {"test_append_dir/../test_append_dir/second.txt", "/tmp"};
+        for (int i = 0; i < 2; i++) {
+            append_args.input_files = &outside_inputs[i];
+            append_args.input_count = 1;
+            assert(run_append(append_args) == PATH_ERROR);
+        }
+
+        // A "." es az ures tagok elmaradnak, a gyoker nelkuli utvonal a gyoker ala kerul
+        assert(write_raw("third.txt", "third", 5, true) == 5);
+        char *append_inputs[] = {"./test_append_dir//second.txt", "third.txt"};
+        append_args.input_files = append_inputs;
+        append_args.input_count = 2;
+        assert(run_append(append_args) == 0);
+
+        Archive_index index = {0};
+        assert(read_archive_index(dir_compressed, &index) == SUCCESS);
+        assert(index.entry_count == 3);
+        assert(find_index_entry(&index, "test_append_dir/first.txt") != NULL);
+        assert(find_index_entry(&index, "test_append_dir/second.txt") != NULL);
+        assert(find_index_entry(&index, "test_append_dir/third.txt") != NULL);
+        free_archive_index(&index);
+
+        Arguments decomp_args = {0};
+        decomp_args.extract_mode = true;
+        decomp_args.force = true;
+        decomp_args.input_file = dir_compressed;
+        decomp_args.output_file = dir_output;
+        assert(invoke_run_decompression(decomp_args) == 0);
+
+        char *content = NULL;
+        assert(read_raw("test_append_out/test_append_dir/first.txt", &content) == 10);
+        assert(memcmp(content, "first file", 10) == 0);
+        free(content);
+        assert(read_raw("test_append_out/test_append_dir/second.txt", &content) == 11);
+        assert(memcmp(content, "second file", 11) == 0);
+        free(content);
+        assert(read_raw("test_append_out/test_append_dir/third.txt", &content) == 5);
+        assert(memcmp(content, "third", 5) == 0);
+        free(content);
+
+        remove("test_append_out/test_append_dir/first.txt");
+        remove("test_append_out/test_append_dir/second.txt");
+        remove("test_append_out/test_append_dir/third.txt");
+        remove("third.txt");
+        rmdir("test_append_out/test_append_dir");
+        rmdir(dir_output);
+        remove("test_append_dir/first.txt");
+        remove("test_append_dir/second.txt");
+        rmdir(dir_input);
+        remove(dir_compressed);
+        printf("    Append to directory archive test passed.\n");
+    }
+
+    // Edge case 8: Incompressible data is stored instead of Huffman-coded
+    printf("  Edge case 8: Incompressible data stored raw...\n");
+    {
+        char *noise_input = "test_noise.bin";
+        char *noise_compressed = "test_noise.huff";
+        char *noise_output = "test_noise_out.bin";
+        long noise_len = 64 * 1024;
+        char *noise = malloc(noise_len);
+        assert(noise != NULL);
+        uint32_t state = 12345;
+        for (long i = 0; i < noise_len; i++) {
+            state = state * 1664525u + 1013904223u;
+            noise[i] = (char)(state >> 24);
+        }
+        assert(write_raw(noise_input, noise, noise_len, true) == noise_len);
+
+        Arguments compress_args = {0};
+        compress_args.compress_mode = true;
+        compress_args.force = true;
+        compress_args.input_file = noise_input;
+        compress_args.output_file = noise_compressed;
+        assert(invoke_run_compression(compress_args) == 0);
+
+        // Csak a tag fejlece adodik a nyers merethez, fa nelkul
+        Compressed_file member = {0};
+        assert(read_compressed(noise_compressed, &member) == 0);
+        assert(member.block_type == BLOCK_STORED);
+        assert(member.tree_size == 0);
+        free(member.file_name);
+        free(member.original_file);
+        free(member.huffman_tree);
+        free(member.compressed_data);
+
+        Arguments decomp_args = {0};
+        decomp_args.extract_mode = true;
+        decomp_args.force = true;
+        decomp_args.input_file = noise_compressed;
+        decomp_args.output_file = noise_output;
+        assert(invoke_run_decompression(decomp_args) == 0);
+
+        char *restored = NULL;
+        assert(read_raw(noise_output, &restored) == noise_len);
+        assert(memcmp(noise, restored, noise_len) == 0);
+
+        free(restored);
+        free(noise);
+        remove(noise_input);
+        remove(noise_compressed);
+        remove(noise_output);
+        printf("    Incompressible data test passed.\n");
+    }
+
+    // Edge case 9: Constant and run-length dominated data get dedicated block types
+    printf("  Edge case 9: Constant and RLE blocks...\n");
+    {
+        char *run_input = "test_runs.bin";
+        char *run_compressed = "test_runs.huff";
+        char *run_output = "test_runs_out.bin";
+        long run_len = 200000;
+        char *runs = malloc(run_len);
+        assert(runs != NULL);
+
+        for (int variant = 0; variant < 2; variant++) {
+            // Az elso valtozat csupa nulla, a masodik hosszu, valtakozo futasokbol all
+            for (long i = 0; i < run_len; i++) {
+                runs[i] = variant == 0 ? 0 : (char)('a' + (i / 1000) % 7);
+            }
+            assert(write_raw(run_input, runs, run_len, true) == run_len);
+
+            Arguments compress_args = {0};
+            compress_args.compress_mode = true;
+            compress_args.force = true;
+            compress_args.input_file = run_input;
+            compress_args.output_file = run_compressed;
+            assert(invoke_run_compression(compress_args) == 0);
+
+            Compressed_file member = {0};
+            assert(read_compressed(run_compressed, &member) == 0);
+            assert(member.block_type == (variant == 0 ? BLOCK_CONSTANT : BLOCK_RLE));
+            assert(member.data_size / 8 < 1024);
+            free(member.file_name);
+            free(member.original_file);
+            free(member.huffman_tree);
+            free(member.compressed_data);
+
+            Arguments decomp_args = {0};
+            decomp_args.extract_mode = true;
+            decomp_args.force = true;
+            decomp_args.input_file = run_compressed;
+            decomp_args.output_file = run_output;
+            assert(invoke_run_decompression(decomp_args) == 0);
+
+            char *restored = NULL;
+            assert(read_raw(run_output, &restored) == run_len);
+            assert(memcmp(runs, restored, run_len) == 0);
+            free(restored);
+        }
+
+        free(runs);
+        remove(run_input);
+        remove(run_compressed);
+        remove(run_output);
+        printf("    Constant and RLE block test passed.\n");
+    }
+
+    // Edge case 10: A block with the same statistics reuses the previous block's tree
+    printf("  Edge case 10: Tree reuse between blocks...\n");
+    {
+        char *reuse_compressed = "test_reuse.huff";
+        long part_len = 8192;
+        char *text = malloc(part_len);
+        char *noise = malloc(part_len);
+        assert(text != NULL && noise != NULL);
+        uint32_t state = 777;
+        for (long i = 0; i < part_len; i++) {
+            text[i] = "the quick brown fox jumps over the lazy dog "[i % 44];
+            state = state * 1664525u + 1013904223u;
+            noise[i] = (char)(state >> 24);
+        }
+        Data_segment parts[3] = {{text, part_len}, {noise, part_len}, {text, part_len}};
+
+        Arguments compress_args = {0};
+        compress_args.compress_mode = true;
+        compress_args.force = true;
+        compress_args.input_file = "test_reuse.bin";
+        compress_args.output_file = reuse_compressed;
+        // A fa ujrahasznalasat vizsgaljuk, a beepitett tablakat itt nem engedjuk
+        compress_args.no_tables = true;
+        assert(run_compression_segments(compress_args, parts, 3, 3 * part_len) == 0);
+
+        // A harmadik blokk az elso fajat hasznalja, ezert nem tarol sajat fat
+        unsigned char expected[3] = {BLOCK_HUFFMAN, BLOCK_STORED, BLOCK_HUFFMAN_REUSE};
+        FILE *f = fopen(reuse_compressed, "rb");
+        assert(f != NULL);
+        Compressed_file member = {0};
+        assert(read_member_header(f, &member) == 0);
+        free(member.original_file);
+        for (int i = 0; i < 3; i++) {
+            assert(read_compressed_block(f, &member) == 0);
+            assert(member.block_type == expected[i]);
+            assert(member.original_size == part_len);
+            free(member.huffman_tree);
+            free(member.compressed_data);
+        }
+        assert(read_compressed_block(f, &member) == 0);
+        assert(member.block_type == BLOCK_END);
+        fclose(f);
+
+        Arguments decomp_args = {0};
+        decomp_args.extract_mode = true;
+        decomp_args.input_file = reuse_compressed;
+        char *raw = NULL;
+        long raw_size = 0;
+        bool is_dir = false;
+        char *name = NULL;
+        assert(run_decompression(decomp_args, &raw, &raw_size, &is_dir, &name) == 0);
+        assert(raw_size == 3 * part_len);
+        assert(memcmp(raw, text, part_len) == 0);
+        assert(memcmp(raw + part_len, noise, part_len) == 0);
+        assert(memcmp(raw + 2 * part_len, text, part_len) == 0);
+
+        free(raw);
+        free(name);
+        free(text);
+        free(noise);
+        remove(reuse_compressed);
+        printf("    Tree reuse test passed.\n");
+    }
+
+    // Edge case 11: A shift in the byte distribution inside one file starts a new block
+    printf("  Edge case 11: Adaptive block splitting...\n");
+    {
+        char *shift_compressed = "test_shift.huff";
+        long half = 64 * 1024;
+        char *shifted = malloc(2 * half);
+        assert(shifted != NULL);
+        uint32_t state = 99;
+        for (long i = 0; i < half; i++) {
+            shifted[i] = "the quick brown fox jumps over the lazy dog "[i % 44];
+            state = state * 1664525u + 1013904223u;
+            shifted[half + i] = (char)(128 + (state >> 28));
+        }
+        Data_segment whole = {shifted, 2 * half};
+
+        Arguments compress_args = {0};
+        compress_args.compress_mode = true;
+        compress_args.force = true;
+        compress_args.input_file = "test_shift.bin";
+        compress_args.output_file = shift_compressed;
+        assert(run_compression_segments(compress_args, &whole, 1, 2 * half) == 0);
+
+        // A vagas a ket eltero eloszlasu felet kulon fakkal kodolja
+        FILE *f = fopen(shift_compressed, "rb");
+        assert(f != NULL);
+        Compressed_file member = {0};
+        assert(read_member_header(f, &member) == 0);
+        free(member.original_file);
+        int blocks = 0;
+        int fresh_trees = 0;
+        while (true) {
+            assert(read_compressed_block(f, &member) == 0);
+            if (member.block_type == BLOCK_END) break;
+            blocks++;
+            if (member.block_type == BLOCK_HUFFMAN) fresh_trees++;
+            free(member.huffman_tree);
+            free(member.compressed_data);
+        }
+        fclose(f);
+        assert(blocks >= 2);
+        assert(fresh_trees >= 2);
+
+        Arguments decomp_args = {0};
+        decomp_args.extract_mode = true;
+        decomp_args.input_file = shift_compressed;
+        char *raw = NULL;
+        long raw_size = 0;
+        bool is_dir = false;
+        char *name = NULL;
+        assert(run_decompression(decomp_args, &raw, &raw_size, &is_dir, &name) == 0);
+        assert(raw_size == 2 * half);
+        assert(memcmp(raw, shifted, 2 * half) == 0);
+
+        free(raw);
+        free(name);
+        free(shifted);
+        remove(shift_compressed);
+        printf("    Adaptive block splitting test passed.\n");
+    }
+
+    // Edge case 12: Single-pass adaptive Huffman round trip
+    printf("  Edge case 12: Adaptive Huffman...\n");
+    {
+        // Minden bajtertek elofordul, elobb ritkan, majd egyre gyakrabban ismetlodo mintaval
+        long sample_len = 20000;
+        unsigned char *sample = malloc(sample_len);
+        assert(sample != NULL);
+        for (long i = 0; i < sample_len; i++) {
+            sample[i] = i < 256 ? (unsigned char)i : (unsigned char)("adaptive huffman"[i % 16] + (i % 97 == 0));
+        }
+        unsigned char *encoded = calloc(sample_len * 2, 1);
+        Adaptive_tree *tree = malloc(sizeof(Adaptive_tree));
+        assert(encoded != NULL && tree != NULL);
+        adaptive_init(tree);
+        long bit_pos = 0;
+        for (long i = 0; i < sample_len; i++) {
+            adaptive_encode(tree, sample[i], encoded, &bit_pos);
+        }
+        assert(bit_pos < sample_len * 8);
+        long bit_count = bit_pos;
+        adaptive_init(tree);
+        bit_pos = 0;
+        for (long i = 0; i < sample_len; i++) {
+            assert(adaptive_decode(tree, encoded, bit_count, &bit_pos) == sample[i]);
+        }
+        assert(bit_pos == bit_count);
+        assert(adaptive_decode(tree, encoded, bit_count, &bit_pos) == DECOMPRESSION_ERROR);
+
+        // A teljes folyamat fajlon keresztul: a tag nem tarol fat
+        char *adaptive_input = "test_adaptive.bin";
+        char *adaptive_compressed = "test_adaptive.huff";
+        char *adaptive_output = "test_adaptive_out.bin";
+        assert(write_raw(adaptive_input, (char*)sample, sample_len, true) == sample_len);
+        Arguments compress_args = {0};
+        compress_args.compress_mode = true;
+        compress_args.adaptive = true;
+        compress_args.force = true;
+        compress_args.input_file = adaptive_input;
+        compress_args.output_file = adaptive_compressed;
+        assert(run_adaptive_compression(compress_args) == 0);
+
+        Compressed_file member = {0};
+        assert(read_compressed(adaptive_compressed, &member) == 0);
+        assert(member.block_type == BLOCK_ADAPTIVE);
+        assert(member.tree_size == 0);
+        assert(member.original_size == sample_len);
+        free(member.file_name);
+        free(member.original_file);
+        free(member.huffman_tree);
+        free(member.compressed_data);
+
+        Arguments decomp_args = {0};
+        decomp_args.extract_mode = true;
+        decomp_args.force = true;
+        decomp_args.input_file = adaptive_compressed;
+        decomp_args.output_file = adaptive_output;
+        assert(invoke_run_decompression(decomp_args) == 0);
+        char *restored = NULL;
+        assert(read_raw(adaptive_output, &restored) == sample_len);
+        assert(memcmp(sample, restored, sample_len) == 0);
+
+        // Ures bemenetre a Huffman aghoz hasonloan EMPTY_FILE a hibakod, es nem marad kimenet
+        FILE *empty = fopen(adaptive_input, "wb");
+        assert(empty != NULL);
+        fclose(empty);
+        remove(adaptive_compressed);
+        assert(run_adaptive_compression(compress_args) == EMPTY_FILE);
+        struct stat empty_st;
+        assert(stat(adaptive_compressed, &empty_st) != 0);
+
+        free(restored);
+        free(sample);
+        free(encoded);
+        free(tree);
+        remove(adaptive_input);
+        remove(adaptive_compressed);
+        remove(adaptive_output);
+        printf("    Adaptive Huffman test passed.\n");
+    }
+
+    // Edge case 13: --fast builds the tree from a sample and still round-trips every byte value
+    printf("  Edge case 13: Sampled tree (--fast)...\n");
+    {
+        long fast_len = 600000;
+        char *fast_data = malloc(fast_len);
+        assert(fast_data != NULL);
+        uint32_t state = 4242;
+        for (long i = 0; i < fast_len; i++) {
+            state = state * 1664525u + 1013904223u;
+            // Foleg szoveg, de ritkan barmelyik bajtertek elofordulhat, a mintabol hianyzoak is
+            fast_data[i] = (state >> 24) < 3 ? (char)(state >> 8) : "lorem ipsum dolor sit amet "[(state >> 16) % 27];
+        }
+        Data_segment whole = {fast_data, fast_len};
+        Compressed_file first_block = {0};
+        long sizes[2];
+        for (int fast = 0; fast < 2; fast++) {
+            Arguments compress_args = {0};
+            compress_args.fast = fast;
+            compress_args.input_file = "test_fast.bin";
+            compress_args.output_file = "test_fast.huff";
+            debugmalloc_max_block_size(10 * 1024 * 1024);
+            sizes[fast] = roundtrip_with_args(compress_args, &whole, 1, &first_block);
+        }
+        // A mintabol epitett fa csak keveset ronthat a tomoritesen (a teljes, 256 levelu fa tarolasat is beleertve)
+        assert(sizes[1] < sizes[0] + sizes[0] / 50 + 256 * 2 * (long)sizeof(Node));
+        free(fast_data);
+
+        // A minta csak az egyes 8 KB-os darabok elejet latja; ha a fa rossznak bizonyul, tarolt blokk keszul
+        long skew_len = 64 * 8192;
+        char *skew_data = malloc(skew_len);
+        assert(skew_data != NULL);
+        for (long i = 0; i < skew_len; i++) {
+            state = state * 1664525u + 1013904223u;
+            skew_data[i] = i % 8192 < 64 ? 'a' : (char)(state >> 24);
+        }
+        Data_segment skew = {skew_data, skew_len};
+        Arguments skew_args = {0};
+        skew_args.fast = true;
+        skew_args.input_file = "test_fast.bin";
+        skew_args.output_file = "test_fast.huff";
+        long skew_size = roundtrip_with_args(skew_args, &skew, 1, &first_block);
+        assert(skew_size < skew_len + 64);
+        assert(first_block.block_type == BLOCK_STORED);
+        free(skew_data);
+
+        // Egyetlen bajtbol, illetve hosszu futasokbol allo bemenetnel a gyors mod is konstans es RLE blokkot ir
+        long runs_len = 1000000;
+        char *runs_data = calloc(runs_len, 1);
+        assert(runs_data != NULL);
+        Data_segment runs = {runs_data, runs_len};
+        Arguments runs_args = {0};
+        runs_args.fast = true;
+        runs_args.input_file = "test_fast.bin";
+        runs_args.output_file = "test_fast.huff";
+        long runs_size = roundtrip_with_args(runs_args, &runs, 1, &first_block);
+        assert(runs_size < 128);
+        assert(first_block.block_type == BLOCK_CONSTANT);
+        for (long i = 0; i < runs_len; i++) {
+            if (i % 300 == 0) state = state * 1664525u + 1013904223u;
+            runs_data[i] = "ACGT"[state >> 30];
+        }
+        roundtrip_with_args(runs_args, &runs, 1, &first_block);
+        assert(first_block.block_type == BLOCK_RLE);
+        free(runs_data);
+
+        remove("test_fast.huff");
+        printf("    Sampled tree test passed.\n");
+    }
+
+    // Edge case 14: Small inputs use a built-in code table instead of storing a tree
+    printf("  Edge case 14: Built-in code tables...\n");
+    {
+        char *table_text = "Permission is hereby granted, free of charge, to any person obtaining a copy "
+                           "of this software and associated documentation files, to deal in the Software "
+                           "without restriction, including without limitation the rights to use, copy, modify.";
+        long table_len = strlen(table_text);
+        Data_segment whole = {table_text, table_len};
+        char *forced[2] = {NULL, "json"};
+        for (int variant = 0; variant < 2; variant++) {
+            Arguments compress_args = {0};
+            compress_args.table = forced[variant];
+            compress_args.input_file = "test_table.txt";
+            compress_args.output_file = "test_table.huff";
+            Compressed_file first_block = {0};
+            roundtrip_with_args(compress_args, &whole, 1, &first_block);
+
+            // A fa helyen csak a tabla azonositoja all
+            assert(first_block.block_type == BLOCK_TABLE);
+            assert(first_block.tree_size == 1);
+            assert(first_block.data_size / 8 < table_len);
+            FILE *f = fopen("test_table.huff", "rb");
+            assert(f != NULL);
+            assert(read_member_header(f, &first_block) == 0);
+            assert(read_compressed_block(f, &first_block) == 0);
+            assert(*(unsigned char*)first_block.huffman_tree == find_static_table(variant == 0 ? "text" : "json"));
+            fclose(f);
+            free(first_block.original_file);
+            free(first_block.huffman_tree);
+            free(first_block.compressed_data);
+        }
+
+        // Megadott tablaval a nem illeszkedo (itt csupa nulla) bemenet blokkjai tarolva kerulnek a fajlba
+        long zeros_len = 1000000;
+        char *zeros = calloc(zeros_len, 1);
+        assert(zeros != NULL);
+        Data_segment zero_part = {zeros, zeros_len};
+        Arguments zero_args = {0};
+        zero_args.table = "json";
+        zero_args.input_file = "test_table.bin";
+        zero_args.output_file = "test_table.huff";
+        Compressed_file zero_block = {0};
+        debugmalloc_max_block_size(debugmalloc_max_block_size_default);
+        long zero_size = roundtrip_with_args(zero_args, &zero_part, 1, &zero_block);
+        assert(zero_block.block_type == BLOCK_STORED);
+        assert(zero_block.original_size == FORCED_BLOCK_SIZE);
+        assert(zero_size < zeros_len + 256);
+        free(zeros);
+
+        assert(find_static_table("x86") >= 0);
+        assert(find_static_table("missing") == -1);
+        remove("test_table.huff");
+        printf("    Built-in code table test passed.\n");
+    }
+
+    // Edge case 15: A trained dictionary replaces the tree with its hash
+    printf("  Edge case 15: Trained dictionary...\n");
+    {
+        char *corpus_text = "{\"id\": 1, \"name\": \"alpha\", \"active\": true}\n"
+                            "{\"id\": 2, \"name\": \"beta\", \"active\": false}\n";
+        assert(write_raw("test_dict_corpus.json", corpus_text, strlen(corpus_text), true) > 0);
+        Arguments train_args = {0};
+        train_args.train = true;
+        train_args.force = true;
+        train_args.input_file = "test_dict_corpus.json";
+        train_args.output_file = "test_dict.hufd";
+        assert(run_training(train_args) == 0);
+
+        Dictionary dictionary;
+        assert(load_dictionary("test_dict.hufd", &dictionary) == 0);
+        assert(dictionary.weights['"'] == 16 + 1);
+        assert(dictionary.weights[0] == 1);
+
+        char *dict_text = "{\"id\": 3, \"name\": \"gamma\", \"active\": true}\n";
+        long dict_len = strlen(dict_text);
+        Data_segment whole = {dict_text, dict_len};
+        Arguments compress_args = {0};
+        compress_args.dict = "test_dict.hufd";
+        compress_args.input_file = "test_dict.json";
+        compress_args.output_file = "test_dict.huff";
+        Compressed_file first_block = {0};
+        roundtrip_with_args(compress_args, &whole, 1, &first_block);
+        assert(first_block.block_type == BLOCK_DICT);
+        assert(first_block.tree_size == DICTIONARY_HASH_SIZE);
+
+        Compressed_file member = {0};
+        assert(read_compressed("test_dict.huff", &member) == 0);
+        assert(memcmp(member.huffman_tree, &dictionary.hash, DICTIONARY_HASH_SIZE) == 0);
+        free(member.file_name);
+        free(member.original_file);
+        free(member.huffman_tree);
+        free(member.compressed_data);
+
+        // Szotar nelkul vagy mas szotarral nem bonthato ki
+        Arguments decomp_args = {0};
+        decomp_args.extract_mode = true;
+        decomp_args.input_file = "test_dict.huff";
+        char *raw = NULL;
+        long raw_size = 0;
+        bool is_dir = false;
+        char *name = NULL;
+        assert(run_decompression(decomp_args, &raw, &raw_size, &is_dir, &name) != 0);
+        train_args.input_file = "test_dict.huff";
+        train_args.output_file = "test_dict_other.hufd";
+        assert(run_training(train_args) == 0);
+        decomp_args.dict = "test_dict_other.hufd";
+        assert(run_decompression(decomp_args, &raw, &raw_size, &is_dir, &name) != 0);
+
+        // A szotarhoz nem illeszkedo bemenet (csupa nulla bajt) blokkjai tarolva kerulnek a fajlba
+        long zeros_len = 1000000;
+        char *zeros = calloc(zeros_len, 1);
+        assert(zeros != NULL);
+        Data_segment zero_part = {zeros, zeros_len};
+        compress_args.input_file = "test_dict.bin";
+        Compressed_file zero_block = {0};
+        debugmalloc_max_block_size(debugmalloc_max_block_size_default);
+        long zero_size = roundtrip_with_args(compress_args, &zero_part, 1, &zero_block);
+        assert(zero_block.block_type == BLOCK_STORED);
+        assert(zero_size < zeros_len + 256);
+        free(zeros);
+
+        // A korpusz mappaban levo, onmagara mutato link nem okoz vegtelen rekurziot, a link tartalma nem szamit
+        mkdir("test_dict_corpus", 0755);
+        assert(write_raw("test_dict_corpus/a.json", corpus_text, strlen(corpus_text), true) > 0);
+        assert(symlink(".", "test_dict_corpus/loop") == 0);
+        train_args.input_file = "test_dict_corpus";
+        train_args.output_file = "test_dict_other.hufd";
+        assert(run_training(train_args) == 0);
+        Dictionary linked;
+        assert(load_dictionary("test_dict_other.hufd", &linked) == 0);
+        assert(memcmp(linked.weights, dictionary.weights, sizeof(linked.weights)) == 0);
+        remove("test_dict_corpus/loop");
+        remove("test_dict_corpus/a.json");
+        rmdir("test_dict_corpus");
+
+        remove("test_dict_corpus.json");
+        remove("test_dict.hufd");
+        remove("test_dict_other.hufd");
+        remove("test_dict.huff");
+        printf("    Trained dictionary test passed.\n");
+    }
+
+    // Edge case 16: Directory mode clusters similar files and shares one tree per cluster
+    printf("  Edge case 16: Clustered trees in directory mode...\n");
+    {
+        char *cluster_compressed = "test_cluster.huff";
+        long part_len = 16384;
+        char *dna = malloc(part_len);
+        char *letters = malloc(part_len);
+        assert(dna != NULL && letters != NULL);
+        uint32_t state = 4242;
+        for (long i = 0; i < part_len; i++) {
+            state = state * 1664525u + 1013904223u;
+            dna[i] = "ACGT"[state >> 30];
+            state = state * 1664525u + 1013904223u;
+            letters[i] = (char)('a' + (state >> 28));
+        }
+        Data_segment parts[4] = {{dna, part_len}, {letters, part_len}, {dna, part_len}, {letters, part_len}};
+
+        Arguments compress_args = {0};
+        compress_args.directory = true;
+        compress_args.input_file = "test_cluster_dir";
+        compress_args.output_file = cluster_compressed;
+        Compressed_file first_block = {0};
+        roundtrip_with_args(compress_args, parts, 4, &first_block);
+
+        // Ket csoport, ket fa: a harmadik blokk az egy blokkal korabbi, a negyedik a legutobbi fara hivatkozik
+        unsigned char expected[4] = {BLOCK_HUFFMAN, BLOCK_HUFFMAN, BLOCK_HUFFMAN_REF, BLOCK_HUFFMAN_REUSE};
+        FILE *f = fopen(cluster_compressed, "rb");
+        assert(f != NULL);
+        Compressed_file member = {0};
+        assert(read_member_header(f, &member) == 0);
+        free(member.original_file);
+        for (int i = 0; i < 4; i++) {
+            assert(read_compressed_block(f, &member) == 0);
+            assert(member.block_type == expected[i]);
+            assert(member.original_size == part_len);
+            if (member.block_type == BLOCK_HUFFMAN_REF) {
+                assert(member.tree_size == 1);
+                assert(*(unsigned char*)member.huffman_tree == 1);
+            }
+            free(member.huffman_tree);
+            free(member.compressed_data);
+        }
+        fclose(f);
+
+        free(dna);
+        free(letters);
+        remove(cluster_compressed);
+        printf("    Clustered tree test passed.\n");
+    }
+
+    // Edge case 17: Order-1 context coding (--context)
+    printf("  Edge case 17: Order-1 context coding...\n");
+    {
+        char *context_compressed = "test_context.huff";
+        long log_len = 0;
+        char *log = malloc(64 * 1024);
+        assert(log != NULL);
+        uint32_t state = 31337;
+        char *levels[3] = {"INFO", "WARN", "DEBUG"};
+        while (log_len < 60 * 1024) {
+            state = state * 1664525u + 1013904223u;
+            log_len += sprintf(log + log_len, "2024-05-01T12:%02u:%02uZ [%s] request %u done\n",
+                               (state >> 8) % 60, (state >> 16) % 60, levels[state >> 30 == 3 ? 0 : state >> 30], state % 1000);
+        }
+        // A masodik bemenetben minden bajtot egyertelmuen meghataroz az elozo, igy a kodolt adat 0 bit
+        long alternating_len = 4096;
+        char *alternating = malloc(alternating_len);
+        assert(alternating != NULL);
+        for (long i = 0; i < alternating_len; i++) {
+            alternating[i] = i % 2 == 0 ? 'a' : 'b';
+        }
+        Data_segment inputs[2] = {{log, log_len}, {alternating, alternating_len}};
+
+        for (int variant = 0; variant < 2; variant++) {
+            Compressed_file first_block = {0};
+            long sizes[2] = {0};
+            for (int context = 0; context < 2; context++) {
+                Arguments compress_args = {0};
+                compress_args.context = context == 1;
+                compress_args.input_file = "test_context.log";
+                compress_args.output_file = context_compressed;
+                sizes[context] = roundtrip_with_args(compress_args, &inputs[variant], 1, &first_block);
+            }
+            assert(sizes[1] < sizes[0]);
+            assert(first_block.block_type == BLOCK_CONTEXT);
+            if (variant == 1) assert(first_block.data_size == 0);
+        }
+        free(log);
+        free(alternating);
+        remove(context_compressed);
+        printf("    Context coding test passed.\n");
+    }
+
+    // Edge case 18: tANS backend on a skewed distribution (--ans)
+    printf("  Edge case 18: tANS entropy backend...\n");
+    {
+        char *ans_compressed = "test_ans.huff";
+        long skewed_len = 64 * 1024;
+        char *skewed = malloc(skewed_len);
+        assert(skewed != NULL);
+        uint32_t state = 2024;
+        long frequencies[256] = {0};
+        for (long i = 0; i < skewed_len; i++) {
+            // ~90% nulla: a Huffman kod ehhez is legalabb 1 bitet hasznal bajtonkent
+            state = state * 1664525u + 1013904223u;
+            bool rare = (state >> 24) >= 230;
+            state = state * 1664525u + 1013904223u;
+            skewed[i] = rare ? (char)(1 + (state >> 29)) : 0;
+            frequencies[(unsigned char)skewed[i]]++;
+        }
+        unsigned short normalized[256];
+        assert(ans_normalize(frequencies, normalized) == 9);
+        long normalized_sum = 0;
+        for (int i = 0; i < 256; i++) {
+            normalized_sum += normalized[i];
+            assert((frequencies[i] == 0) == (normalized[i] == 0));
+        }
+        assert(normalized_sum == ANS_TABLE_SIZE);
+
+        Data_segment whole = {skewed, skewed_len};
+        Compressed_file first_block = {0};
+        long sizes[2] = {0};
+        for (int ans = 0; ans < 2; ans++) {
+            Arguments compress_args = {0};
+            compress_args.ans = ans == 1;
+            compress_args.input_file = "test_ans.bin";
+            compress_args.output_file = ans_compressed;
+            sizes[ans] = roundtrip_with_args(compress_args, &whole, 1, &first_block);
+        }
+        assert(sizes[1] < sizes[0]);
+        assert(first_block.block_type == BLOCK_ANS);
+        assert(first_block.data_size < skewed_len);
+        free(skewed);
+        remove(ans_compressed);
+        printf("    tANS backend test passed.\n");
+    }
+
+    // Edge case 19: LZ77 front end on repeated lines split across segments (--lz)
+    printf("  Edge case 19: LZ77 front end...\n");
+    {
+        char *lz_compressed = "test_lz.huff";
+        long half = 24 * 1024;
+        char *lines = malloc(2 * half + 64);
+        assert(lines != NULL);
+        long lines_len = 0;
+        uint32_t state = 5150;
+        while (lines_len < 2 * half) {
+            state = state * 1664525u + 1013904223u;
+            lines_len += sprintf(lines + lines_len, "GET /api/v1/items/%u HTTP/1.1 200 OK\n", (state >> 16) % 32);
+        }
+        Data_segment parts[2] = {{lines, half}, {lines + half, lines_len - half}};
+
+        Compressed_file first_block = {0};
+        long sizes[2] = {0};
+        for (int lz = 0; lz < 2; lz++) {
+            Arguments compress_args = {0};
+            compress_args.lz_window = lz == 1 ? LZ_WINDOW_MIN : 0;
+            compress_args.input_file = "test_lz.log";
+            compress_args.output_file = lz_compressed;
+            sizes[lz] = roundtrip_with_args(compress_args, parts, 2, &first_block);
+        }
+        // Az ismetlodo sorokat az LZ77 tavolsag-hossz parokka alakitja, ez tobbszor kisebb az order-0 kodnal
+        assert(sizes[1] * 2 < sizes[0]);
+        assert(first_block.block_type == BLOCK_LZ);
+        assert(first_block.original_size == lines_len);
+        free(lines);
+        remove(lz_compressed);
+        printf("    LZ77 front end test passed.\n");
+    }
+
+    // Edge case 20: Burrows-Wheeler transform over several sub-blocks (--bwt)
+    printf("  Edge case 20: Burrows-Wheeler transform...\n");
+    {
+        char *bwt_compressed = "test_bwt.huff";
+        static const char *words[] = {"alma", "korte", "szilva", "barack", "meggy", "cseresznye", "dio", "mogyoro"};
+        long text_len = 0;
+        char *text = malloc(BWT_BLOCK_SIZE + BWT_BLOCK_SIZE / 2 + 16);
+        assert(text != NULL);
+        uint32_t state = 2024;
+        while (text_len < BWT_BLOCK_SIZE + BWT_BLOCK_SIZE / 2) {
+            state = state * 1664525u + 1013904223u;
+            text_len += sprintf(text + text_len, "%s ", words[(state >> 16) % 8]);
+        }
+        Data_segment part = {text, text_len};
+
+        Compressed_file first_block = {0};
+        long sizes[2] = {0};
+        for (int bwt = 0; bwt < 2; bwt++) {
+            Arguments compress_args = {0};
+            compress_args.bwt = bwt == 1;
+            compress_args.input_file = "test_bwt.txt";
+            compress_args.output_file = bwt_compressed;
+            sizes[bwt] = roundtrip_with_args(compress_args, &part, 1, &first_block);
+        }
+        // A BWT a szavak betuit futasokba rendezi, igy az MTF kimenet tobbnyire nulla
+        assert(sizes[1] * 2 < sizes[0]);
+        assert(first_block.block_type == BLOCK_BWT);
+        assert(first_block.original_size == text_len);
+        free(text);
+        remove(bwt_compressed);
+        printf("    Burrows-Wheeler transform test passed.\n");
+    }
+
+    // Edge case 21: byte-shuffle filter on 8-byte telemetry records (--shuffle=8)
+    printf("  Edge case 21: byte-shuffle filter...\n");
+    {
+        char *shuffle_compressed = "test_shuffle.huff";
+        long record_count = 16384;
+        long records_len = record_count * 8 + 3;
+        char *records = malloc(records_len);
+        assert(records != NULL);
+        uint32_t state = 77;
+        for (long r = 0; r < record_count; r++) {
+            state = state * 1664525u + 1013904223u;
+            uint32_t counter = (uint32_t)(r * 3 + (state >> 30));
+            float reading = 20.0f + (float)((state >> 8) & 0xffff) / 65536.0f;
+            memcpy(records + r * 8, &counter, sizeof(counter));
+            memcpy(records + r * 8 + 4, &reading, sizeof(reading));
+        }
+        memcpy(records + record_count * 8, "end", 3);
+        Data_segment part = {records, records_len};
+
+        Compressed_file first_block = {0};
+        long sizes[2] = {0};
+        for (int shuffle = 0; shuffle < 2; shuffle++) {
+            Arguments compress_args = {0};
+            compress_args.shuffle = shuffle == 1 ? 8 : 0;
+            compress_args.input_file = "test_shuffle.bin";
+            compress_args.output_file = shuffle_compressed;
+            sizes[shuffle] = roundtrip_with_args(compress_args, &part, 1, &first_block);
+        }
+        // A szamlalo es a lebegopontos ertek felso bajtjai kulon sikban szinte allandok
+        assert(sizes[1] * 4 < sizes[0] * 3);
+        assert(first_block.filter == FILTER_SHUFFLE);
+        assert(first_block.filter_width == 8);
+        free(records);
+        remove(shuffle_compressed);
+        printf("    Byte-shuffle filter test passed.\n");
+    }
+
+    // Edge case 22: delta prediction on monotonic 64-bit timestamps (--numeric)
+    printf("  Edge case 22: delta prediction...\n");
+    {
+        char *numeric_compressed = "test_numeric.huff";
+        long stamp_count = 16384;
+        long stamps_len = stamp_count * (long)sizeof(uint64_t);
+        char *stamps = malloc(stamps_len);
+        assert(stamps != NULL);
+        uint64_t stamp = 1700000000000ULL;
+        uint32_t state = 4242;
+        for (long i = 0; i < stamp_count; i++) {
+            state = state * 1664525u + 1013904223u;
+            stamp += 990 + (state >> 16) % 21;
+            memcpy(stamps + i * sizeof(uint64_t), &stamp, sizeof(uint64_t));
+        }
+        Data_segment part = {stamps, stamps_len};
+
+        Compressed_file first_block = {0};
+        long sizes[2] = {0};
+        for (int numeric = 0; numeric < 2; numeric++) {
+            Arguments compress_args = {0};
+            compress_args.numeric = numeric == 1;
+            compress_args.input_file = "test_numeric.bin";
+            compress_args.output_file = numeric_compressed;
+            sizes[numeric] = roundtrip_with_args(compress_args, &part, 1, &first_block);
+        }
+        // A kulonbsegek egyetlen kis tartomanyba esnek, a felso bajtjaik nullak
+        assert(sizes[1] * 2 < sizes[0]);
+        assert(first_block.filter == FILTER_DELTA);
+        assert(first_block.filter_width == 8);
+        free(stamps);
+        remove(numeric_compressed);
+        printf("    Delta prediction test passed.\n");
+    }
+
+    // Edge case 23: 16-bit symbols, UTF-16 text and a length-limited code (--wide)
+    printf("  Edge case 23: 16-bit symbol alphabet...\n");
+    {
+        char *wide_compressed = "test_wide.huff";
+        /* UTF-16LE szoveg: a bajtparok mindket fele ugyanannak a par tucat karakternek a resze. */
+        static const uint16_t letters[] = {0x0430, 0x0431, 0x0432, 0x0433, 0x0434, 0x0435, 0x0020, 0x4E2D, 0x6587, 0x00E1, 0x0151};
+        long unit_count = 50001;
+        long text_len = unit_count * 2;
+        char *text = malloc(text_len);
+        assert(text != NULL);
+        uint32_t state = 16;
+        for (long i = 0; i < unit_count; i++) {
+            state = state * 1664525u + 1013904223u;
+            uint16_t unit = letters[(state >> 16) % 11];
+            text[2 * i] = (char)(unit & 0xff);
+            text[2 * i + 1] = (char)(unit >> 8);
+        }
+        Data_segment part = {text, text_len - 1};
+
+        Compressed_file first_block = {0};
+        long sizes[2] = {0};
+        for (int wide = 0; wide < 2; wide++) {
+            Arguments compress_args = {0};
+            compress_args.wide = wide == 1;
+            compress_args.input_file = "test_wide.txt";
+            compress_args.output_file = wide_compressed;
+            sizes[wide] = roundtrip_with_args(compress_args, &part, 1, &first_block);
+        }
+        // A bajtparok eloszlasa egy szimbolumra kb. 3.5 bit, bajtonkent kodolva ennek kozel ketszerese
+        assert(sizes[1] * 3 < sizes[0] * 2);
+        assert(first_block.block_type == BLOCK_WIDE);
+        free(text);
+        remove(wide_compressed);
+
+        /* Fibonacci gyakorisagok mellett a korlat nelkuli kod 26 szimbolumnal 25 bit mely lenne. */
+        long fibonacci[26] = {1, 1};
+        long pair_count = 2;
+        for (int k = 2; k < 26; k++) {
+            fibonacci[k] = fibonacci[k - 1] + fibonacci[k - 2];
+            pair_count += fibonacci[k];
+        }
+        char *skewed = malloc(pair_count * 2);
+        assert(skewed != NULL);
+        long written = 0;
+        for (int k = 0; k < 26; k++) {
+            for (long i = 0; i < fibonacci[k]; i++, written++) {
+                skewed[2 * written] = (char)k;
+                skewed[2 * written + 1] = (char)(0x40 + k);
+            }
+        }
+        Canonical_code code = {0};
+        assert(wide_estimate(skewed, pair_count * 2, &code) > 0);
+        int longest = 0;
+        for (long s = 0; s < WIDE_SYMBOLS; s++) {
+            if (code.lengths[s] > longest) longest = code.lengths[s];
+        }
+        assert(longest == CANONICAL_LENGTH_MAX);
+        Compressed_file block = {0};
+        Node *table = NULL;
+        assert(wide_encode(skewed, pair_count * 2, &code, &block, &table) == 0);
+        char *decoded = malloc(pair_count * 2);
+        assert(decoded != NULL);
+        assert(wide_decode((char*)block.huffman_tree, block.tree_size, (unsigned char*)block.compressed_data,
+                           block.data_size, decoded, pair_count * 2) == 0);
+        assert(memcmp(decoded, skewed, pair_count * 2) == 0);
+        free_canonical_code(&code);
+        free(table);
+        free(block.compressed_data);
+        free(decoded);
+        free(skewed);
+        printf("    16-bit symbol alphabet test passed.\n");
+    }
+
+    // Edge case 24: word-level tokens with a per-block vocabulary and escaped rare words (--words)
+    printf("  Edge case 24: word-level tokenization...\n");
+    {
+        char *words_compressed = "test_words.huff";
+        /* Naplosorok: gyakori szavak, kozottuk egyszeri (veletlen hexa) azonositok, amelyek kikerulovel kodolodnak. */
+        static const char *levels[] = {"INFO", "WARN", "DEBUG", "ERROR"};
+        static const char *messages[] = {"request served from cache", "connection closed by peer", "retrying upstream call",
+                                         "session token refreshed", "slow query on table orders", "user logged out"};
+        long capacity = 400000;
+        char *text = malloc(capacity);
+        assert(text != NULL);
+        long text_len = 0;
+        uint32_t state = 24;
+        for (int line = 0; text_len < capacity - 400; line++) {
+            state = state * 1664525u + 1013904223u;
+            text_len += sprintf(text + text_len, "2026-10-%02d %s [worker_%d] %s id=%08x\n", 1 + line % 28,
+                                levels[(state >> 8) % 4], (int)((state >> 12) % 8), messages[(state >> 16) % 6], state);
+        }
+        /* Egy WORDS_TOKEN_MAX-nal hosszabb elvalaszto es nem ASCII bajtok is. */
+        memset(text + text_len, ' ', 300);
+        text_len += 300;
+        text_len += sprintf(text + text_len, "v\xc3\xa9ge\n");
+        Data_segment part = {text, text_len};
+
+        Compressed_file first_block = {0};
+        long sizes[2] = {0};
+        for (int words = 0; words < 2; words++) {
+            Arguments compress_args = {0};
+            compress_args.words = words == 1;
+            compress_args.input_file = "test_words.log";
+            compress_args.output_file = words_compressed;
+            sizes[words] = roundtrip_with_args(compress_args, &part, 1, &first_block);
+        }
+        assert(sizes[1] * 3 < sizes[0] * 2);
+        assert(first_block.block_type == BLOCK_WORDS);
+        free(text);
+        remove(words_compressed);
+        printf("    Word-level tokenization test passed.\n");
+    }
+
+    // Edge case 25: delimiter-separated records split into per-column streams (--columnar)
+    printf("  Edge case 25: columnar CSV transform...\n");
+    {
+        char *columnar_compressed = "test_columnar.huff";
+        static const char *hosts[] = {"web-01.example.com", "web-02.example.com", "db-01.example.com", "cache-03.example.com"};
+        static const char *paths[] = {"/api/v1/users", "/api/v1/orders", "/static/app.js", "/health"};
+        static const int statuses[] = {200, 200, 304, 404, 500};
+        long capacity = 300000;
+        char *text = malloc(capacity);
+        assert(text != NULL);
+        long text_len = sprintf(text, "timestamp,host,path,status,bytes,agent\n");
+        uint32_t state = 25;
+        long timestamp = 1760000000;
+        for (int row = 0; text_len < capacity - 300; row++) {
+            state = state * 1664525u + 1013904223u;
+            timestamp += (state >> 20) % 4;
+            text_len += sprintf(text + text_len, "%ld,%s,%s,%d,%u,\"%s\"\n", timestamp, hosts[(state >> 8) % 4], paths[(state >> 12) % 4],
+                                statuses[(state >> 16) % 5], (state >> 4) % 9000, row % 7 == 0 ? "curl, \"8.0\"\nline" : "Mozilla/5.0");
+        }
+        /* Hosszabb es rovidebb sor, a vegen sorvege nelkul. */
+        text_len += sprintf(text + text_len, "1,extra,fields,200,5,agent,more,than,header\nshort,row\nlast,field");
+        Data_segment part = {text, text_len};
+
+        char delimiter = 0;
+        assert(detect_columns(text, text_len, &delimiter) == 6);
+        assert(delimiter == ',');
+
+        Compressed_file first_block = {0};
+        long sizes[2] = {0};
+        for (int columnar = 0; columnar < 2; columnar++) {
+            Arguments compress_args = {0};
+            compress_args.columnar = columnar == 1;
+            compress_args.input_file = "test_columnar.csv";
+            compress_args.output_file = columnar_compressed;
+            sizes[columnar] = roundtrip_with_args(compress_args, &part, 1, &first_block);
+        }
+        assert(sizes[1] * 5 < sizes[0] * 4);
+        assert(first_block.filter == FILTER_COLUMNS);
+        assert(first_block.filter_width == 6);
+
+        /* Nem tagolt szovegnel a kapcsolo hatastalan. */
+        char *plain = "nincs itt elvalaszto\ncsak sima szoveg\nsorokban\n";
+        assert(detect_columns(plain, strlen(plain), &delimiter) == 0);
+        free(text);
+        remove(columnar_compressed);
+        printf("    Columnar CSV transform test passed.\n");
+    }
+
     printf("All edge case tests passed!\n");
 
     return 0;
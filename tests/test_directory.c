@@ -6,7 +6,12 @@
 #include <dirent.h>
 #include <unistd.h>
 #include <assert.h>
+#include <utime.h>
+#include <fcntl.h>
+#include <limits.h>
 #include "../lib/directory.h"
+#include "../lib/chunk.h"
+#include "../lib/hash.h"
 #include "../lib/data_types.h"
 #include "../lib/debugmalloc.h"
 
@@ -58,6 +63,7 @@ static void free_directory_items(Directory_item *items, int count) {
         } else {
             free(items[i].file_path);
             free(items[i].file_data);
+            free(items[i].chunks);
         }
     }
     free(items);
@@ -233,7 +239,7 @@ int main() {
 
     // 3. Deserialize the archive
     Directory_item *deserialized_archive = NULL;
-    int deserialized_size = deserialize_archive(&deserialized_archive, buffer);
+    int deserialized_size = deserialize_archive(&deserialized_archive, buffer, buffer_size);
     if (deserialized_size < 0) {
         fprintf(stderr, "Error: Deserialization failed with code %d\n", deserialized_size);
         free(buffer);
@@ -246,7 +252,7 @@ int main() {
         perror("chdir() error");
         return 1;
     }
-    if (extract_directory(".", deserialized_archive, deserialized_size, true, false) != 0) {
+    if (extract_directory(".", deserialized_archive, deserialized_size, true, false, false) != 0) {
         if (chdir(original_cwd) != 0) {
             perror("chdir() error");
         }
@@ -330,10 +336,10 @@ int main() {
     printf("  Test 1: prepare_directory with relative path...\n");
     {
         char *data = NULL;
-        int directory_size = 0;
-        int result = prepare_directory(prep_test_dir, &data, &directory_size);
+        long directory_size = 0;
+        long result = prepare_directory(prep_test_dir, &data, &directory_size);
         if (result < 0) {
-            fprintf(stderr, "Error: prepare_directory failed with relative path, code: %d\n", result);
+            fprintf(stderr, "Error: prepare_directory failed with relative path, code: %ld\n", result);
             return 1;
         }
         if (data == NULL) {
@@ -341,15 +347,15 @@ int main() {
             return 1;
         }
         if (directory_size <= 0) {
-            fprintf(stderr, "Error: prepare_directory returned invalid directory_size: %d\n", directory_size);
+            fprintf(stderr, "Error: prepare_directory returned invalid directory_size: %ld\n", directory_size);
             free(data);
             return 1;
         }
-        printf("    Relative path test passed. Directory size: %d bytes\n", directory_size);
+        printf("    Relative path test passed. Directory size: %ld bytes\n", directory_size);
         
         // Verify we can deserialize the archive
         Directory_item *prep_archive = NULL;
-        int prep_archive_size = deserialize_archive(&prep_archive, data);
+        int prep_archive_size = deserialize_archive(&prep_archive, data, result);
         if (prep_archive_size < 0) {
             fprintf(stderr, "Error: deserialize_archive failed after prepare_directory\n");
             free(data);
@@ -414,10 +420,10 @@ int main() {
         }
         
         char *data = NULL;
-        int directory_size = 0;
-        int result = prepare_directory(abs_path, &data, &directory_size);
+        long directory_size = 0;
+        long result = prepare_directory(abs_path, &data, &directory_size);
         if (result < 0) {
-            fprintf(stderr, "Error: prepare_directory failed with absolute path, code: %d\n", result);
+            fprintf(stderr, "Error: prepare_directory failed with absolute path, code: %ld\n", result);
             return 1;
         }
         if (data == NULL) {
@@ -425,15 +431,15 @@ int main() {
             return 1;
         }
         if (directory_size <= 0) {
-            fprintf(stderr, "Error: prepare_directory returned invalid directory_size for absolute path: %d\n", directory_size);
+            fprintf(stderr, "Error: prepare_directory returned invalid directory_size for absolute path: %ld\n", directory_size);
             free(data);
             return 1;
         }
-        printf("    Absolute path test passed. Directory size: %d bytes\n", directory_size);
+        printf("    Absolute path test passed. Directory size: %ld bytes\n", directory_size);
         
         // Verify we can deserialize
         Directory_item *prep_archive = NULL;
-        int prep_archive_size = deserialize_archive(&prep_archive, data);
+        int prep_archive_size = deserialize_archive(&prep_archive, data, result);
         if (prep_archive_size < 0) {
             fprintf(stderr, "Error: deserialize_archive failed after prepare_directory with absolute path\n");
             free(data);
@@ -460,7 +466,7 @@ int main() {
             return 1;
         }
         
-        if (extract_directory(".", prep_archive, prep_archive_size, true, false) != 0) {
+        if (extract_directory(".", prep_archive, prep_archive_size, true, false, false) != 0) {
             if (chdir(original_cwd) != 0) {
                 perror("chdir error");
             }
@@ -525,8 +531,8 @@ int main() {
     printf("  Test 3: prepare_directory with non-existent path...\n");
     {
         char *data = NULL;
-        int directory_size = 0;
-        int result = prepare_directory("./non_existent_directory_12345", &data, &directory_size);
+        long directory_size = 0;
+        long result = prepare_directory("./non_existent_directory_12345", &data, &directory_size);
         if (result >= 0) {
             fprintf(stderr, "Error: prepare_directory should fail for non-existent directory\n");
             if (data != NULL) free(data);
@@ -552,8 +558,8 @@ int main() {
         }
         
         char *data = NULL;
-        int directory_size = 0;
-        int result = prepare_directory(prep_test_dir, &data, &directory_size);
+        long directory_size = 0;
+        long result = prepare_directory(prep_test_dir, &data, &directory_size);
         
         if (getcwd(cwd_after, sizeof(cwd_after)) == NULL) {
             perror("getcwd error");
@@ -562,7 +568,7 @@ int main() {
         }
         
         if (result < 0) {
-            fprintf(stderr, "Error: prepare_directory failed, code: %d\n", result);
+            fprintf(stderr, "Error: prepare_directory failed, code: %ld\n", result);
             return 1;
         }
         
@@ -631,18 +637,19 @@ int main() {
     {
         // First, use prepare_directory with absolute path to serialize the directory
         char *data = NULL;
-        int directory_size = 0;
-        int result = prepare_directory(restore_abs_path, &data, &directory_size);
+        long directory_size = 0;
+        long result = prepare_directory(restore_abs_path, &data, &directory_size);
         if (result < 0) {
-            fprintf(stderr, "Error: prepare_directory failed, code: %d\n", result);
+            fprintf(stderr, "Error: prepare_directory failed, code: %ld\n", result);
             return 1;
         }
+        long data_len = result;
         
         // Clean output directory
         remove_directory_recursive(restore_output_dir);
         
         // Use restore_directory to extract
-        result = restore_directory(data, restore_output_dir, true, false);
+        result = restore_directory(data, data_len, restore_output_dir, true, false, false);
         if (result != 0) {
             fprintf(stderr, "Error: restore_directory failed, code: %d\n", result);
             free(data);
@@ -673,12 +680,13 @@ int main() {
     printf("  Test 2: restore_directory with NULL output path...\n");
     {
         char *data = NULL;
-        int directory_size = 0;
-        int result = prepare_directory(restore_abs_path, &data, &directory_size);
+        long directory_size = 0;
+        long result = prepare_directory(restore_abs_path, &data, &directory_size);
         if (result < 0) {
-            fprintf(stderr, "Error: prepare_directory failed, code: %d\n", result);
+            fprintf(stderr, "Error: prepare_directory failed, code: %ld\n", result);
             return 1;
         }
+        long data_len = result;
         
         // Extract directory name
         char *dir_name = strrchr(restore_abs_path, '/');
@@ -688,7 +696,7 @@ int main() {
         remove_directory_recursive(dir_name);
         
         // Use restore_directory with NULL output
-        result = restore_directory(data, NULL, true, false);
+        result = restore_directory(data, data_len, NULL, true, false, false);
         if (result != 0) {
             fprintf(stderr, "Error: restore_directory with NULL output failed, code: %d\n", result);
             free(data);
@@ -714,18 +722,19 @@ int main() {
     printf("  Test 3: restore_directory with force flag...\n");
     {
         char *data = NULL;
-        int directory_size = 0;
-        int result = prepare_directory(restore_abs_path, &data, &directory_size);
+        long directory_size = 0;
+        long result = prepare_directory(restore_abs_path, &data, &directory_size);
         if (result < 0) {
-            fprintf(stderr, "Error: prepare_directory failed, code: %d\n", result);
+            fprintf(stderr, "Error: prepare_directory failed, code: %ld\n", result);
             return 1;
         }
+        long data_len = result;
         
         // Clean output directory and create fresh
         remove_directory_recursive(restore_output_dir);
         
         // First extraction
-        result = restore_directory(data, restore_output_dir, true, false);
+        result = restore_directory(data, data_len, restore_output_dir, true, false, false);
         if (result != 0) {
             fprintf(stderr, "Error: first restore_directory failed, code: %d\n", result);
             free(data);
@@ -733,7 +742,7 @@ int main() {
         }
         
         // Second extraction with force flag (should overwrite)
-        result = restore_directory(data, restore_output_dir, true, false);
+        result = restore_directory(data, data_len, restore_output_dir, true, false, false);
         if (result != 0) {
             fprintf(stderr, "Error: second restore_directory with force failed, code: %d\n", result);
             free(data);
@@ -874,7 +883,7 @@ int main() {
         
         // Deserialize the archive
         Directory_item *perm_deserialized = NULL;
-        int perm_deser_size = deserialize_archive(&perm_deserialized, perm_buffer);
+        int perm_deser_size = deserialize_archive(&perm_deserialized, perm_buffer, perm_buffer_size);
         if (perm_deser_size < 0) {
             fprintf(stderr, "Error: Deserialization failed with code %d\n", perm_deser_size);
             free(perm_buffer);
@@ -902,7 +911,7 @@ int main() {
         remove_directory_recursive(perm_output_dir);
         mkdir(perm_output_dir, 0755);
         
-        if (extract_directory(perm_output_dir, perm_deserialized, perm_deser_size, true, false) != 0) {
+        if (extract_directory(perm_output_dir, perm_deserialized, perm_deser_size, true, false, false) != 0) {
             fprintf(stderr, "Error: Extraction failed\n");
             free(perm_buffer);
             for (int i = 0; i < perm_archive_size; i++) {
@@ -1053,13 +1062,13 @@ int main() {
         assert(deep_buffer_size > 0);
         
         Directory_item *deep_deserialized = NULL;
-        int deep_deser_size = deserialize_archive(&deep_deserialized, deep_buffer);
+        int deep_deser_size = deserialize_archive(&deep_deserialized, deep_buffer, deep_buffer_size);
         assert(deep_deser_size > 0);
         
         remove_directory_recursive(deep_output_dir);
         mkdir(deep_output_dir, 0755);
         
-        assert(extract_directory(deep_output_dir, deep_deserialized, deep_deser_size, true, false) == 0);
+        assert(extract_directory(deep_output_dir, deep_deserialized, deep_deser_size, true, false, false) == 0);
         assert(compare_directories(deep_test_dir, deep_output_dir) == 0);
         
         // Cleanup
@@ -1108,13 +1117,13 @@ int main() {
         assert(many_buffer_size > 0);
         
         Directory_item *many_deserialized = NULL;
-        int many_deser_size = deserialize_archive(&many_deserialized, many_buffer);
+        int many_deser_size = deserialize_archive(&many_deserialized, many_buffer, many_buffer_size);
         assert(many_deser_size > 0);
         
         remove_directory_recursive(many_output_dir);
         mkdir(many_output_dir, 0755);
         
-        assert(extract_directory(many_output_dir, many_deserialized, many_deser_size, true, false) == 0);
+        assert(extract_directory(many_output_dir, many_deserialized, many_deser_size, true, false, false) == 0);
         assert(compare_directories(many_test_dir, many_output_dir) == 0);
         
         // Cleanup
@@ -1170,13 +1179,13 @@ int main() {
         assert(special_buffer_size > 0);
         
         Directory_item *special_deserialized = NULL;
-        int special_deser_size = deserialize_archive(&special_deserialized, special_buffer);
+        int special_deser_size = deserialize_archive(&special_deserialized, special_buffer, special_buffer_size);
         assert(special_deser_size > 0);
         
         remove_directory_recursive(special_output_dir);
         mkdir(special_output_dir, 0755);
         
-        assert(extract_directory(special_output_dir, special_deserialized, special_deser_size, true, false) == 0);
+        assert(extract_directory(special_output_dir, special_deserialized, special_deser_size, true, false, false) == 0);
         assert(compare_directories(special_test_dir, special_output_dir) == 0);
         
         // Cleanup
@@ -1226,13 +1235,13 @@ int main() {
         assert(large_buffer_size > 0);
         
         Directory_item *large_deserialized = NULL;
-        int large_deser_size = deserialize_archive(&large_deserialized, large_buffer);
+        int large_deser_size = deserialize_archive(&large_deserialized, large_buffer, large_buffer_size);
         assert(large_deser_size > 0);
         
         remove_directory_recursive(large_output_dir);
         mkdir(large_output_dir, 0755);
         
-        assert(extract_directory(large_output_dir, large_deserialized, large_deser_size, true, false) == 0);
+        assert(extract_directory(large_output_dir, large_deserialized, large_deser_size, true, false, false) == 0);
         assert(compare_directories(large_test_dir, large_output_dir) == 0);
         
         // Cleanup
@@ -1280,13 +1289,13 @@ int main() {
         assert(empty_buffer_size > 0);
         
         Directory_item *empty_deserialized = NULL;
-        int empty_deser_size = deserialize_archive(&empty_deserialized, empty_buffer);
+        int empty_deser_size = deserialize_archive(&empty_deserialized, empty_buffer, empty_buffer_size);
         assert(empty_deser_size > 0);
         
         remove_directory_recursive(empty_output_dir);
         mkdir(empty_output_dir, 0755);
         
-        assert(extract_directory(empty_output_dir, empty_deserialized, empty_deser_size, true, false) == 0);
+        assert(extract_directory(empty_output_dir, empty_deserialized, empty_deser_size, true, false, false) == 0);
         assert(compare_directories(empty_test_dir, empty_output_dir) == 0);
         
         // Cleanup
@@ -1337,13 +1346,13 @@ int main() {
         assert(binary_buffer_size > 0);
         
         Directory_item *binary_deserialized = NULL;
-        int binary_deser_size = deserialize_archive(&binary_deserialized, binary_buffer);
+        int binary_deser_size = deserialize_archive(&binary_deserialized, binary_buffer, binary_buffer_size);
         assert(binary_deser_size > 0);
         
         remove_directory_recursive(binary_output_dir);
         mkdir(binary_output_dir, 0755);
         
-        assert(extract_directory(binary_output_dir, binary_deserialized, binary_deser_size, true, false) == 0);
+        assert(extract_directory(binary_output_dir, binary_deserialized, binary_deser_size, true, false, false) == 0);
         assert(compare_directories(binary_test_dir, binary_output_dir) == 0);
         
         // Cleanup
@@ -1356,6 +1365,516 @@ int main() {
         printf("    Binary files in directory test passed.\n");
     }
     
+    // Edge case 7: Zero-copy deserialization points into the buffer
+    printf("  Edge case 7: Zero-copy deserialization...\n");
+    {
+        char *view_test_dir = "../tests/view_dir";
+        char *view_output_dir = "view_output";
+
+        mkdir("../tests", 0755);
+        mkdir(view_test_dir, 0755);
+        FILE *vf = fopen("../tests/view_dir/view.txt", "w");
+        if (vf) {
+            fprintf(vf, "Zero-copy view contents.\n");
+            fclose(vf);
+        }
+
+        Directory_item *view_archive = NULL;
+        int view_archive_size = 0;
+        int view_current_index = 0;
+
+        char view_cwd[1024];
+        getcwd(view_cwd, sizeof(view_cwd));
+        chdir(view_test_dir);
+        long view_size = archive_directory(".", &view_archive, &view_current_index, &view_archive_size);
+        chdir(view_cwd);
+        assert(view_size > 0);
+
+        char *view_buffer = NULL;
+        long view_buffer_size = serialize_archive(view_archive, view_archive_size, &view_buffer);
+        assert(view_buffer_size > 0);
+
+        Directory_item *view_items = NULL;
+        int view_items_size = deserialize_archive_view(&view_items, view_buffer, view_buffer_size);
+        assert(view_items_size == view_archive_size);
+        for (int i = 0; i < view_items_size; i++) {
+            char *path = view_items[i].is_dir ? view_items[i].dir_path : view_items[i].file_path;
+            assert(path >= view_buffer && path < view_buffer + view_buffer_size);
+            if (!view_items[i].is_dir && view_items[i].file_size > 0) {
+                assert(view_items[i].file_data >= view_buffer);
+                assert(view_items[i].file_data + view_items[i].file_size <= view_buffer + view_buffer_size);
+            }
+        }
+
+        // The segmented serialization must gather into the same bytes as the flat buffer.
+        char *view_headers = NULL;
+        Data_segment *view_segments = NULL;
+        int view_segment_count = 0;
+        long view_segmented_size = serialize_archive_segments(view_archive, view_archive_size, &view_headers, &view_segments, &view_segment_count);
+        assert(view_segmented_size == view_buffer_size);
+        long gathered = 0;
+        for (int i = 0; i < view_segment_count; i++) {
+            assert(memcmp(view_buffer + gathered, view_segments[i].data, view_segments[i].size) == 0);
+            gathered += view_segments[i].size;
+        }
+        assert(gathered == view_buffer_size);
+        free(view_headers);
+        free(view_segments);
+
+        remove_directory_recursive(view_output_dir);
+        mkdir(view_output_dir, 0755);
+        assert(extract_directory(view_output_dir, view_items, view_items_size, true, false, false) == 0);
+        assert(compare_directories(view_test_dir, view_output_dir) == 0);
+
+        // Only the item array is owned by the caller.
+        free(view_items);
+        free(view_buffer);
+        free_directory_items(view_archive, view_archive_size);
+        remove_directory_recursive(view_test_dir);
+        remove_directory_recursive(view_output_dir);
+
+        printf("    Zero-copy deserialization test passed.\n");
+    }
+
+    // Edge case 8: Identical files are stored once
+    printf("  Edge case 8: Duplicate file deduplication...\n");
+    {
+        char *dup_test_dir = "../tests/dup_dir";
+        char *dup_output_dir = "dup_output";
+
+        mkdir("../tests", 0755);
+        mkdir(dup_test_dir, 0755);
+        mkdir("../tests/dup_dir/copy", 0755);
+        const char *names[] = {"../tests/dup_dir/a.txt", "../tests/dup_dir/copy/a.txt", "../tests/dup_dir/b.txt"};
+        const char *contents[] = {"Shared vendored library contents.\n", "Shared vendored library contents.\n", "Unique contents.\n"};
+        for (int i = 0; i < 3; i++) {
+            FILE *df = fopen(names[i], "w");
+            if (df) {
+                fputs(contents[i], df);
+                fclose(df);
+            }
+        }
+
+        Directory_item *dup_archive = NULL;
+        int dup_archive_size = 0;
+        int dup_current_index = 0;
+
+        char dup_cwd[1024];
+        getcwd(dup_cwd, sizeof(dup_cwd));
+        chdir(dup_test_dir);
+        long dup_size = archive_directory(".", &dup_archive, &dup_current_index, &dup_archive_size);
+        chdir(dup_cwd);
+        assert(dup_size > 0);
+
+        char *plain_buffer = NULL;
+        long plain_size = serialize_archive(dup_archive, dup_archive_size, &plain_buffer);
+        assert(plain_size > 0);
+
+        assert(deduplicate_archive(dup_archive, dup_archive_size) == 1);
+        int references = 0;
+        for (int i = 0; i < dup_archive_size; i++) {
+            if (!dup_archive[i].is_dir && dup_archive[i].duplicate_of != 0) {
+                assert(dup_archive[i].file_data == NULL);
+                assert(memcmp(dup_archive[dup_archive[i].duplicate_of].file_data, contents[0], strlen(contents[0])) == 0);
+                references++;
+            }
+        }
+        assert(references == 1);
+
+        char *dup_buffer = NULL;
+        long dup_buffer_size = serialize_archive(dup_archive, dup_archive_size, &dup_buffer);
+        assert(dup_buffer_size == plain_size - (long)strlen(contents[0]));
+
+        Directory_item *dup_items = NULL;
+        int dup_items_size = deserialize_archive_view(&dup_items, dup_buffer, dup_buffer_size);
+        assert(dup_items_size == dup_archive_size);
+
+        remove_directory_recursive(dup_output_dir);
+        mkdir(dup_output_dir, 0755);
+        assert(extract_directory(dup_output_dir, dup_items, dup_items_size, true, false, false) == 0);
+        assert(compare_directories(dup_test_dir, dup_output_dir) == 0);
+
+        free(dup_items);
+        free(dup_buffer);
+        free(plain_buffer);
+        free_directory_items(dup_archive, dup_archive_size);
+        remove_directory_recursive(dup_test_dir);
+        remove_directory_recursive(dup_output_dir);
+
+        printf("    Duplicate file deduplication test passed.\n");
+    }
+
+    // Edge case 9: Content-defined chunking shares chunks between near-identical files
+    printf("  Edge case 9: Chunk-level deduplication...\n");
+    {
+        char *chunk_test_dir = "../tests/chunk_dir";
+        char *chunk_output_dir = "chunk_output";
+
+        mkdir("../tests", 0755);
+        mkdir(chunk_test_dir, 0755);
+        long base_len = 96 * 1024;
+        char *base = malloc(base_len);
+        assert(base != NULL);
+        unsigned int seed = 12345;
+        for (long i = 0; i < base_len; i++) {
+            seed = seed * 1103515245 + 12345;
+            base[i] = (char)(seed >> 16);
+        }
+        FILE *cf = fopen("../tests/chunk_dir/a.log", "wb");
+        if (cf) {
+            fwrite(base, 1, base_len, cf);
+            fclose(cf);
+        }
+        // The second file differs only by a short prefix, so whole-file hashing cannot match it.
+        cf = fopen("../tests/chunk_dir/b.log", "wb");
+        if (cf) {
+            fputs("rotated header line\n", cf);
+            fwrite(base, 1, base_len, cf);
+            fclose(cf);
+        }
+        free(base);
+
+        Directory_item *chunk_archive_items = NULL;
+        int chunk_archive_size = 0;
+        int chunk_current_index = 0;
+
+        char chunk_cwd[1024];
+        getcwd(chunk_cwd, sizeof(chunk_cwd));
+        chdir(chunk_test_dir);
+        long chunk_size = archive_directory(".", &chunk_archive_items, &chunk_current_index, &chunk_archive_size);
+        chdir(chunk_cwd);
+        assert(chunk_size > 0);
+
+        assert(deduplicate_archive(chunk_archive_items, chunk_archive_size) == 0);
+        assert(chunk_archive(chunk_archive_items, chunk_archive_size) > 0);
+
+        char *chunk_buffer = NULL;
+        long chunk_buffer_size = serialize_archive(chunk_archive_items, chunk_archive_size, &chunk_buffer);
+        assert(chunk_buffer_size > 0);
+        assert(chunk_buffer_size < chunk_size);
+
+        Directory_item *chunk_items = NULL;
+        int chunk_items_size = deserialize_archive_view(&chunk_items, chunk_buffer, chunk_buffer_size);
+        assert(chunk_items_size == chunk_archive_size);
+
+        remove_directory_recursive(chunk_output_dir);
+        mkdir(chunk_output_dir, 0755);
+        assert(extract_directory(chunk_output_dir, chunk_items, chunk_items_size, true, false, false) == 0);
+        assert(compare_directories(chunk_test_dir, chunk_output_dir) == 0);
+        free(chunk_items);
+
+        // The owning deserializer reassembles chunked files into contiguous buffers.
+        Directory_item *chunk_owned = NULL;
+        int chunk_owned_size = deserialize_archive(&chunk_owned, chunk_buffer, chunk_buffer_size);
+        assert(chunk_owned_size == chunk_archive_size);
+        for (int i = 0; i < chunk_owned_size; i++) {
+            if (!chunk_owned[i].is_dir) {
+                assert(chunk_owned[i].chunk_count == 0);
+                assert(chunk_owned[i].file_data != NULL);
+            }
+        }
+
+        free(chunk_buffer);
+        free_directory_items(chunk_owned, chunk_owned_size);
+        free_directory_items(chunk_archive_items, chunk_archive_size);
+        remove_directory_recursive(chunk_test_dir);
+        remove_directory_recursive(chunk_output_dir);
+
+        printf("    Chunk-level deduplication test passed.\n");
+    }
+
+    // Edge case 10: Incremental archiving against a previous archive's index
+    printf("  Edge case 10: Incremental archive index...\n");
+    {
+        char *inc_test_dir = "../tests/inc_dir";
+        char *inc_index_file = "inc_index.huff";
+
+        mkdir("../tests", 0755);
+        mkdir(inc_test_dir, 0755);
+        FILE *inf = fopen("../tests/inc_dir/stable.txt", "w");
+        if (inf) {
+            fprintf(inf, "This file does not change.\n");
+            fclose(inf);
+        }
+        inf = fopen("../tests/inc_dir/changing.txt", "w");
+        if (inf) {
+            fprintf(inf, "Version 1\n");
+            fclose(inf);
+        }
+
+        char inc_cwd[1024];
+        getcwd(inc_cwd, sizeof(inc_cwd));
+
+        Directory_item *inc_archive = NULL;
+        int inc_archive_size = 0;
+        int inc_current_index = 0;
+        chdir(inc_test_dir);
+        assert(archive_directory(".", &inc_archive, &inc_current_index, &inc_archive_size) > 0);
+        chdir(inc_cwd);
+
+        // The index is appended after whatever the archive file already contains.
+        FILE *idx = fopen(inc_index_file, "wb");
+        fputs("compressed member", idx);
+        fclose(idx);
+        assert(write_archive_index(inc_index_file, NULL, inc_archive, inc_archive_size) == 0);
+
+        Archive_index index;
+        assert(read_archive_index(inc_index_file, &index) == 0);
+        assert(index.entry_count == 2);
+        Index_entry *stable = find_index_entry(&index, "./stable.txt");
+        assert(stable != NULL);
+        assert(stable->file_size == (long)strlen("This file does not change.\n"));
+        assert(find_index_entry(&index, "./missing.txt") == NULL);
+
+        // Change the size of one file, so it no longer matches the index.
+        inf = fopen("../tests/inc_dir/changing.txt", "w");
+        if (inf) {
+            fprintf(inf, "Version 2, longer\n");
+            fclose(inf);
+        }
+
+        Directory_item *next_archive = NULL;
+        int next_archive_size = 0;
+        int next_current_index = 0;
+        chdir(inc_test_dir);
+        assert(archive_directory_incremental(".", &next_archive, &next_current_index, &next_archive_size, &index) > 0);
+        chdir(inc_cwd);
+        for (int i = 0; i < next_archive_size; i++) {
+            if (next_archive[i].is_dir) continue;
+            if (strcmp(next_archive[i].file_path, "./stable.txt") == 0) {
+                assert(next_archive[i].in_base);
+                assert(next_archive[i].file_data == NULL);
+                assert(next_archive[i].file_hash == stable->hash);
+            } else {
+                assert(!next_archive[i].in_base);
+                assert(next_archive[i].file_data != NULL);
+            }
+        }
+
+        // Unchanged entries carry no data, and deserialize back as references.
+        char *next_buffer = NULL;
+        long next_buffer_size = serialize_archive(next_archive, next_archive_size, &next_buffer);
+        assert(next_buffer_size > 0);
+        Directory_item *next_items = NULL;
+        int next_items_size = deserialize_archive_view(&next_items, next_buffer, next_buffer_size);
+        assert(next_items_size == next_archive_size);
+        int references = 0;
+        for (int i = 0; i < next_items_size; i++) {
+            if (!next_items[i].is_dir && next_items[i].in_base) references++;
+        }
+        assert(references == 1);
+
+        // A same-size edit within the same second only differs in the nanoseconds of the mtime.
+        struct stat stable_st;
+        assert(stat("../tests/inc_dir/stable.txt", &stable_st) == 0);
+        struct timespec touched[2] = {stable_st.st_atim, stable_st.st_mtim};
+        touched[1].tv_nsec = (stable_st.st_mtim.tv_nsec + 1) % 1000000000;
+        assert(utimensat(AT_FDCWD, "../tests/inc_dir/stable.txt", touched, 0) == 0);
+        Directory_item *touched_archive = NULL;
+        int touched_archive_size = 0;
+        int touched_current_index = 0;
+        chdir(inc_test_dir);
+        assert(archive_directory_incremental(".", &touched_archive, &touched_current_index, &touched_archive_size, &index) > 0);
+        chdir(inc_cwd);
+        for (int i = 0; i < touched_archive_size; i++) {
+            if (!touched_archive[i].is_dir) assert(!touched_archive[i].in_base);
+        }
+        free_directory_items(touched_archive, touched_archive_size);
+
+        // A file without an index is rejected.
+        Archive_index none;
+        idx = fopen(inc_index_file, "wb");
+        fputs("no index here", idx);
+        fclose(idx);
+        assert(read_archive_index(inc_index_file, &none) == FILE_MAGIC_ERROR);
+
+        free(next_items);
+        free(next_buffer);
+        free_archive_index(&index);
+        free_directory_items(inc_archive, inc_archive_size);
+        free_directory_items(next_archive, next_archive_size);
+        remove(inc_index_file);
+        remove_directory_recursive(inc_test_dir);
+
+        printf("    Incremental archive index test passed.\n");
+    }
+
+    // Edge case 11: Sync extraction rewrites only files that differ
+    printf("  Edge case 11: Sync extraction...\n");
+    {
+        char *sync_test_dir = "../tests/sync_dir";
+        char *sync_output_dir = "sync_output";
+
+        mkdir("../tests", 0755);
+        mkdir(sync_test_dir, 0755);
+        FILE *sf = fopen("../tests/sync_dir/same.txt", "w");
+        if (sf) {
+            fprintf(sf, "Unchanged deploy file.\n");
+            fclose(sf);
+        }
+        sf = fopen("../tests/sync_dir/edited.txt", "w");
+        if (sf) {
+            fprintf(sf, "Original contents.\n");
+            fclose(sf);
+        }
+
+        Directory_item *sync_archive = NULL;
+        int sync_archive_size = 0;
+        int sync_current_index = 0;
+        char sync_cwd[1024];
+        getcwd(sync_cwd, sizeof(sync_cwd));
+        chdir(sync_test_dir);
+        assert(archive_directory(".", &sync_archive, &sync_current_index, &sync_archive_size) > 0);
+        chdir(sync_cwd);
+
+        char *sync_buffer = NULL;
+        long sync_buffer_size = serialize_archive(sync_archive, sync_archive_size, &sync_buffer);
+        assert(sync_buffer_size > 0);
+        Directory_item *sync_items = NULL;
+        int sync_items_size = deserialize_archive_view(&sync_items, sync_buffer, sync_buffer_size);
+        assert(sync_items_size == sync_archive_size);
+
+        remove_directory_recursive(sync_output_dir);
+        mkdir(sync_output_dir, 0755);
+        assert(extract_directory(sync_output_dir, sync_items, sync_items_size, true, false, false) == 0);
+
+        // Age the unchanged file, and corrupt the other one without changing its size.
+        struct utimbuf old_times = {1000000000, 1000000000};
+        assert(utime("sync_output/same.txt", &old_times) == 0);
+        sf = fopen("sync_output/edited.txt", "w");
+        if (sf) {
+            fprintf(sf, "Tampered contents.\n");
+            fclose(sf);
+        }
+
+        assert(extract_directory(sync_output_dir, sync_items, sync_items_size, false, false, true) == 0);
+        struct stat same_st;
+        assert(stat("sync_output/same.txt", &same_st) == 0);
+        assert(same_st.st_mtime == 1000000000);
+        assert(compare_directories(sync_test_dir, sync_output_dir) == 0);
+
+        // Files are hashed in pieces; the result must match hashing the whole content at once.
+        long hash_sizes[] = {0, 31, 32, 33, HASH_READ_CHUNK - 1, HASH_READ_CHUNK + 5, 3 * HASH_READ_CHUNK + 17};
+        char *hash_content = malloc(3 * HASH_READ_CHUNK + 17);
+        assert(hash_content != NULL);
+        for (long i = 0; i < 3 * HASH_READ_CHUNK + 17; i++) {
+            hash_content[i] = (char)(i * 131 + (i >> 7));
+        }
+        for (int h = 0; h < (int)(sizeof(hash_sizes) / sizeof(hash_sizes[0])); h++) {
+            FILE *hf = fopen("sync_output/hashed.bin", "wb");
+            assert(hf != NULL);
+            assert((long)fwrite(hash_content, 1, hash_sizes[h], hf) == hash_sizes[h]);
+            fclose(hf);
+            uint64_t file_hash = 0;
+            assert(hash_file("sync_output/hashed.bin", &file_hash) == 0);
+            assert(file_hash == hash_data(hash_content, hash_sizes[h]));
+        }
+        free(hash_content);
+
+        free(sync_items);
+        free(sync_buffer);
+        free_directory_items(sync_archive, sync_archive_size);
+        remove_directory_recursive(sync_test_dir);
+        remove_directory_recursive(sync_output_dir);
+
+        printf("    Sync extraction test passed.\n");
+    }
+
+    // Edge case 12: Truncated or corrupted archives and indexes are rejected without reading past the buffer
+    printf("  Edge case 12: Corrupted archive...\n");
+    {
+        char *bad_test_dir = "../tests/bad_dir";
+        char *bad_index_file = "bad_index.bin";
+
+        mkdir("../tests", 0755);
+        mkdir(bad_test_dir, 0755);
+        FILE *bf = fopen("../tests/bad_dir/first.txt", "w");
+        if (bf) {
+            fprintf(bf, "Contents of the first file.\n");
+            fclose(bf);
+        }
+        bf = fopen("../tests/bad_dir/second.txt", "w");
+        if (bf) {
+            fprintf(bf, "Contents of the second file.\n");
+            fclose(bf);
+        }
+
+        Directory_item *bad_archive = NULL;
+        int bad_archive_size = 0;
+        int bad_current_index = 0;
+        char bad_cwd[1024];
+        getcwd(bad_cwd, sizeof(bad_cwd));
+        chdir(bad_test_dir);
+        assert(archive_directory(".", &bad_archive, &bad_current_index, &bad_archive_size) > 0);
+        chdir(bad_cwd);
+
+        char *bad_buffer = NULL;
+        long bad_buffer_size = serialize_archive(bad_archive, bad_archive_size, &bad_buffer);
+        assert(bad_buffer_size > 0);
+
+        // Every proper prefix cuts a field, a name or a file body short.
+        for (long len = 0; len < bad_buffer_size; len++) {
+            Directory_item *bad_items = NULL;
+            assert(deserialize_archive_view(&bad_items, bad_buffer, len) < 0);
+            assert(bad_items == NULL);
+        }
+        assert(restore_directory(bad_buffer, bad_buffer_size - 1, "bad_output", true, false, false) < 0);
+        remove_directory_recursive("bad_output");
+
+        // An item count larger than the buffer can hold fails before the items are allocated.
+        int huge_count = 1000000;
+        memcpy(bad_buffer, &huge_count, sizeof(int));
+        Directory_item *bad_items = NULL;
+        assert(deserialize_archive_view(&bad_items, bad_buffer, bad_buffer_size) == DECOMPRESSION_ERROR);
+        assert(bad_items == NULL);
+
+        // The index trailer may not claim more bytes than the file has, or more entries than fit in it.
+        assert(write_archive_index(bad_index_file, NULL, bad_archive, bad_archive_size) == 0);
+        FILE *idx = fopen(bad_index_file, "rb");
+        assert(idx != NULL);
+        fseek(idx, 0, SEEK_END);
+        long index_file_size = ftell(idx);
+        fseek(idx, 0, SEEK_SET);
+        char *index_bytes = malloc(index_file_size);
+        assert(index_bytes != NULL);
+        assert((long)fread(index_bytes, 1, index_file_size, idx) == index_file_size);
+        fclose(idx);
+
+        Archive_index bad_index;
+        long *size_field = (long*)(index_bytes + index_file_size - sizeof(index_magic) - sizeof(long));
+        long real_index_size = *size_field;
+        *size_field = LONG_MAX / 2;
+        idx = fopen(bad_index_file, "wb");
+        fwrite(index_bytes, 1, index_file_size, idx);
+        fclose(idx);
+        assert(read_archive_index(bad_index_file, &bad_index) == DECOMPRESSION_ERROR);
+
+        *size_field = real_index_size;
+        int bad_entries = 1000;
+        memcpy(index_bytes + index_file_size - sizeof(index_magic) - sizeof(long) - sizeof(int), &bad_entries, sizeof(int));
+        idx = fopen(bad_index_file, "wb");
+        fwrite(index_bytes, 1, index_file_size, idx);
+        fclose(idx);
+        assert(read_archive_index(bad_index_file, &bad_index) == DECOMPRESSION_ERROR);
+
+        // A path whose terminating zero was overwritten runs into the entry count, not past the buffer.
+        bad_entries = 2;
+        memcpy(index_bytes + index_file_size - sizeof(index_magic) - sizeof(long) - sizeof(int), &bad_entries, sizeof(int));
+        index_bytes[index_file_size - sizeof(index_magic) - sizeof(long) - sizeof(int) - 1] = 'x';
+        idx = fopen(bad_index_file, "wb");
+        fwrite(index_bytes, 1, index_file_size, idx);
+        fclose(idx);
+        assert(read_archive_index(bad_index_file, &bad_index) == DECOMPRESSION_ERROR);
+
+        free(index_bytes);
+        free(bad_buffer);
+        free_directory_items(bad_archive, bad_archive_size);
+        remove(bad_index_file);
+        remove_directory_recursive(bad_test_dir);
+
+        printf("    Corrupted archive test passed.\n");
+    }
+
     printf("All edge case tests passed!\n");
 
     return 0;
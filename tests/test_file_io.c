@@ -10,9 +10,10 @@
 
 void test_file_io() {
     // 1. Setup
-    Compressed_file original_data;
+    Compressed_file original_data = {0};
     memcpy(original_data.magic, magic, sizeof(original_data.magic));
     original_data.is_dir = false;
+    original_data.block_type = BLOCK_HUFFMAN;
     original_data.original_size = 123;
     original_data.original_file = strdup("test.txt");
     original_data.tree_size = 45;
@@ -36,6 +37,7 @@ void test_file_io() {
     assert(read_compressed("test.huf", &read_data) == 0);
 
     assert(original_data.original_size == read_data.original_size);
+    assert(original_data.block_type == read_data.block_type);
     assert(strcmp(original_data.original_file, read_data.original_file) == 0);
     assert(original_data.tree_size == read_data.tree_size);
     assert(memcmp(original_data.huffman_tree, read_data.huffman_tree, original_data.tree_size) == 0);
@@ -60,9 +62,10 @@ void test_file_io() {
 /* ===== EDGE CASE TESTS ===== */
 
 void test_file_io_with_empty_filename() {
-    Compressed_file data;
+    Compressed_file data = {0};
     memcpy(data.magic, magic, sizeof(data.magic));
     data.is_dir = false;
+    data.block_type = BLOCK_HUFFMAN;
     data.original_size = 50;
     data.original_file = strdup("");  // Empty filename
     data.tree_size = 20;
@@ -100,9 +103,10 @@ void test_file_io_with_empty_filename() {
 }
 
 void test_file_io_with_long_filename() {
-    Compressed_file data;
+    Compressed_file data = {0};
     memcpy(data.magic, magic, sizeof(data.magic));
     data.is_dir = false;
+    data.block_type = BLOCK_HUFFMAN;
     data.original_size = 75;
     
     // Create very long filename (200 chars)
@@ -150,9 +154,10 @@ void test_file_io_with_long_filename() {
 
 void test_file_io_with_zero_size_data() {
     // Test writing zero-size data
-    Compressed_file data;
+    Compressed_file data = {0};
     memcpy(data.magic, magic, sizeof(data.magic));
     data.is_dir = false;
+    data.block_type = BLOCK_HUFFMAN;
     data.original_size = 0;
     data.original_file = strdup("zero_size.txt");
     data.tree_size = 10;
@@ -179,9 +184,10 @@ void test_file_io_with_zero_size_data() {
 }
 
 void test_file_io_with_large_tree() {
-    Compressed_file data;
+    Compressed_file data = {0};
     memcpy(data.magic, magic, sizeof(data.magic));
     data.is_dir = false;
+    data.block_type = BLOCK_HUFFMAN;
     data.original_size = 500;
     data.original_file = strdup("large_tree.txt");
     
@@ -225,9 +231,10 @@ void test_file_io_with_large_tree() {
 }
 
 void test_file_io_with_binary_data() {
-    Compressed_file data;
+    Compressed_file data = {0};
     memcpy(data.magic, magic, sizeof(data.magic));
     data.is_dir = false;
+    data.block_type = BLOCK_HUFFMAN;
     data.original_size = 256;
     data.original_file = strdup("binary.dat");
     data.tree_size = 50;
@@ -278,7 +285,7 @@ void test_file_io_with_binary_data() {
 }
 
 void test_file_io_directory_flag() {
-    Compressed_file data;
+    Compressed_file data = {0};
     memcpy(data.magic, magic, sizeof(data.magic));
     data.is_dir = true;  // Mark as directory
     data.original_size = 100;
@@ -319,9 +326,10 @@ void test_file_io_directory_flag() {
 }
 
 void test_file_io_special_chars_in_original_filename() {
-    Compressed_file data;
+    Compressed_file data = {0};
     memcpy(data.magic, magic, sizeof(data.magic));
     data.is_dir = false;
+    data.block_type = BLOCK_HUFFMAN;
     data.original_size = 80;
     data.original_file = strdup("file-with_special.chars$123.txt");
     data.tree_size = 35;
@@ -373,9 +381,10 @@ void test_file_io_read_nonexistent_file() {
 }
 
 void test_file_io_very_large_compressed_data() {
-    Compressed_file data;
+    Compressed_file data = {0};
     memcpy(data.magic, magic, sizeof(data.magic));
     data.is_dir = false;
+    data.block_type = BLOCK_HUFFMAN;
     data.original_size = 1000000;  // 1MB original
     data.original_file = strdup("huge.txt");
     data.tree_size = 100;
@@ -417,6 +426,44 @@ void test_file_io_very_large_compressed_data() {
     printf("test_file_io_very_large_compressed_data passed.\n");
 }
 
+void test_file_io_unknown_version() {
+    Compressed_file data = {0};
+    memcpy(data.magic, magic, sizeof(data.magic));
+    data.block_type = BLOCK_STORED;
+    data.original_size = 4;
+    data.original_file = strdup("version.txt");
+    data.compressed_data = strdup("abcd");
+    data.data_size = 32;
+    data.file_name = strdup("version.huf");
+    assert(write_compressed(&data, true) >= 0);
+
+    // A magic utani verzio bajtot egy ismeretlen verziora irjuk at
+    FILE *f = fopen("version.huf", "r+b");
+    assert(f != NULL);
+    unsigned char version = 0;
+    assert(fseek(f, sizeof(magic), SEEK_SET) == 0);
+    assert(fread(&version, 1, 1, f) == 1);
+    assert(version == format_version);
+    version = format_version + 1;
+    assert(fseek(f, sizeof(magic), SEEK_SET) == 0);
+    assert(fwrite(&version, 1, 1, f) == 1);
+    fclose(f);
+
+    Compressed_file read_data = {0};
+    assert(read_compressed("version.huf", &read_data) == FILE_MAGIC_ERROR);
+
+    free(data.original_file);
+    free(data.compressed_data);
+    free(data.file_name);
+    free(read_data.original_file);
+    free(read_data.huffman_tree);
+    free(read_data.compressed_data);
+    free(read_data.file_name);
+
+    remove("version.huf");
+    printf("test_file_io_unknown_version passed.\n");
+}
+
 int main() {
     test_file_io();
     
@@ -430,6 +477,7 @@ int main() {
     test_file_io_special_chars_in_original_filename();
     test_file_io_read_nonexistent_file();
     test_file_io_very_large_compressed_data();
+    test_file_io_unknown_version();
     
     printf("\nAll edge case tests passed!\n");
     